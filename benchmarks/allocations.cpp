@@ -0,0 +1,33 @@
+#include "allocations.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// The replacement operators live apart from the benchmarks: where the
+// compiler sees both, it inlines them into call sites and flags the
+// free as a mismatch of new (-Wmismatched-new-delete)
+namespace {
+
+std::atomic<size_t> g_AllocatedBytes{ 0 };
+
+} // namespace
+
+auto getAllocatedBytes() -> size_t {
+  return g_AllocatedBytes.load(std::memory_order_relaxed);
+}
+
+auto operator new(std::size_t size) -> void* {
+  g_AllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+  if (auto* ptr{ std::malloc(size == 0 ? 1 : size) }) {
+    return ptr;
+  }
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t /*size*/) noexcept {
+  std::free(ptr);
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include <cstddef>
+
+/// Heap bytes allocated so far by the whole process, so it includes
+/// allocations of the thread pool and the query cache
+auto getAllocatedBytes() -> size_t;
@@ -0,0 +1,231 @@
+#include "adun/Client.hpp"
+#include "adun/Database.hpp"
+#include "adun/Parser/Lexer.hpp"
+#include "adun/Parser/Parser.hpp"
+#include "adun/Server.hpp"
+#include "adun/Table.hpp"
+#include "allocations.hpp"
+#include <benchmark/benchmark.h>
+#include <string>
+
+namespace {
+
+using namespace adun; // NOLINT
+
+/// Reports heap bytes allocated per iteration since construction, minus
+/// the ones allocated while excluded
+class AllocationCounter {
+public:
+  explicit AllocationCounter(benchmark::State& state)
+      : m_State{ state },
+        m_Start{ getAllocatedBytes() } {
+  }
+
+  AllocationCounter(const AllocationCounter&)                    = delete;
+  AllocationCounter(AllocationCounter&&)                         = delete;
+  auto operator=(const AllocationCounter&) -> AllocationCounter& = delete;
+  auto operator=(AllocationCounter&&) -> AllocationCounter&      = delete;
+
+  ~AllocationCounter() {
+    m_State.counters["bytes_alloc"] = benchmark::Counter(
+        static_cast<double>(getAllocatedBytes() - m_Start - m_Excluded),
+        benchmark::Counter::kAvgIterations);
+  }
+
+  /// Setup work that is not measured, timing is paused meanwhile
+  template <typename F>
+  void exclude(F&& setup) {
+    m_State.PauseTiming();
+    auto before{ getAllocatedBytes() };
+    std::forward<F>(setup)();
+    m_Excluded += getAllocatedBytes() - before;
+    m_State.ResumeTiming();
+  }
+
+private:
+  benchmark::State& m_State;
+  size_t m_Start;
+  size_t m_Excluded{ 0 };
+};
+
+/// `INSERT` of numRows rows with n = 0, 1, ..., numValues - 1, repeating
+auto makeInsertQuery(int64_t numRows, int64_t numValues = 100)
+    -> std::string {
+  std::string query{ "insert " };
+  for (int64_t i{ 0 }; i < numRows; i++) {
+    query += i == 0 ? "(" : ", (";
+    query += "n = " + std::to_string(i % numValues) + ", s = \"row\")";
+  }
+  return query + " into t;";
+}
+
+/// Table t with numRows rows, n is uniformly spread over [0, 100)
+void fillTable(Database& db, int64_t numRows) {
+  db.execute("create table t (id integer autoincrement, n integer, "
+             "s string);");
+  if (numRows > 0) {
+    db.execute(makeInsertQuery(numRows));
+  }
+}
+
+void setRowsProcessed(benchmark::State& state, int64_t rowsPerIteration) {
+  state.SetItemsProcessed(state.iterations() * rowsPerIteration);
+}
+
+void BM_Lex(benchmark::State& state) {
+  auto query{ makeInsertQuery(state.range(0)) };
+  AllocationCounter allocations{ state };
+  for (auto _ : state) {
+    Lexer lexer;
+    lexer.lex(query);
+    benchmark::DoNotOptimize(lexer.getTokens()->data());
+  }
+  state.SetBytesProcessed(state.iterations() *
+                          static_cast<int64_t>(query.size()));
+  setRowsProcessed(state, state.range(0));
+}
+BENCHMARK(BM_Lex)->RangeMultiplier(10)->Range(1, 10'000);
+
+void BM_BuildAST(benchmark::State& state) {
+  auto query{ makeInsertQuery(state.range(0)) };
+  Lexer lexer;
+  lexer.lex(query);
+  auto tokens{ lexer.getTokens() };
+  AllocationCounter allocations{ state };
+  for (auto _ : state) {
+    Arena arena;
+    Parser parser{ tokens, arena };
+    benchmark::DoNotOptimize(parser.buildAST());
+  }
+  state.SetBytesProcessed(state.iterations() *
+                          static_cast<int64_t>(query.size()));
+  setRowsProcessed(state, state.range(0));
+}
+BENCHMARK(BM_BuildAST)->RangeMultiplier(10)->Range(1, 10'000);
+
+/// Args: whether n is UNIQUE
+void BM_AddRow(benchmark::State& state) {
+  auto modifiers{ state.range(0) != 0 ? Column::Modifier::Unique
+                                      : Column::Modifier::None };
+  Table table{ "t",
+               { { "id", Column{ ValueType::Integer,
+                                 Column::Modifier::AutoIncrement } },
+                 { "n", Column{ ValueType::Integer, modifiers } } } };
+  int32_t n{ 0 };
+  AllocationCounter allocations{ state };
+  for (auto _ : state) {
+    table.addRow({ { "n", n++ } });
+  }
+  setRowsProcessed(state, 1);
+}
+BENCHMARK(BM_AddRow)->ArgName("unique")->Arg(0)->Arg(1);
+
+/// Args: table size, percent of rows selected
+void BM_Select(benchmark::State& state) {
+  Database db;
+  fillTable(db, state.range(0));
+  auto query{ "select id, n, s from t where n < " +
+              std::to_string(state.range(1)) + ";" };
+  AllocationCounter allocations{ state };
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(db.execute(query).getNumAffectedRows());
+  }
+  setRowsProcessed(state, state.range(0));
+}
+BENCHMARK(BM_Select)
+    ->ArgNames({ "rows", "selectivity" })
+    ->ArgsProduct({ { 1'000, 100'000 }, { 1, 10, 100 } })
+    ->Unit(benchmark::kMicrosecond);
+
+void BM_Update(benchmark::State& state) {
+  Database db;
+  fillTable(db, state.range(0));
+  AllocationCounter allocations{ state };
+  for (auto _ : state) {
+    db.execute("update t set (n = n + 1) where true;");
+  }
+  setRowsProcessed(state, state.range(0));
+}
+BENCHMARK(BM_Update)
+    ->ArgName("rows")
+    ->Arg(1'000)
+    ->Arg(100'000)
+    ->Unit(benchmark::kMicrosecond);
+
+void BM_Delete(benchmark::State& state) {
+  Database db;
+  fillTable(db, 0);
+  auto insertQuery{ makeInsertQuery(state.range(0)) };
+  AllocationCounter allocations{ state };
+  for (auto _ : state) {
+    allocations.exclude([&] { db.execute(insertQuery); });
+    db.execute("delete from t where true;");
+  }
+  setRowsProcessed(state, state.range(0));
+}
+BENCHMARK(BM_Delete)
+    ->ArgName("rows")
+    ->Arg(1'000)
+    ->Arg(100'000)
+    ->Unit(benchmark::kMicrosecond);
+
+void BM_ResultIteration(benchmark::State& state) {
+  Database db;
+  fillTable(db, state.range(0));
+  auto result{ db.execute("select id, n, s from t where true;") };
+  AllocationCounter allocations{ state };
+  for (auto _ : state) {
+    for (const auto& row : result) {
+      benchmark::DoNotOptimize(row["n"]);
+    }
+  }
+  setRowsProcessed(state, state.range(0));
+}
+BENCHMARK(BM_ResultIteration)
+    ->ArgName("rows")
+    ->Arg(1'000)
+    ->Arg(100'000)
+    ->Unit(benchmark::kMicrosecond);
+
+/// Small queries in process, the baseline of BM_ServerPointQuery
+void BM_PointQuery(benchmark::State& state) {
+  Database db;
+  fillTable(db, 1'000);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        db.execute("select n from t where id = 500;").getNumAffectedRows());
+  }
+  setRowsProcessed(state, 1);
+}
+BENCHMARK(BM_PointQuery)->Unit(benchmark::kMicrosecond);
+
+#ifdef __linux__
+/// Args: requests in flight per round trip
+void BM_ServerPointQuery(benchmark::State& state) {
+  Database db;
+  fillTable(db, 1'000);
+  Server server{ db, {} };
+  server.start();
+  auto client{ Client::connect("127.0.0.1", server.getPort()) };
+  auto depth{ state.range(0) };
+  for (auto _ : state) {
+    for (int64_t i{ 0 }; i < depth; i++) {
+      client.post("select n from t where id = 500;");
+    }
+    for (int64_t i{ 0 }; i < depth; i++) {
+      benchmark::DoNotOptimize(client.getResult().rows.size());
+    }
+  }
+  setRowsProcessed(state, depth);
+}
+BENCHMARK(BM_ServerPointQuery)
+    ->ArgName("depth")
+    ->RangeMultiplier(8)
+    ->Range(1, 512)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+#endif
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,510 @@
+// YCSB style workload runner: loads a synthetic table, then runs a mix of
+// point reads, scans, updates and inserts from several client threads
+// for a fixed time and reports throughput and latency percentiles.
+//
+// Usage: adundb_benchmarks_ycsb [--workload=A..F] [--records=N]
+//   [--threads=N] [--duration=SECONDS] [--distribution=uniform|zipfian]
+//   [--fields=N] [--field-size=BYTES] [--cardinality=N]
+//   [--blob-size=BYTES] [--seed=N]
+#include "adun/Database.hpp"
+#include "adun/Exceptions.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace adun; // NOLINT
+using Clock = std::chrono::steady_clock;
+using Rng   = std::mt19937_64;
+
+constexpr std::string_view s_TableName{ "usertable" };
+constexpr int64_t s_LoadBatchSize{ 1'000 };
+constexpr int64_t s_MaxScanLength{ 100 };
+constexpr double s_ZipfianConstant{ 0.99 };
+
+enum class Distribution : uint8_t {
+  Uniform,
+  Zipfian,
+};
+
+enum class Operation : uint8_t {
+  Read,
+  Update,
+  Insert,
+  Scan,
+  ReadModifyWrite,
+};
+
+constexpr std::array<std::string_view, 5> s_OperationNames{
+  "READ", "UPDATE", "INSERT", "SCAN", "READ-MODIFY-WRITE"
+};
+
+/// Share of each operation in percent, in Operation order
+struct Workload {
+  std::array<int32_t, 5> mix;
+  bool readsLatest; ///< reads prefer recently inserted keys
+};
+
+const std::map<char, Workload> s_Workloads{
+  { 'A', { { 50, 50, 0, 0, 0 }, false } }, // update heavy
+  { 'B', { { 95, 5, 0, 0, 0 }, false } },  // read mostly
+  { 'C', { { 100, 0, 0, 0, 0 }, false } }, // read only
+  { 'D', { { 95, 0, 5, 0, 0 }, true } },   // read latest
+  { 'E', { { 0, 0, 5, 95, 0 }, false } },  // short ranges
+  { 'F', { { 50, 0, 0, 0, 50 }, false } }, // read-modify-write
+};
+
+struct Options {
+  char workload{ 'A' };
+  int64_t numRecords{ 10'000 };
+  int32_t numThreads{ 4 };
+  std::chrono::seconds duration{ 10 };
+  Distribution distribution{ Distribution::Zipfian };
+  int32_t numFields{ 4 };
+  int32_t fieldSize{ 32 };
+  int32_t cardinality{ 0 }; ///< distinct field values, 0 if unbounded
+  int32_t blobSize{ 0 };    ///< size of the BYTE column, 0 for none
+  uint64_t seed{ 42 };
+};
+
+/// Zipfian over [0, numItems) as in YCSB (Gray et al., "Quickly
+/// generating billion-record synthetic databases"), item 0 is the
+/// hottest
+class ZipfianGenerator {
+public:
+  explicit ZipfianGenerator(int64_t numItems)
+      : m_NumItems{ numItems },
+        m_Alpha{ 1.0 / (1.0 - s_ZipfianConstant) },
+        m_Zetan{ zeta(numItems) } {
+    auto zeta2{ zeta(2) };
+    m_Eta = (1.0 - std::pow(2.0 / static_cast<double>(numItems),
+                            1.0 - s_ZipfianConstant)) /
+            (1.0 - zeta2 / m_Zetan);
+  }
+
+  auto next(Rng& rng) const -> int64_t {
+    auto u{ std::uniform_real_distribution<double>{}(rng) };
+    auto uz{ u * m_Zetan };
+    if (uz < 1.0) {
+      return 0;
+    }
+    if (uz < 1.0 + std::pow(0.5, s_ZipfianConstant)) {
+      return 1;
+    }
+    auto item{ static_cast<int64_t>(
+        static_cast<double>(m_NumItems) *
+        std::pow(m_Eta * u - m_Eta + 1.0, m_Alpha)) };
+    return std::min(item, m_NumItems - 1);
+  }
+
+private:
+  static auto zeta(int64_t n) -> double {
+    double sum{ 0 };
+    for (int64_t i{ 1 }; i <= n; i++) {
+      sum += 1.0 / std::pow(static_cast<double>(i), s_ZipfianConstant);
+    }
+    return sum;
+  }
+
+  int64_t m_NumItems;
+  double m_Alpha;
+  double m_Zetan;
+  double m_Eta{ 0 };
+};
+
+/// FNV-1a, spreads hot zipfian items over the key space
+auto scramble(int64_t item) -> uint64_t {
+  uint64_t hash{ 0xCBF29CE484222325ULL };
+  for (int32_t i{ 0 }; i < 8; i++) {
+    hash ^= static_cast<uint64_t>(item) >> (i * 8) & 0xFFU;
+    hash *= 0x100000001B3ULL;
+  }
+  return hash;
+}
+
+/// Generates rows and statements of the workload, one per client
+class Generator {
+public:
+  Generator(const Options& options, const ZipfianGenerator& zipfian,
+            std::atomic<int64_t>& numKeys, uint64_t seed)
+      : m_Options{ options },
+        m_Zipfian{ zipfian },
+        m_NumKeys{ numKeys },
+        m_Rng{ seed } {
+  }
+
+  auto nextOperation(const Workload& workload) -> Operation {
+    auto roll{ std::uniform_int_distribution<int32_t>{ 0, 99 }(m_Rng) };
+    for (size_t i{ 0 }; i < workload.mix.size(); i++) {
+      roll -= workload.mix[i];
+      if (roll < 0) {
+        return static_cast<Operation>(i);
+      }
+    }
+    return Operation::Read;
+  }
+
+  /// Key of an existing row
+  auto nextKey(bool latest) -> int64_t {
+    auto numKeys{ m_NumKeys.load(std::memory_order_acquire) };
+    if (latest) {
+      return std::max<int64_t>(numKeys - 1 - m_Zipfian.next(m_Rng), 0);
+    }
+    if (m_Options.distribution == Distribution::Zipfian) {
+      return static_cast<int64_t>(scramble(m_Zipfian.next(m_Rng)) %
+                                  static_cast<uint64_t>(numKeys));
+    }
+    std::uniform_int_distribution<int64_t> uniform{ 0, numKeys - 1 };
+    return uniform(m_Rng);
+  }
+
+  auto nextScanLength() -> int64_t {
+    std::uniform_int_distribution<int64_t> length{ 1, s_MaxScanLength };
+    return length(m_Rng);
+  }
+
+  auto nextField() -> int32_t {
+    return std::uniform_int_distribution<int32_t>{
+      0, m_Options.numFields - 1
+    }(m_Rng);
+  }
+
+  /// String literal, drawn from cardinality values if there is a limit
+  auto nextFieldValue() -> std::string {
+    std::string value(static_cast<size_t>(m_Options.fieldSize), 'a');
+    if (m_Options.cardinality > 0) {
+      auto id{ std::to_string(std::uniform_int_distribution<int32_t>{
+          0, m_Options.cardinality - 1 }(m_Rng)) };
+      value.replace(0, std::min(id.size(), value.size()), id);
+    } else {
+      std::uniform_int_distribution<int32_t> letter{ 'a', 'z' };
+      for (auto& c : value) {
+        c = static_cast<char>(letter(m_Rng));
+      }
+    }
+    return '"' + value + '"';
+  }
+
+  auto nextBlob() -> std::string {
+    static constexpr std::string_view s_Hex{ "0123456789abcdef" };
+    std::string blob{ "0x" };
+    std::uniform_int_distribution<size_t> digit{ 0, s_Hex.size() - 1 };
+    for (int32_t i{ 0 }; i < m_Options.blobSize * 2; i++) {
+      blob += s_Hex[digit(m_Rng)];
+    }
+    return blob;
+  }
+
+  /// Values of an `INSERT` of a row with key
+  auto makeRow(int64_t key) -> std::string {
+    auto row{ "(key = " + std::to_string(key) };
+    for (int32_t i{ 0 }; i < m_Options.numFields; i++) {
+      row += ", f" + std::to_string(i) + " = " + nextFieldValue();
+    }
+    if (m_Options.blobSize > 0) {
+      row += ", blob = " + nextBlob();
+    }
+    return row + ")";
+  }
+
+private:
+  const Options& m_Options;
+  const ZipfianGenerator& m_Zipfian;
+  std::atomic<int64_t>& m_NumKeys;
+  Rng m_Rng;
+};
+
+/// Latencies of one operation kind in nanoseconds
+struct Latencies {
+  std::vector<int64_t> samples;
+  int64_t numErrors{ 0 };
+};
+
+using ClientStats = std::array<Latencies, s_OperationNames.size()>;
+
+class Runner {
+public:
+  explicit Runner(Options options)
+      : m_Options{ options },
+        m_Workload{ s_Workloads.at(options.workload) },
+        m_Zipfian{ options.numRecords },
+        m_NumKeys{ options.numRecords },
+        m_NextKey{ options.numRecords } {
+  }
+
+  void load() {
+    auto create{ "create table " + std::string{ s_TableName } +
+                 " (key integer unique" };
+    for (int32_t i{ 0 }; i < m_Options.numFields; i++) {
+      create += ", f" + std::to_string(i) + " string";
+    }
+    if (m_Options.blobSize > 0) {
+      create += ", blob byte";
+    }
+    m_Db.execute(create + ");");
+
+    std::atomic<int64_t> numKeys{ 0 };
+    Generator generator{ m_Options, m_Zipfian, numKeys, m_Options.seed };
+    auto start{ Clock::now() };
+    for (int64_t first{ 0 }; first < m_Options.numRecords;
+         first += s_LoadBatchSize) {
+      std::string insert{ "insert " };
+      auto last{ std::min(first + s_LoadBatchSize, m_Options.numRecords) };
+      for (auto key{ first }; key < last; key++) {
+        insert += (key == first ? "" : ", ") + generator.makeRow(key);
+      }
+      m_Db.execute(insert + " into " + std::string{ s_TableName } + ";");
+    }
+    std::printf("Loaded %lld records in %.2f s\n",
+                static_cast<long long>(m_Options.numRecords),
+                secondsSince(start));
+  }
+
+  void run() {
+    std::vector<ClientStats> stats(
+        static_cast<size_t>(m_Options.numThreads));
+    auto start{ Clock::now() };
+    auto deadline{ start + m_Options.duration };
+    {
+      std::vector<std::jthread> clients;
+      for (int32_t i{ 0 }; i < m_Options.numThreads; i++) {
+        clients.emplace_back([this, i, deadline, &stats] {
+          runClient(m_Options.seed + 1 + static_cast<uint64_t>(i),
+                    deadline, stats[static_cast<size_t>(i)]);
+        });
+      }
+    }
+    report(stats, secondsSince(start));
+  }
+
+private:
+  /// Statements of one operation, built before it is timed
+  struct Request {
+    Operation operation;
+    std::string query;
+    std::string update; ///< of a read-modify-write, if the row exists
+  };
+
+  void runClient(uint64_t seed, Clock::time_point deadline,
+                 ClientStats& stats) {
+    Generator generator{ m_Options, m_Zipfian, m_NumKeys, seed };
+    while (Clock::now() < deadline) {
+      auto request{ makeRequest(generator.nextOperation(m_Workload),
+                                generator) };
+
+      auto& latencies{ stats[static_cast<size_t>(request.operation)] };
+      auto opStart{ Clock::now() };
+      try {
+        auto result{ m_Db.execute(request.query) };
+        if (!request.update.empty() && result.getNumAffectedRows() > 0) {
+          m_Db.execute(request.update);
+        }
+      } catch (const DatabaseException&) {
+        latencies.numErrors++;
+        continue;
+      }
+      latencies.samples.push_back(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              Clock::now() - opStart)
+              .count());
+
+      if (request.operation == Operation::Insert) {
+        // a read may miss a key whose insert is still running, which
+        // just returns no rows
+        m_NumKeys.fetch_add(1, std::memory_order_release);
+      }
+    }
+  }
+
+  auto makeRequest(Operation operation, Generator& generator)
+      -> Request {
+    std::string table{ s_TableName };
+    auto makeUpdate{ [&](int64_t key) {
+      auto field{ "f" + std::to_string(generator.nextField()) };
+      return "update " + table + " set (" + field + " = " +
+             generator.nextFieldValue() +
+             ") where key = " + std::to_string(key) + ";";
+    } };
+
+    switch (operation) {
+    case Operation::Read: {
+      auto key{ generator.nextKey(m_Workload.readsLatest) };
+      return { operation,
+               "select * from " + table +
+                   " where key = " + std::to_string(key) + ";",
+               {} };
+    }
+    case Operation::Update:
+      return { operation, makeUpdate(generator.nextKey(false)), {} };
+    case Operation::Insert:
+      return { operation,
+               "insert " + generator.makeRow(m_NextKey.fetch_add(1)) +
+                   " into " + table + ";",
+               {} };
+    case Operation::Scan: {
+      auto first{ generator.nextKey(false) };
+      return { operation,
+               "select * from " + table + " where key >= " +
+                   std::to_string(first) + " && key < " +
+                   std::to_string(first + generator.nextScanLength()) +
+                   ";",
+               {} };
+    }
+    case Operation::ReadModifyWrite: {
+      auto key{ generator.nextKey(false) };
+      return { operation,
+               "select * from " + table +
+                   " where key = " + std::to_string(key) + ";",
+               makeUpdate(key) };
+    }
+    }
+    throw std::logic_error{ "Unknown operation" };
+  }
+
+  void report(const std::vector<ClientStats>& stats,
+              double seconds) const {
+    int64_t numOps{ 0 };
+    std::printf("%-18s %10s %8s %12s %12s %12s\n", "Operation", "Ops",
+                "Errors", "p50 (us)", "p99 (us)", "p999 (us)");
+    for (size_t op{ 0 }; op < s_OperationNames.size(); op++) {
+      Latencies merged;
+      for (const auto& client : stats) {
+        merged.samples.insert(merged.samples.end(),
+                              client[op].samples.begin(),
+                              client[op].samples.end());
+        merged.numErrors += client[op].numErrors;
+      }
+      if (merged.samples.empty() && merged.numErrors == 0) {
+        continue;
+      }
+      std::ranges::sort(merged.samples);
+      auto numSamples{ static_cast<int64_t>(merged.samples.size()) };
+      numOps += numSamples;
+      std::printf("%-18s %10lld %8lld %12.1f %12.1f %12.1f\n",
+                  s_OperationNames[op].data(),
+                  static_cast<long long>(numSamples),
+                  static_cast<long long>(merged.numErrors),
+                  percentile(merged.samples, 0.5),
+                  percentile(merged.samples, 0.99),
+                  percentile(merged.samples, 0.999));
+    }
+    std::printf("Throughput: %.0f ops/s over %.2f s with %d threads\n",
+                static_cast<double>(numOps) / seconds, seconds,
+                m_Options.numThreads);
+  }
+
+  /// @returns microseconds, samples must be sorted
+  static auto percentile(const std::vector<int64_t>& samples, double p)
+      -> double {
+    if (samples.empty()) {
+      return 0;
+    }
+    auto rank{ static_cast<size_t>(
+        std::ceil(p * static_cast<double>(samples.size()))) };
+    return static_cast<double>(samples[std::max<size_t>(rank, 1) - 1]) /
+           1'000.0;
+  }
+
+  static auto secondsSince(Clock::time_point start) -> double {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  Options m_Options;
+  Workload m_Workload;
+  ZipfianGenerator m_Zipfian;
+  Database m_Db;
+  std::atomic<int64_t> m_NumKeys; ///< keys [0, m_NumKeys) are readable
+  std::atomic<int64_t> m_NextKey;
+};
+
+/// @returns value of a --name=value argument
+auto getArgValue(std::string_view arg, std::string_view name)
+    -> std::optional<std::string> {
+  auto prefix{ "--" + std::string{ name } + "=" };
+  if (!arg.starts_with(prefix)) {
+    return std::nullopt;
+  }
+  return std::string{ arg.substr(prefix.size()) };
+}
+
+/// @throws std::invalid_argument on malformed arguments
+auto parseOptions(int argc, char** argv) -> Options {
+  Options options;
+  for (int i{ 1 }; i < argc; i++) {
+    std::string_view arg{ argv[i] };
+    if (auto v{ getArgValue(arg, "workload") }) {
+      if (v->size() != 1 || !s_Workloads.contains((*v)[0])) {
+        throw std::invalid_argument{ "Unknown workload " + *v };
+      }
+      options.workload = (*v)[0];
+    } else if (auto v{ getArgValue(arg, "records") }) {
+      options.numRecords = std::stoll(*v);
+    } else if (auto v{ getArgValue(arg, "threads") }) {
+      options.numThreads = std::stoi(*v);
+    } else if (auto v{ getArgValue(arg, "duration") }) {
+      options.duration = std::chrono::seconds{ std::stoll(*v) };
+    } else if (auto v{ getArgValue(arg, "distribution") }) {
+      if (*v == "uniform") {
+        options.distribution = Distribution::Uniform;
+      } else if (*v == "zipfian") {
+        options.distribution = Distribution::Zipfian;
+      } else {
+        throw std::invalid_argument{ "Unknown distribution " + *v };
+      }
+    } else if (auto v{ getArgValue(arg, "fields") }) {
+      options.numFields = std::stoi(*v);
+    } else if (auto v{ getArgValue(arg, "field-size") }) {
+      options.fieldSize = std::stoi(*v);
+    } else if (auto v{ getArgValue(arg, "cardinality") }) {
+      options.cardinality = std::stoi(*v);
+    } else if (auto v{ getArgValue(arg, "blob-size") }) {
+      options.blobSize = std::stoi(*v);
+    } else if (auto v{ getArgValue(arg, "seed") }) {
+      options.seed = std::stoull(*v);
+    } else {
+      throw std::invalid_argument{ "Unknown argument " +
+                                   std::string{ arg } };
+    }
+  }
+  if (options.numRecords < 2 || options.numThreads < 1 ||
+      options.numFields < 1 || options.fieldSize < 1) {
+    throw std::invalid_argument{ "Need at least 2 records, 1 thread and "
+                                 "1 non-empty field" };
+  }
+  return options;
+}
+
+} // namespace
+
+auto main(int argc, char** argv) -> int {
+  Options options;
+  try {
+    options = parseOptions(argc, argv);
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+
+  try {
+    Runner runner{ options };
+    runner.load();
+    runner.run();
+  } catch (const DatabaseException& e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
@@ -13,7 +13,8 @@ auto main() -> int {
     lexer.lex(query);
     auto tokens{ lexer.getTokens() };
 
-    adun::Parser parser{ tokens };
+    adun::Arena arena;
+    adun::Parser parser{ tokens, arena };
     auto ast{ parser.buildAST() };
   } catch (const adun::DatabaseException& e) {
     return 0;
@@ -0,0 +1,62 @@
+#pragma once
+#include "adun/Exceptions.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace adun {
+
+/// Thrown by a statement that was cancelled or ran past its deadline,
+/// after reverting what it changed
+class QueryCancelledException : public DatabaseException {
+public:
+  enum class Cause : uint8_t { Cancelled, TimedOut };
+
+  QueryCancelledException(Cause cause, const std::string& message)
+      : DatabaseException{ message },
+        m_Cause{ cause } {
+  }
+
+  [[nodiscard]] auto getCause() const -> Cause {
+    return m_Cause;
+  }
+
+private:
+  Cause m_Cause;
+};
+
+/// Lets a running statement be stopped from another thread, or once its
+/// deadline passes. Statements poll it cooperatively at block boundaries
+/// of scans and writes, see s_CheckInterval, so stopping takes as long
+/// as a block does and needs no signals.
+class CancellationToken {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /// Row versions visited between two checks
+  static constexpr size_t s_CheckInterval{ 4096 };
+
+  /// Arms the deadline of the next statement. A pending cancellation
+  /// stays, so one issued between statements stops the next one. Not
+  /// thread safe with check.
+  void reset(Clock::time_point deadline = Clock::time_point::max());
+
+  /// Thread safe
+  void cancel();
+  /// Drops a pending cancellation, once a statement failed of it.
+  /// Only for Cause::Cancelled, a later cancel is lost otherwise.
+  void clear();
+  [[nodiscard]] auto getDeadline() const -> Clock::time_point;
+
+  /// @throws QueryCancelledException if cancelled or past the deadline,
+  /// a cancellation reported first
+  void check() const;
+
+private:
+  std::atomic<bool> m_Cancelled{ false };
+  Clock::time_point m_Deadline{ Clock::time_point::max() };
+};
+
+} // namespace adun
@@ -0,0 +1,127 @@
+#pragma once
+#include "adun/Exceptions.hpp"
+#include "adun/Protocol.hpp"
+#include "adun/Value.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace adun {
+
+/// The connection failed or the server broke the protocol
+class ClientException : public DatabaseException {
+public:
+  using DatabaseException::DatabaseException;
+};
+
+/// The server failed a request, the connection can go on
+class StatementException : public ClientException {
+public:
+  StatementException(protocol::ErrorCode code, const std::string& msg);
+
+  [[nodiscard]] auto getCode() const -> protocol::ErrorCode;
+
+private:
+  protocol::ErrorCode m_Code;
+};
+
+/// Blocking connection to a Server. Statements run in a session of the
+/// connection, so BEGIN spans statements until COMMIT or ROLLBACK.
+///
+/// post pipelines requests: they are buffered and sent in one write by
+/// flush or getResult, and their results are read in order by
+/// getResult, so a run of small queries costs one round trip.
+///
+/// Not thread safe, use a client per thread. Linux only, as Server is.
+class Client {
+public:
+  struct QueryResult {
+    std::vector<std::string> columns; ///< in row layout order
+    std::vector<std::vector<Value>> rows;
+    size_t affectedRows{ 0 };
+  };
+
+  /// Literals of its text are its parameters, see prepare
+  struct Statement {
+    uint32_t id;
+    size_t numParams;
+  };
+
+  /// Gets rows in column order as their batches arrive
+  using RowCallback = std::function<void(std::vector<Value> row)>;
+
+  /// @throws ClientException if it can't connect
+  static auto connect(const std::string& host, uint16_t port) -> Client;
+  static auto connectUnix(const std::string& path) -> Client;
+
+  ~Client();
+  Client(Client&& other) noexcept;
+  auto operator=(Client&& other) noexcept -> Client&;
+  Client(const Client&)                    = delete;
+  auto operator=(const Client&) -> Client& = delete;
+
+  /// @throws StatementException if the statement fails
+  /// @throws ClientException if the connection fails
+  auto execute(std::string_view query) -> QueryResult;
+  /// Streams rows to onRow instead of keeping them
+  /// @returns number of affected rows
+  auto execute(std::string_view query, const RowCallback& onRow)
+      -> size_t;
+
+  /// Parsed once by the server, executing sends only the parameters.
+  /// `SELECT * FROM t WHERE id = 0;` takes the id as its parameter.
+  auto prepare(std::string_view query) -> Statement;
+  /// @param params one per literal of the statement, in order
+  auto execute(const Statement& statement, std::span<const Value> params)
+      -> QueryResult;
+  void close(const Statement& statement);
+
+  /// Queues a request, its result is read by getResult in order
+  void post(std::string_view query);
+  void post(const Statement& statement, std::span<const Value> params);
+  /// Sends the queued requests, reading responses meanwhile so that
+  /// neither side waits on a full socket
+  void flush();
+  /// Flushes, then reads the result of the oldest posted request
+  /// @throws StatementException if that one failed, the others go on
+  auto getResult() -> QueryResult;
+  /// Posted requests whose result wasn't read yet
+  [[nodiscard]] auto getNumPending() const -> size_t;
+
+private:
+  explicit Client(int fd);
+
+  /// Blocks for the next message, valid until the following call
+  auto receive() -> protocol::MessageReader;
+  /// Reads the response to a request, handing rows to onRow and column
+  /// names to columns if set
+  /// @returns last message, of type expected
+  /// @throws StatementException on an Error message
+  auto receiveResponse(protocol::MessageType expected,
+                       const RowCallback& onRow = nullptr,
+                       std::vector<std::string>* columns = nullptr)
+      -> protocol::MessageReader;
+  /// Keeps the rows of the response to a query
+  auto receiveResult() -> QueryResult;
+  /// Queues Query, Prepare and the like, which carry a statement only
+  void writeStatement(protocol::MessageType type, std::string_view query);
+  void writeExecute(const Statement& statement,
+                    std::span<const Value> params);
+  /// @throws ClientException if posted results weren't read yet
+  void checkNotPipelining() const;
+  /// Appends what the server sent so far to m_Input
+  /// @returns false if nothing was there
+  auto receiveSome(int flags) -> bool;
+
+  int m_Fd{ -1 };
+  std::string m_Input;
+  size_t m_Consumed{ 0 }; ///< bytes of m_Input read already
+  std::string m_Output;   ///< queued requests
+  size_t m_NumPending{ 0 };
+};
+
+} // namespace adun
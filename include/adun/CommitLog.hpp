@@ -0,0 +1,122 @@
+#pragma once
+#include "adun/Exceptions.hpp"
+#include "adun/Value.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace adun {
+
+/// Redo log with one record per committed transaction, appended and
+/// synced before the transaction becomes visible. Changes are logged
+/// logically, as statements and bulk loaded CSV, and redone on recovery.
+///
+/// Commits are synced in groups: committers queue their records and wait
+/// while a flusher thread writes everything queued so far with a single
+/// write and fdatasync, then wakes the whole group. Records queue up
+/// during a sync on their own; Options::maxDelay trades latency for
+/// larger groups under light load.
+///
+/// Record layout, little endian: u32 payload size, u32 CRC-32 of the
+/// payload, then per entry u8 Entry::Kind, u32 length prefixed table name
+/// and u32 length prefixed data. Recovery stops at the first torn or
+/// corrupt record, which is what a crash mid-append leaves behind.
+class CommitLog {
+public:
+  struct Entry {
+    enum class Kind : uint8_t {
+      Statement, ///< data is the statement text
+      Csv,       ///< data is CSV with a header record loaded into table
+      /// data is the literals bound in place of those of the preceding
+      /// Statement, see encodeLiterals
+      Literals,
+    };
+
+    Kind kind;
+    std::string table;
+    std::string data;
+  };
+
+  using Record = std::vector<Entry>;
+
+  struct Options {
+    /// How long the first record of a group waits for more of them
+    std::chrono::microseconds maxDelay{ 0 };
+    /// Records that end the wait early
+    size_t maxGroupSize{ 256 };
+  };
+
+  struct Stats {
+    size_t numGroups{ 0 };
+    size_t numRecords{ 0 };
+    size_t numBytes{ 0 };
+    size_t maxGroupSize{ 0 }; ///< records
+    std::chrono::nanoseconds totalSyncTime{ 0 }; ///< write and fdatasync
+    std::chrono::nanoseconds maxSyncTime{ 0 };
+  };
+
+  /// Opens the log at path, creating it if missing
+  /// @throws FileException
+  explicit CommitLog(std::string path);
+  CommitLog(std::string path, Options options);
+  ~CommitLog();
+
+  CommitLog(const CommitLog&)                    = delete;
+  CommitLog(CommitLog&&)                         = delete;
+  auto operator=(const CommitLog&) -> CommitLog& = delete;
+  auto operator=(CommitLog&&) -> CommitLog&      = delete;
+
+  /// Calls apply on each intact record in commit order, then cuts off a
+  /// torn tail so new records follow the intact ones. Call before the
+  /// first append.
+  void replay(const std::function<void(const Record&)>& apply);
+
+  /// Thread safe, returns once record is on disk. A group may be
+  /// partially written on failure, so the log refuses further appends.
+  /// @throws FileException
+  void append(const Record& record);
+
+  [[nodiscard]] auto getStats() const -> Stats;
+
+  /// Per value u8 ValueType, then i32, u8 bool or length prefixed bytes
+  static auto encodeLiterals(std::span<const Value> literals)
+      -> std::string;
+  /// @returns nullopt if data is malformed
+  static auto decodeLiterals(std::string_view data)
+      -> std::optional<std::vector<Value>>;
+
+private:
+  static auto encode(const Record& record) -> std::string;
+
+  void flushLoop(const std::stop_token& stop);
+  /// @returns false on failure, errno tells why
+  auto writeAndSync(const std::string& bytes) -> bool;
+
+  std::string m_Path;
+  Options m_Options;
+  std::FILE* m_File{ nullptr }; ///< used by the flusher only
+
+  mutable std::mutex m_Mutex;
+  std::condition_variable_any m_RecordQueued;
+  std::condition_variable m_GroupSynced;
+  std::string m_Queue; ///< framed records of the group being formed
+  size_t m_NumQueued{ 0 };
+  uint64_t m_FormingGroup{ 1 };
+  uint64_t m_SyncedGroup{ 0 };
+  std::string m_Error; ///< set once a sync fails
+  Stats m_Stats;
+  /// last, so the flusher stops before the state it uses goes away
+  std::jthread m_Flusher;
+};
+
+} // namespace adun
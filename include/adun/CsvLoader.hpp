@@ -0,0 +1,62 @@
+#pragma once
+#include "adun/Exceptions.hpp"
+#include "adun/MappedFile.hpp"
+#include "adun/Table.hpp"
+#include "adun/ThreadPool.hpp"
+#include "adun/Value.hpp"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace adun {
+
+class CsvException : public DatabaseException {
+public:
+  explicit CsvException(const std::string& msg);
+};
+
+/// Bulk loads RFC 4180 CSV into a table. The first record names the
+/// columns, the ones it omits are filled with defaults and autoincrement,
+/// as are empty unquoted fields. Fields are converted straight to column
+/// types: integers, `true`/`false`/`1`/`0`, strings and hex bytes with
+/// optional `0x` prefix.
+///
+/// Input is split on record boundaries into chunks parsed in parallel on
+/// pool, then appended with a single constraint check: either every row
+/// is inserted or none.
+class CsvLoader {
+public:
+  /// Each load commits on its own
+  CsvLoader(Table& table, ThreadPool& pool);
+  /// Loads become part of write
+  CsvLoader(Table& table, Table::PendingWrite& write, ThreadPool& pool);
+
+  /// @returns number of inserted rows
+  auto loadFile(const std::string& path) -> size_t;
+  /// Same for a file the caller already mapped
+  auto loadFile(const MappedFile& file, const std::string& path)
+      -> size_t;
+  /// @returns number of inserted rows
+  auto load(std::string_view text) -> size_t;
+
+private:
+  using Rows = std::vector<std::vector<Value>>;
+
+  /// @returns end of the header record
+  auto parseHeader(std::string_view text) -> const char*;
+  auto parseChunk(const char* begin, const char* end) const -> Rows;
+  auto splitIntoChunks(const char* begin, const char* end) const
+      -> std::vector<const char*>;
+
+  /// Smaller chunks are not worth a task
+  static constexpr size_t s_MinChunkSize{ 1 << 20 };
+
+  Table& m_Table;
+  Table::PendingWrite* m_Write{ nullptr };
+  ThreadPool& m_Pool;
+  std::vector<size_t> m_FieldColumns; ///< column index of each field
+  std::vector<ValueType> m_FieldTypes;
+};
+
+} // namespace adun
@@ -1,29 +1,190 @@
 #pragma once
+#include "adun/CommitLog.hpp"
+#include "adun/Parser/CopyCommand.hpp"
 #include "adun/Parser/CreateCommand.hpp"
 #include "adun/Parser/DeleteCommand.hpp"
 #include "adun/Parser/InsertCommand.hpp"
 #include "adun/Parser/SelectCommand.hpp"
 #include "adun/Parser/UpdateCommand.hpp"
+#include "adun/QueryAwaitable.hpp"
+#include "adun/QueryCache.hpp"
+#include "adun/QueryMetrics.hpp"
 #include "adun/Result.hpp"
+#include "adun/RowWriter.hpp"
+#include "adun/Session.hpp"
+#include "adun/SlowQueryLog.hpp"
 #include "adun/Table.hpp"
+#include "adun/ThreadPool.hpp"
+#include "adun/Transaction.hpp"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <ostream>
+#include <shared_mutex>
+#include <span>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 namespace adun {
 
+/// Safe to use from multiple threads. Statements reading a table never
+/// block nor wait, ones writing it get it exclusively until their
+/// transaction ends, tables don't block each other.
+///
+/// Kept in memory only, unless opened with a commit log: every commit is
+/// logged to it and tables are recovered from it on the next open.
 class Database {
 public:
+  static constexpr std::chrono::milliseconds s_DefaultLockTimeout{
+    10'000
+  };
+
   Database() = default;
+  /// Recovers tables from the commit log at logPath, creating it if
+  /// missing, and logs every commit to it
+  /// @throws FileException if the log can't be opened or replayed
+  explicit Database(const std::string& logPath,
+                    CommitLog::Options logOptions = {});
 
+  /// Each statement commits on its own, use a Session for transactions
   auto execute(const std::string& query) -> Result;
 
+  /// Same as Session::executeScript on a session of its own, which rolls
+  /// back a transaction left open by the script
+  auto executeScript(std::string_view script) -> std::vector<Result>;
+
+  /// Runs query on the worker pool, committing on its own. Queries in
+  /// flight make progress concurrently. Don't wait for the future on a
+  /// pool thread, as every worker may end up waiting.
+  auto executeAsync(std::string query) -> std::future<Result>;
+  /// Same for coroutines, see QueryAwaitable
+  auto executeAwaitable(std::string query) -> QueryAwaitable;
+
+  /// Bulk loads CSV file with a header record into table, see CsvLoader.
+  /// Same as `COPY table FROM "path";`
+  /// @returns number of inserted rows
+  auto importCsv(const std::string& tableName, const std::string& path)
+      -> size_t;
+
+  /// Writes all rows of table into a CSV file with a header record,
+  /// readable by importCsv. Same as `COPY table TO "path";`
+  /// @returns number of written rows
+  auto exportCsv(const std::string& tableName, const std::string& path)
+      -> size_t;
+
+  /// Streams rows matched by a SELECT query into out as they are scanned,
+  /// without building a Result
+  /// @returns number of written rows
+  auto exportQuery(const std::string& selectQuery, std::ostream& out,
+                   ExportFormat format = ExportFormat::Csv) -> size_t;
+
+  [[nodiscard]] auto getQueryCacheStats() const -> QueryCache::Stats;
+  /// Group commit metrics, all zero without a commit log
+  [[nodiscard]] auto getCommitLogStats() const -> CommitLog::Stats;
+  /// Counts, rows and phase latencies of statements run by sessions so
+  /// far, per command kind. Statements redone on recovery don't count.
+  [[nodiscard]] auto getMetrics() const -> QueryMetrics::Snapshot;
+  /// Max number of cached parsed queries, 0 disables the cache
+  void setQueryCacheCapacity(size_t capacity);
+
+  /// Bytes of all tables and of rows staged by running statements
+  [[nodiscard]] auto getMemoryUsage() const -> size_t;
+  /// @throws CommandException if there is no such table
+  auto getMemoryUsage(const std::string& tableName) -> Table::MemoryUsage;
+  /// Statements that would make tables and staged rows exceed bytes fail
+  /// with MemoryLimitException and change nothing. 0 means no limit.
+  void setMemoryLimit(size_t bytes);
+  [[nodiscard]] auto getMemoryLimit() const -> size_t;
+
+  /// Records statements of sessions running for longer than
+  /// options.threshold, replacing the current slow query log
+  /// @throws FileException if options.path can't be opened
+  void setSlowQueryLog(SlowQueryLog::Options options);
+  void disableSlowQueryLog();
+  /// Oldest first, empty without a slow query log
+  [[nodiscard]] auto getSlowQueries() const
+      -> std::vector<SlowQueryLog::Entry>;
+
+  /// Counts hardware events of executing statements, see PerfCounters,
+  /// into the metrics, EXPLAIN ANALYZE and the slow query log. Off by
+  /// default, as reading the counters takes a syscall per phase.
+  void setHardwareCounters(bool enabled);
+  [[nodiscard]] auto getHardwareCounters() const -> bool;
+
+  /// How long a transaction waits for a table written by another one
+  /// before failing, which also breaks deadlocks
+  void setLockTimeout(std::chrono::milliseconds timeout);
+  [[nodiscard]] auto getLockTimeout() const -> std::chrono::milliseconds;
+
+  /// Statements running for longer, parsing and lock waits included,
+  /// fail with QueryCancelledException and change nothing, see
+  /// Session::setStatementTimeout. 0 means no timeout, the default.
+  void setStatementTimeout(std::chrono::milliseconds timeout);
+  [[nodiscard]] auto getStatementTimeout() const
+      -> std::chrono::milliseconds;
+
+  friend class Session;
+  friend class Transaction;
   friend class ast::CreateCommand;
-  friend class ast::InsertCommand;
-  friend class ast::SelectCommand;
-  friend class ast::UpdateCommand;
-  friend class ast::DeleteCommand;
+  friend class ast::CopyCommand;
 
 private:
+  /// Parses tokens or takes their command from the cache, runs it and
+  /// gives it back to the cache. Records sample, if given, with the
+  /// parse and run phases filled in, whether run throws or not.
+  /// @param literals if not empty, bound in place of those of tokens
+  /// @throws CommandException if literals don't match those of tokens
+  auto runCommand(const Ref<TokenList>& tokens,
+                  const std::function<Result(ast::Command&)>& run,
+                  QueryMetrics::Sample* sample = nullptr,
+                  std::span<const Value> literals = {}) -> Result;
+  /// Executes command in txn and logs it for redo if it writes
+  /// @param literals bound into command, see runCommand
+  auto executeCommand(ast::Command& command, const TokenList& tokens,
+                      Transaction& txn,
+                      std::span<const Value> literals = {}) -> Result;
+  void redo(const CommitLog::Record& record);
+  /// Records sample if it took long enough, command is null if the
+  /// statement failed to parse. Must run before command goes back to
+  /// the cache, where another thread may rebind it.
+  void logSlowQuery(ast::Command* command, const TokenList& tokens,
+                    const QueryMetrics::Sample& sample);
+
+  auto importCsv(Transaction& txn, const std::string& tableName,
+                 const std::string& path) -> size_t;
+  auto exportCsv(Transaction& txn, const std::string& tableName,
+                 const std::string& path) -> size_t;
+
+  auto getThreadPool() -> ThreadPool&;
+  /// Tables are never dropped, references stay valid without the lock
+  /// @pre m_CatalogMutex is locked
+  /// @throws CommandException if there is no such table
+  auto findTable(const std::string& name) -> Table&;
+
+  std::shared_mutex m_CatalogMutex; ///< guards m_Tables itself
+  MemoryTracker m_Memory; ///< parent of the tables, outlives them
   std::unordered_map<std::string, Table> m_Tables;
+  QueryCache m_QueryCache;
+  QueryMetrics m_Metrics;
+  /// max while disabled, checked before taking m_SlowQueryLogMutex
+  std::atomic<std::chrono::nanoseconds> m_SlowQueryThreshold{
+    std::chrono::nanoseconds::max()
+  };
+  std::atomic<bool> m_HardwareCounters{ false };
+  mutable std::mutex m_SlowQueryLogMutex;
+  Ref<SlowQueryLog> m_SlowQueryLog;
+  Unique<CommitLog> m_CommitLog; ///< set once recovered
+  std::atomic<std::chrono::milliseconds> m_LockTimeout{
+    s_DefaultLockTimeout
+  };
+  std::atomic<std::chrono::milliseconds> m_StatementTimeout{
+    std::chrono::milliseconds{ 0 }
+  };
+  std::once_flag m_ThreadPoolStarted;
+  Unique<ThreadPool> m_ThreadPool; ///< started on first use
 };
 
 } // namespace adun
@@ -23,4 +23,9 @@ public:
   explicit NoSuchColumnException(const std::string& name);
 };
 
+class FileException : public DatabaseException {
+public:
+  using DatabaseException::DatabaseException;
+};
+
 } // namespace adun
@@ -0,0 +1,29 @@
+#pragma once
+#include "adun/Exceptions.hpp"
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace adun {
+
+/// Read-only view of a whole file, memory mapped where the platform
+/// allows it
+class MappedFile {
+public:
+  explicit MappedFile(const std::string& path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&)                    = delete;
+  MappedFile(MappedFile&&)                         = delete;
+  auto operator=(const MappedFile&) -> MappedFile& = delete;
+  auto operator=(MappedFile&&) -> MappedFile&      = delete;
+
+  [[nodiscard]] auto getView() const -> std::string_view;
+
+private:
+  const char* m_Data{ nullptr };
+  size_t m_Size{ 0 };
+  std::string m_Buffer; ///< file contents when mapping is unavailable
+};
+
+} // namespace adun
@@ -0,0 +1,54 @@
+#pragma once
+#include "adun/Exceptions.hpp"
+#include <atomic>
+#include <cstddef>
+
+namespace adun {
+
+class MemoryLimitException : public DatabaseException {
+public:
+  using DatabaseException::DatabaseException;
+};
+
+/// Counts bytes in use and their peak. Charges propagate to the parent,
+/// so a tracker per table under one per database adds up to the whole.
+/// A limit makes reserve() fail cleanly before memory is allocated, the
+/// caller reverts what it started instead of the process running out.
+///
+/// Thread safe, counters are relaxed atomics.
+class MemoryTracker {
+public:
+  MemoryTracker() = default;
+  explicit MemoryTracker(MemoryTracker* parent);
+  /// Gives back what is still charged to the parent
+  ~MemoryTracker();
+
+  MemoryTracker(const MemoryTracker&)                    = delete;
+  MemoryTracker(MemoryTracker&&)                         = delete;
+  auto operator=(const MemoryTracker&) -> MemoryTracker& = delete;
+  auto operator=(MemoryTracker&&) -> MemoryTracker&      = delete;
+
+  /// @throws MemoryLimitException if this or a parent would exceed its
+  /// limit, nothing is charged then
+  void reserve(size_t bytes);
+  /// Same regardless of limits, for memory that is in use already
+  void charge(size_t bytes) noexcept;
+  void release(size_t bytes) noexcept;
+
+  [[nodiscard]] auto getUsed() const -> size_t;
+  [[nodiscard]] auto getPeak() const -> size_t;
+
+  /// 0 means no limit
+  void setLimit(size_t bytes);
+  [[nodiscard]] auto getLimit() const -> size_t;
+
+private:
+  void updatePeak(size_t used);
+
+  MemoryTracker* m_Parent{ nullptr };
+  std::atomic<size_t> m_Used{ 0 };
+  std::atomic<size_t> m_Peak{ 0 };
+  std::atomic<size_t> m_Limit{ 0 };
+};
+
+} // namespace adun
@@ -23,10 +23,15 @@ enum class NodeKind {
   SelectCommand,
   UpdateCommand,
   DeleteCommand,
+  CopyCommand,
+  TransactionCommand,
+  ExplainCommand,
   QueryASTRoot,
   NUM_NODES
 };
 
+/// Nodes are owned by an Arena and point to each other with plain
+/// pointers, see Parser
 class Node {
 protected:
   explicit Node(NodeKind kind)
@@ -0,0 +1,58 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace adun {
+
+/// Monotonic allocator owning every node of a single AST. Nodes refer to
+/// each other with plain pointers and are destroyed all at once together
+/// with the arena.
+class Arena {
+public:
+  Arena();
+  ~Arena();
+
+  Arena(const Arena&)                    = delete;
+  Arena(Arena&&)                         = delete;
+  auto operator=(const Arena&) -> Arena& = delete;
+  auto operator=(Arena&&) -> Arena&      = delete;
+
+  template <typename T, typename... Args>
+  auto create(Args&&... args) -> T* {
+    void* memory{ allocate(sizeof(T), alignof(T)) };
+    auto* object{ new (memory) T(std::forward<Args>(args)...) };
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      registerFinalizer(object, [](void* ptr) {
+        static_cast<T*>(ptr)->~T();
+      });
+    }
+    return object;
+  }
+
+  [[nodiscard]] auto getBytesUsed() const -> size_t;
+
+private:
+  struct Finalizer {
+    void (*destroy)(void*);
+    void* object;
+    Finalizer* next;
+  };
+
+  auto allocate(size_t size, size_t alignment) -> void*;
+  void registerFinalizer(void* object, void (*destroy)(void*));
+
+  /// Enough for a typical short query without touching the heap
+  static constexpr size_t s_InlineBufferSize{ 1024 };
+
+  alignas(std::max_align_t)
+      std::array<std::byte, s_InlineBufferSize> m_InlineBuffer;
+  std::pmr::monotonic_buffer_resource m_Resource;
+  Finalizer* m_Finalizers{ nullptr };
+  size_t m_BytesUsed{ 0 };
+};
+
+} // namespace adun
@@ -12,8 +12,7 @@ class BinOpException : public DatabaseException {
 
 class BinOpExpr final : public ExpressionNode {
 public:
-  BinOpExpr(Ref<ExpressionNode> lhs, Ref<ExpressionNode> rhs,
-            TokenKind op);
+  BinOpExpr(ExpressionNode* lhs, ExpressionNode* rhs, TokenKind op);
 
   [[nodiscard]] auto evaluate(
       const Row& row,
@@ -59,9 +58,16 @@ public:
     return {};
   }
 
+  [[nodiscard]] auto toString() const -> std::string override;
+
+  void bindLiterals(std::span<const Value> literals) override {
+    m_Lhs->bindLiterals(literals);
+    m_Rhs->bindLiterals(literals);
+  }
+
   [[nodiscard]] auto getOp() const -> TokenKind;
-  [[nodiscard]] auto getLhs() -> Ref<ExpressionNode>;
-  [[nodiscard]] auto getRhs() -> Ref<ExpressionNode>;
+  [[nodiscard]] auto getLhs() -> ExpressionNode*;
+  [[nodiscard]] auto getRhs() -> ExpressionNode*;
   [[nodiscard]] constexpr auto isArithmetic() const -> bool {
     /// @todo bitwise operators
     return m_Op == TokenKind::Plus || m_Op == TokenKind::Minus ||
@@ -71,8 +77,8 @@ public:
 
 private:
   TokenKind m_Op;
-  Ref<ExpressionNode> m_Lhs;
-  Ref<ExpressionNode> m_Rhs;
+  ExpressionNode* m_Lhs;
+  ExpressionNode* m_Rhs;
 };
 
 } // namespace adun::ast
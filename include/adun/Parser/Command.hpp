@@ -1,10 +1,13 @@
 #pragma once
 #include "adun/Parser/ASTNode.hpp"
 #include "adun/Result.hpp"
+#include "adun/Value.hpp"
+#include <span>
 #include <stdexcept>
 
 namespace adun {
-class Database;
+class QueryPlan;
+class Transaction;
 
 class CommandException : public std::runtime_error {
 public:
@@ -17,7 +20,25 @@ class Command : public Node {
 public:
   using Node::Node;
 
-  virtual auto execute(Database& db) -> Result = 0;
+  virtual auto execute(Transaction& txn) -> Result = 0;
+
+  /// Adds the stages execute() goes through to plan, in order, which
+  /// execute() profiles by index, see Transaction::profileStage
+  /// @throws CommandException if the command can't be explained
+  virtual void explain(Transaction& /*txn*/, QueryPlan& /*plan*/) {
+    throw CommandException{
+      "Only SELECT, INSERT, UPDATE and DELETE can be explained"
+    };
+  }
+
+  /// Rebinds a cached command to literals of a query with the same
+  /// normalized text, see QueryCache
+  /// @throws CommandException if the command takes no parameters
+  virtual void bindLiterals(std::span<const Value> literals) {
+    if (!literals.empty()) {
+      throw CommandException{ "Statement takes no parameters" };
+    }
+  }
 };
 
 } // namespace ast
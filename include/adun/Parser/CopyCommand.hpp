@@ -0,0 +1,30 @@
+#pragma once
+#include "adun/Parser/Command.hpp"
+#include <string>
+
+namespace adun::ast {
+
+class CopyCommand final : public Command {
+public:
+  enum class Direction {
+    FromFile,
+    ToFile,
+  };
+
+  CopyCommand(std::string tableName, Direction direction,
+              std::string path)
+      : Command{ NodeKind::CopyCommand },
+        m_TableName{ std::move(tableName) },
+        m_Direction{ direction },
+        m_Path{ std::move(path) } {
+  }
+
+  auto execute(Transaction& txn) -> Result override;
+
+private:
+  std::string m_TableName;
+  Direction m_Direction;
+  std::string m_Path;
+};
+
+} // namespace adun::ast
@@ -13,7 +13,7 @@ public:
         m_Scheme{ std::move(scheme) } {
   }
 
-  auto execute(Database& db) -> Result override;
+  auto execute(Transaction& txn) -> Result override;
 
 private:
   std::string m_TableName;
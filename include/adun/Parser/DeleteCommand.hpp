@@ -7,17 +7,28 @@ namespace adun::ast {
 
 class DeleteCommand final : public Command {
 public:
-  DeleteCommand(std::string tableName, Ref<ExpressionNode> condition)
+  DeleteCommand(std::string tableName, ExpressionNode* condition)
       : Command{ NodeKind::DeleteCommand },
         m_TableName{ std::move(tableName) },
-        m_Condition{ std::move(condition) } {
+        m_Condition{ condition } {
   }
 
-  auto execute(Database& db) -> Result override;
+  auto execute(Transaction& txn) -> Result override;
+  void explain(Transaction& txn, QueryPlan& plan) override;
+
+  void bindLiterals(std::span<const Value> literals) override {
+    m_Condition->bindLiterals(literals);
+  }
 
 private:
+  /// Stages added by explain()
+  enum Stage : size_t {
+    LockStage,
+    WriteStage,
+  };
+
   std::string m_TableName;
-  Ref<ExpressionNode> m_Condition;
+  ExpressionNode* m_Condition;
 };
 
 } // namespace adun::ast
@@ -0,0 +1,35 @@
+#pragma once
+#include "adun/Parser/Command.hpp"
+
+namespace adun::ast {
+
+/// `EXPLAIN [ANALYZE] <statement>`, results in one "plan" column with a
+/// row per line of the plan. ANALYZE executes the statement for real,
+/// including its changes, and adds measured counters of each stage.
+class ExplainCommand final : public Command {
+public:
+  ExplainCommand(Command* command, bool analyze)
+      : Command{ NodeKind::ExplainCommand },
+        m_Command{ command },
+        m_Analyze{ analyze } {
+  }
+
+  auto execute(Transaction& txn) -> Result override;
+
+  void bindLiterals(std::span<const Value> literals) override {
+    m_Command->bindLiterals(literals);
+  }
+
+  [[nodiscard]] auto isAnalyze() const -> bool {
+    return m_Analyze;
+  }
+  [[nodiscard]] auto getCommand() const -> const Command& {
+    return *m_Command;
+  }
+
+private:
+  Command* m_Command;
+  bool m_Analyze;
+};
+
+} // namespace adun::ast
@@ -1,6 +1,7 @@
 #pragma once
 #include "adun/Parser/ASTNode.hpp"
 #include "adun/Value.hpp"
+#include <span>
 
 namespace adun {
 
@@ -20,6 +21,14 @@ public:
       const std::unordered_map<std::string, size_t>& columns) const
       -> Value = 0;
 
+  /// Expression in query syntax, fully parenthesized
+  [[nodiscard]] virtual auto toString() const -> std::string = 0;
+
+  /// Replaces values of literal nodes with ones from the new query,
+  /// indexed by literal position in the token stream (see QueryCache)
+  virtual void bindLiterals(std::span<const Value> /*literals*/) {
+  }
+
   [[nodiscard]] auto isTypeResolved() const -> bool;
 
   [[nodiscard]] auto getType() const -> ValueType;
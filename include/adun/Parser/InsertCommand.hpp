@@ -1,22 +1,43 @@
 #pragma once
+#include "adun/Assert.hpp"
 #include "adun/Parser/Command.hpp"
+#include "adun/Table.hpp"
 
 namespace adun::ast {
 
 class InsertCommand final : public Command {
 public:
   InsertCommand(std::string tableName,
-                std::vector<std::pair<std::string, Value>> values)
+                std::vector<Table::Assignments> rows)
       : Command{ NodeKind::InsertCommand },
         m_TableName{ std::move(tableName) },
-        m_Values{ std::move(values) } {
+        m_Rows{ std::move(rows) } {
   }
 
-  auto execute(Database& db) -> Result override;
+  auto execute(Transaction& txn) -> Result override;
+  void explain(Transaction& txn, QueryPlan& plan) override;
+
+  /// Every assigned value is a literal, in token order
+  void bindLiterals(std::span<const Value> literals) override {
+    auto literal{ literals.begin() };
+    for (auto& assignments : m_Rows) {
+      for (auto& [_, value] : assignments) {
+        adun_assert(literal != literals.end(), "Literal count mismatch");
+        value = *literal++;
+      }
+    }
+  }
 
 private:
+  /// Stages added by explain()
+  enum Stage : size_t {
+    PrepareStage,
+    LockStage,
+    InsertStage,
+  };
+
   std::string m_TableName;
-  std::vector<std::pair<std::string, Value>> m_Values;
+  std::vector<Table::Assignments> m_Rows;
 };
 
 } // namespace adun::ast
@@ -2,12 +2,13 @@
 #include "adun/Exceptions.hpp"
 #include "adun/Parser/Token.hpp"
 #include "adun/Parser/Utils.hpp"
-#include <list>
 #include <stdexcept>
+#include <string_view>
+#include <vector>
 
 namespace adun {
 
-using TokenList = std::list<Token>;
+using TokenList = std::vector<Token>;
 
 class LexerFatalError : public DatabaseException {
 public:
@@ -17,13 +18,25 @@ public:
 class Lexer {
 public:
   Lexer();
-  void lex(const std::string& query);
+  /// Appends tokens of query, which must outlive them
+  void lex(std::string_view query);
+
+  /// Starts incremental lexing of a multi-statement script, which must
+  /// outlive its tokens
+  void startScript(std::string_view script);
+  /// Replaces tokens with the next statement of the script, up to and
+  /// including its ';', followed by Eof
+  /// @returns false if there are no more statements
+  auto lexNextStatement() -> bool;
 
   [[nodiscard]] auto getTokens() const -> Ref<TokenList> {
     return m_Tokens;
   }
 
 private:
+  /// @returns position after the last consumed character
+  auto lexUntil(SourceIt pos, bool stopAfterSemicolon) -> SourceIt;
+
   auto lexNumericLiteral(SourceIt& pos) -> bool;
   auto lexIdentifier(SourceIt& pos) -> bool;
   auto lexStringLiteral(SourceIt& pos) -> bool;
@@ -33,11 +46,14 @@ private:
   void skipSpacesSince(SourceIt& pos);
 
   auto consumeIdent(SourceIt& pos) -> std::string_view;
-  [[nodiscard]] auto nearEnd(const SourceIt& pos) const -> bool;
+  [[nodiscard]] auto atEnd(const SourceIt& pos) const -> bool;
 
   Ref<TokenList> m_Tokens;
-  size_t m_QueryLength;
-  SourceIt m_QueryStart;
+  SourceIt m_QueryEnd{ nullptr };
+  SourceIt m_ScriptPos{ nullptr };
 };
 
+/// Source text spanned by tokens, from the first one up to Eof
+auto getSourceText(const TokenList& tokens) -> std::string_view;
+
 } // namespace adun
@@ -1,12 +1,16 @@
 #pragma once
 #include "adun/Exceptions.hpp"
 #include "adun/Parser/ASTNode.hpp"
+#include "adun/Parser/Arena.hpp"
+#include "adun/Parser/CopyCommand.hpp"
 #include "adun/Parser/CreateCommand.hpp"
 #include "adun/Parser/DeleteCommand.hpp"
+#include "adun/Parser/ExplainCommand.hpp"
 #include "adun/Parser/ExpressionNode.hpp"
 #include "adun/Parser/InsertCommand.hpp"
 #include "adun/Parser/Lexer.hpp"
 #include "adun/Parser/SelectCommand.hpp"
+#include "adun/Parser/TransactionCommand.hpp"
 #include "adun/Parser/UpdateCommand.hpp"
 #include "adun/Parser/ValueExpr.hpp"
 #include "adun/Value.hpp"
@@ -16,28 +20,32 @@ namespace adun {
 
 class Parser {
 public:
-  explicit Parser(const Ref<TokenList>& tokenList)
+  /// Nodes are allocated in arena, which must outlive the AST
+  Parser(const Ref<TokenList>& tokenList, Arena& arena)
       : m_Tokens{ tokenList },
         m_CurTokIter{ tokenList->begin() },
-        m_ASTRoot{ nullptr } {
+        m_Arena{ arena } {
   }
 
-  auto buildAST() -> Ref<ast::Command>;
+  auto buildAST() -> ast::Command*;
 
 private:
-  auto parseCreateCommand() -> Unique<ast::CreateCommand>;
-  auto parseInsertCommand() -> Unique<ast::InsertCommand>;
-  auto parseSelectCommand() -> Unique<ast::SelectCommand>;
-  auto parseUpdateCommand() -> Unique<ast::UpdateCommand>;
-  auto parseDeleteCommand() -> Unique<ast::DeleteCommand>;
-  auto parseValueExpr() -> Unique<ast::ValueExpr>;
-  auto parseParenExpr() -> Unique<ast::ExpressionNode>;
-  auto parseIdentifierExpr() -> Unique<ast::ExpressionNode>;
-  auto parseCompoundExpression() -> Unique<ast::ExpressionNode>;
-  auto parseExpression() -> Unique<ast::ExpressionNode>;
-  auto parseBinOpRhs(Unique<ast::ExpressionNode> lhs,
-                     int32_t prevPrecedence = 0)
-      -> Unique<ast::ExpressionNode>;
+  auto parseCreateCommand() -> ast::CreateCommand*;
+  auto parseInsertCommand() -> ast::InsertCommand*;
+  auto parseSelectCommand() -> ast::SelectCommand*;
+  auto parseUpdateCommand() -> ast::UpdateCommand*;
+  auto parseDeleteCommand() -> ast::DeleteCommand*;
+  auto parseCopyCommand() -> ast::CopyCommand*;
+  auto parseTransactionCommand() -> ast::TransactionCommand*;
+  auto parseExplainCommand() -> ast::ExplainCommand*;
+  auto parseLiteral() -> Value;
+  auto parseValueExpr() -> ast::ValueExpr*;
+  auto parseParenExpr() -> ast::ExpressionNode*;
+  auto parseIdentifierExpr() -> ast::ExpressionNode*;
+  auto parseCompoundExpression() -> ast::ExpressionNode*;
+  auto parseExpression() -> ast::ExpressionNode*;
+  auto parseBinOpRhs(ast::ExpressionNode* lhs, int32_t prevPrecedence = 0)
+      -> ast::ExpressionNode*;
   auto parseTypename() -> ValueType;
   auto parseScheme() -> Table::Scheme;
   auto parseColumnNames() -> std::vector<std::string>;
@@ -60,7 +68,9 @@ private:
 
   Ref<TokenList> m_Tokens;
   TokenList::const_iterator m_CurTokIter;
-  Ref<ast::Command> m_ASTRoot;
+  Arena& m_Arena;
+  ast::Command* m_ASTRoot{ nullptr };
+  size_t m_NumLiterals{ 0 }; ///< literal tokens consumed so far
 };
 
 } // namespace adun
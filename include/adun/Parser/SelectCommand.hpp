@@ -3,25 +3,44 @@
 #include "adun/Parser/Command.hpp"
 #include "adun/Parser/ExpressionNode.hpp"
 #include "adun/Parser/Utils.hpp"
+#include "adun/RowWriter.hpp"
+#include "adun/Table.hpp"
 
 namespace adun::ast {
 
 class SelectCommand final : public Command {
 public:
   SelectCommand(std::vector<std::string> columns, std::string tableName,
-                Ref<ExpressionNode> condition)
+                ExpressionNode* condition)
       : Command{ NodeKind::SelectCommand },
         m_Columns{ std::move(columns) },
         m_TableName{ std::move(tableName) },
-        m_Condition{ std::move(condition) } {
+        m_Condition{ condition } {
   }
 
-  auto execute(Database& db) -> Result override;
+  auto execute(Transaction& txn) -> Result override;
+  void explain(Transaction& txn, QueryPlan& plan) override;
+
+  /// Streams matching rows into writer straight from the table scan,
+  /// wildcard columns come in column index order
+  /// @returns number of written rows
+  auto exportRows(Transaction& txn, RowWriter& writer) -> size_t;
+
+  void bindLiterals(std::span<const Value> literals) override {
+    m_Condition->bindLiterals(literals);
+  }
 
 private:
+  /// Stages added by explain()
+  enum Stage : size_t {
+    ScanStage,
+  };
+
+  auto makeFilter(const Table& table) const -> Selector;
+
   std::vector<std::string> m_Columns;
   std::string m_TableName;
-  Ref<ExpressionNode> m_Condition;
+  ExpressionNode* m_Condition;
 };
 
 } // namespace adun::ast
@@ -1,18 +1,20 @@
 #pragma once
 #include "adun/Parser/Utils.hpp"
 #include "adun/Value.hpp"
+#include <cstdint>
 #include <cul/cul.hpp>
 #include <string_view>
-#include <variant>
 
 namespace adun {
 
-enum class TokenKind {
+enum class TokenKind : uint8_t {
 #define TOK(t) t, // NOLINT
 #include "adun/Parser/Tokens.def"
   NUM_TOKENS
 };
 
+/// Compact view into the query text, literal values are decoded from the
+/// source on demand
 class Token {
 public:
   Token(TokenKind kind, SourceIt loc, size_t length);
@@ -33,29 +35,26 @@ public:
     return is(tk) || isOneOf(other...);
   }
 
+  /// Tokens parsed into a ValueExpr, see getLiteralValue()
+  [[nodiscard]] inline auto isLiteral() const -> bool {
+    return isOneOf(TokenKind::NumericLiteral, TokenKind::StringLiteral,
+                   TokenKind::HexLiteral, TokenKind::KW_true,
+                   TokenKind::KW_false, TokenKind::KW_null);
+  }
+
   [[nodiscard]] auto getKind() const -> TokenKind;
   void setKind(TokenKind kind);
 
   [[nodiscard]] auto getStringView() const -> std::string_view;
   [[nodiscard]] auto getLength() const -> size_t;
 
-  template <typename T>
-  void setLiteralValue(T&& value) {
-    m_LiteralValue = Value{ std::forward<T>(value) };
-  }
-
-  template <typename Func>
-  auto visitLiteralValue(Func&& func) const {
-    return std::visit(std::forward<Func>(func), m_LiteralValue);
-  }
+  /// Decodes the literal, query text must be still alive
+  /// @pre isLiteral()
+  [[nodiscard]] auto getLiteralValue() const -> Value;
 
   template <typename T>
   auto getLiteralValue() const -> T {
-    return m_LiteralValue.get<T>();
-  }
-
-  [[nodiscard]] auto getLiteralValue() const -> Value {
-    return m_LiteralValue;
+    return getLiteralValue().get<T>();
   }
 
   // clang-format off
@@ -71,10 +70,15 @@ public:
   // clang-format on
 
 private:
-  TokenKind m_Kind;
-  size_t m_Length;
   SourceIt m_Loc;
-  Value m_LiteralValue;
+  uint32_t m_Length;
+  TokenKind m_Kind;
 };
 
+/// @returns text of a punctuator token, empty for other kinds
+auto getPunctuatorSpelling(TokenKind kind) -> std::string_view;
+
+static_assert(static_cast<size_t>(TokenKind::NUM_TOKENS) <= UINT8_MAX);
+static_assert(std::is_trivially_copyable_v<Token>);
+
 } // namespace adun
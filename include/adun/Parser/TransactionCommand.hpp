@@ -0,0 +1,32 @@
+#pragma once
+#include "adun/Parser/Command.hpp"
+
+namespace adun::ast {
+
+/// BEGIN, COMMIT or ROLLBACK, carried out by Session
+class TransactionCommand final : public Command {
+public:
+  enum class Action {
+    Begin,
+    Commit,
+    Rollback,
+  };
+
+  explicit TransactionCommand(Action action)
+      : Command{ NodeKind::TransactionCommand },
+        m_Action{ action } {
+  }
+
+  /// @throws CommandException always, a statement can't end the
+  /// transaction it runs in
+  auto execute(Transaction& txn) -> Result override;
+
+  [[nodiscard]] auto getAction() const -> Action {
+    return m_Action;
+  }
+
+private:
+  Action m_Action;
+};
+
+} // namespace adun::ast
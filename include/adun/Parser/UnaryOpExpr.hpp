@@ -12,7 +12,7 @@ class UnaryOpException : public DatabaseException {
 
 class UnaryOpExpr final : public ExpressionNode {
 public:
-  UnaryOpExpr(Ref<ExpressionNode> operand, TokenKind op);
+  UnaryOpExpr(ExpressionNode* operand, TokenKind op);
 
   [[nodiscard]] auto evaluate(
       const Row& row,
@@ -34,12 +34,18 @@ public:
     return {};
   }
 
+  [[nodiscard]] auto toString() const -> std::string override;
+
+  void bindLiterals(std::span<const Value> literals) override {
+    m_Operand->bindLiterals(literals);
+  }
+
   [[nodiscard]] auto getOp() const -> TokenKind;
-  [[nodiscard]] auto getOperand() -> Ref<ExpressionNode>;
+  [[nodiscard]] auto getOperand() -> ExpressionNode*;
 
 private:
   TokenKind m_Op;
-  Ref<ExpressionNode> m_Operand;
+  ExpressionNode* m_Operand;
 };
 
 } // namespace adun::ast
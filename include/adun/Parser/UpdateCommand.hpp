@@ -9,20 +9,34 @@ class UpdateCommand final : public Command {
 public:
   UpdateCommand(
       std::string tableName,
-      std::vector<std::pair<std::string, Ref<ExpressionNode>>> values,
-      Ref<ExpressionNode> condition)
+      std::vector<std::pair<std::string, ExpressionNode*>> values,
+      ExpressionNode* condition)
       : Command{ NodeKind::UpdateCommand },
         m_TableName{ std::move(tableName) },
         m_Values{ std::move(values) },
-        m_Condition{ std::move(condition) } {
+        m_Condition{ condition } {
   }
 
-  auto execute(Database& db) -> Result override;
+  auto execute(Transaction& txn) -> Result override;
+  void explain(Transaction& txn, QueryPlan& plan) override;
+
+  void bindLiterals(std::span<const Value> literals) override {
+    for (auto& [_, expr] : m_Values) {
+      expr->bindLiterals(literals);
+    }
+    m_Condition->bindLiterals(literals);
+  }
 
 private:
+  /// Stages added by explain()
+  enum Stage : size_t {
+    LockStage,
+    WriteStage,
+  };
+
   std::string m_TableName;
-  std::vector<std::pair<std::string, Ref<ExpressionNode>>> m_Values;
-  Ref<ExpressionNode> m_Condition;
+  std::vector<std::pair<std::string, ExpressionNode*>> m_Values;
+  ExpressionNode* m_Condition;
 };
 
 } // namespace adun::ast
@@ -7,7 +7,8 @@
 
 namespace adun {
 
-using SourceIt = std::string::const_iterator;
+/// Tokens point straight into the query text, which must outlive them
+using SourceIt = const char*;
 
 template <typename T>
 using Ref = std::shared_ptr<T>;
@@ -1,13 +1,16 @@
 #pragma once
 #include "adun/Parser/ExpressionNode.hpp"
+#include <optional>
 
 namespace adun::ast {
 
 class ValueExpr final : public ExpressionNode {
 public:
-  explicit ValueExpr(Value value)
+  explicit ValueExpr(Value value,
+                     std::optional<size_t> literalIndex = std::nullopt)
       : ExpressionNode{ NodeKind::NumberExpr, value.getType() },
-        m_Value{ std::move(value) } {
+        m_Value{ std::move(value) },
+        m_LiteralIndex{ literalIndex } {
   }
 
   [[nodiscard]] auto evaluate(
@@ -17,12 +20,23 @@ public:
     return m_Value;
   }
 
+  [[nodiscard]] auto toString() const -> std::string override;
+
+  void bindLiterals(std::span<const Value> literals) override {
+    // implicit values (e.g. missing WHERE) are not backed by a token
+    if (m_LiteralIndex.has_value()) {
+      m_Value = literals[*m_LiteralIndex];
+      m_Type  = m_Value.getType();
+    }
+  }
+
   [[nodiscard]] auto getValue() const -> Value {
     return m_Value;
   }
 
 private:
   Value m_Value;
+  std::optional<size_t> m_LiteralIndex;
 };
 
 } // namespace adun::ast
@@ -24,6 +24,10 @@ public:
     return row.get(columns.at(m_Name));
   }
 
+  [[nodiscard]] auto toString() const -> std::string override {
+    return m_Name;
+  }
+
   [[nodiscard]] auto getVarName() const -> std::string {
     return m_Name;
   }
@@ -0,0 +1,76 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace adun {
+
+/// Hardware counters of the calling thread in user space, through Linux
+/// perf_event_open. Events the CPU, the hypervisor or perf_event_paranoid
+/// don't allow are left out, so counting degrades to fewer events or
+/// none at all instead of failing.
+///
+/// Counters run from opening on; a phase is measured as the difference
+/// of two reads.
+class PerfCounters {
+public:
+  enum class Event : uint8_t {
+    Cycles,
+    Instructions,
+    CacheMisses, ///< last level cache
+    BranchMisses,
+    NUM_EVENTS
+  };
+  static constexpr auto s_NumEvents{ static_cast<size_t>(
+      Event::NUM_EVENTS) };
+
+  struct Values {
+    std::array<uint64_t, s_NumEvents> counts{};
+    uint8_t available{ 0 }; ///< bit per event
+
+    [[nodiscard]] auto has(Event event) const -> bool;
+    [[nodiscard]] auto get(Event event) const -> uint64_t;
+    /// Instructions per cycle, 0 unless both are available
+    [[nodiscard]] auto getIpc() const -> double;
+    /// Available events as "name=count", with the IPC
+    [[nodiscard]] auto toString() const -> std::string;
+
+    auto operator+=(const Values& other) -> Values&;
+    /// Counts of the events available in both
+    auto operator-(const Values& other) const -> Values;
+  };
+
+  /// Opens counters of the calling thread
+  PerfCounters();
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters&)                    = delete;
+  PerfCounters(PerfCounters&&)                         = delete;
+  auto operator=(const PerfCounters&) -> PerfCounters& = delete;
+  auto operator=(PerfCounters&&) -> PerfCounters&      = delete;
+
+  /// Opened on first use in each thread and kept open, as opening takes
+  /// a syscall per event
+  static auto forThisThread() -> PerfCounters&;
+  static auto getEventName(Event event) -> std::string_view;
+
+  [[nodiscard]] auto isAvailable() const -> bool;
+  /// Why events were left out, empty if none was
+  [[nodiscard]] auto getError() const -> const std::string&;
+
+  /// Totals since opening, scaled up if the kernel multiplexed the
+  /// counters with other users
+  [[nodiscard]] auto read() const -> Values;
+
+private:
+  int m_Leader{ -1 }; ///< group read at once
+  /// Events in group order
+  std::array<Event, s_NumEvents> m_Events{};
+  size_t m_NumEvents{ 0 };
+  std::array<int, s_NumEvents> m_Fds{};
+  std::string m_Error;
+};
+
+} // namespace adun
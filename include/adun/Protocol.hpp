@@ -0,0 +1,122 @@
+#pragma once
+#include "adun/Exceptions.hpp"
+#include "adun/Value.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace adun::protocol {
+
+/// Messages between Client and Server are frames of a u32 payload
+/// length followed by the payload: u8 MessageType and its fields.
+/// Integers are little endian, strings are u32 length prefixed and
+/// values are encoded as in ExportFormat::Binary rows.
+///
+/// A client sends requests, the server answers each in order with
+/// zero or more Columns and RowBatch messages ended by exactly one of
+/// Complete, Prepared or Error. Clients may send requests before the
+/// earlier ones are answered, the server runs them in order.
+enum class MessageType : uint8_t {
+  /// string statement
+  Query = 1,
+  /// string statement, whose literals become its parameters
+  Prepare,
+  /// u32 statement id, u32 count, values of the parameters in order
+  Execute,
+  /// u32 statement id
+  CloseStatement,
+
+  /// u32 count, string names of the result columns
+  Columns = 0x81,
+  /// u32 count, then the column of each result column in order, see
+  /// MessageWriter::writeColumn
+  RowBatch,
+  /// u64 affected rows, u64 rows sent
+  Complete,
+  /// u32 statement id, u32 parameter count
+  Prepared,
+  /// u8 ErrorCode, string message
+  Error,
+};
+
+enum class ErrorCode : uint8_t {
+  Statement = 1, ///< the statement failed, the connection goes on
+  Cancelled,     ///< see QueryCancelledException
+  Protocol,      ///< malformed request, the server closes the connection
+};
+
+class ProtocolException : public DatabaseException {
+public:
+  using DatabaseException::DatabaseException;
+};
+
+static constexpr size_t s_HeaderSize{ sizeof(uint32_t) };
+static constexpr size_t s_MaxMessageSize{ size_t{ 64 } << 20U };
+
+/// @returns bytes of the first frame of buffer, header included, 0 if it
+/// is not complete yet
+/// @throws ProtocolException if the frame is longer than maxSize
+auto getFrameSize(std::string_view buffer,
+                  size_t maxSize = s_MaxMessageSize) -> size_t;
+
+/// Appends a frame to out, its length is filled in on destruction
+class MessageWriter {
+public:
+  MessageWriter(std::string& out, MessageType type);
+  ~MessageWriter();
+
+  MessageWriter(const MessageWriter&)                    = delete;
+  MessageWriter(MessageWriter&&)                         = delete;
+  auto operator=(const MessageWriter&) -> MessageWriter& = delete;
+  auto operator=(MessageWriter&&) -> MessageWriter&      = delete;
+
+  void writeU8(uint8_t value);
+  void writeU32(uint32_t value);
+  void writeU64(uint64_t value);
+  void writeString(std::string_view value);
+  void writeValue(const Value& value);
+  /// u8 ValueType of all values, a bitmap of the nulls, bit i of byte
+  /// i / 8 for values[i], and the others without their type. Columns of
+  /// mixed or no type are ValueType::None followed by each value.
+  void writeColumn(std::span<const Value* const> values);
+
+private:
+  template <typename T>
+  void writeInt(T value);
+  void writeUntyped(const Value& value);
+
+  std::string& m_Out;
+  size_t m_Start;
+};
+
+/// Reads fields of one frame in order
+/// @throws ProtocolException from each read if the frame ends early
+class MessageReader {
+public:
+  /// @param frame as sized by getFrameSize, header included
+  explicit MessageReader(std::string_view frame);
+
+  [[nodiscard]] auto getType() const -> MessageType;
+
+  auto readU8() -> uint8_t;
+  auto readU32() -> uint32_t;
+  auto readU64() -> uint64_t;
+  /// Points into the frame
+  auto readString() -> std::string_view;
+  auto readValue() -> Value;
+  auto readColumn(size_t count) -> std::vector<Value>;
+
+private:
+  template <typename T>
+  auto readInt() -> T;
+  auto readUntyped(ValueType type) -> Value;
+  auto take(size_t size) -> std::string_view;
+
+  std::string_view m_Payload;
+  MessageType m_Type;
+};
+
+} // namespace adun::protocol
@@ -0,0 +1,54 @@
+#pragma once
+#include "adun/Result.hpp"
+#include "adun/ThreadPool.hpp"
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <utility>
+
+namespace adun {
+
+/// `co_await`-able query. Suspending runs the query on a worker of pool
+/// and the awaiting coroutine is resumed on that worker once it is done,
+/// so the thread that awaited is free meanwhile. Exceptions of the query
+/// are rethrown from co_await.
+class QueryAwaitable {
+public:
+  QueryAwaitable(ThreadPool& pool, std::function<Result()> query)
+      : m_Pool{ pool },
+        m_Query{ std::move(query) } {
+  }
+
+  [[nodiscard]] auto await_ready() const noexcept -> bool {
+    return false;
+  }
+
+  void await_suspend(std::coroutine_handle<> awaiting) {
+    // the coroutine may be resumed before this returns, so nothing here
+    // touches the awaitable after posting
+    m_Pool.post([this, awaiting] {
+      try {
+        m_Result.emplace(m_Query());
+      } catch (...) {
+        m_Error = std::current_exception();
+      }
+      awaiting.resume();
+    });
+  }
+
+  auto await_resume() -> Result {
+    if (m_Error) {
+      std::rethrow_exception(m_Error);
+    }
+    return std::move(*m_Result);
+  }
+
+private:
+  ThreadPool& m_Pool;
+  std::function<Result()> m_Query;
+  std::optional<Result> m_Result;
+  std::exception_ptr m_Error;
+};
+
+} // namespace adun
@@ -0,0 +1,93 @@
+#pragma once
+#include "adun/Parser/Arena.hpp"
+#include "adun/Parser/Command.hpp"
+#include "adun/Parser/Lexer.hpp"
+#include "adun/Parser/Utils.hpp"
+#include "adun/Value.hpp"
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace adun {
+
+/// LRU cache of parsed commands keyed by query text with literals
+/// normalized out, so `SELECT * FROM t WHERE id = 1;` and
+/// `select * from t where id = 2;` share one entry. On a hit the cached
+/// AST is rebound to literals of the new query instead of being reparsed.
+///
+/// Thread safe. Binding literals modifies the AST, so a hit takes the
+/// entry out of the cache and the caller owns it until it is inserted
+/// back; concurrent queries of the same shape parse their own copy.
+class QueryCache {
+public:
+  static constexpr size_t s_DefaultCapacity{ 256 };
+  /// Bulk inserts rarely repeat with the same shape, don't cache them
+  static constexpr size_t s_MaxCachedLiterals{ 1024 };
+
+  struct Stats {
+    size_t hits{ 0 };
+    size_t misses{ 0 };
+    size_t evictions{ 0 };
+    size_t entries{ 0 };
+    size_t memoryBytes{ 0 }; ///< keys and AST arenas
+  };
+
+  struct NormalizedQuery {
+    std::string key;
+    size_t numLiterals{ 0 };
+  };
+
+  struct CachedCommand {
+    Unique<Arena> arena;
+    ast::Command* command; ///< root of the AST owned by arena
+  };
+
+  explicit QueryCache(size_t capacity = s_DefaultCapacity);
+
+  static auto normalize(const TokenList& tokens) -> NormalizedQuery;
+
+  /// Removes the matching entry and binds it to literals of tokens, which
+  /// are decoded only on a hit. Give it back with insert.
+  auto take(const NormalizedQuery& query, const TokenList& tokens)
+      -> std::optional<CachedCommand>;
+  /// Binds literals instead, one per literal of the query in order
+  auto take(const NormalizedQuery& query, std::span<const Value> literals)
+      -> std::optional<CachedCommand>;
+  /// @param command root of the AST owned by arena
+  void insert(NormalizedQuery query, Unique<Arena> arena,
+              ast::Command* command);
+
+  /// 0 disables caching
+  void setCapacity(size_t capacity);
+  void clear();
+
+  [[nodiscard]] auto getStats() const -> Stats;
+
+private:
+  struct Entry {
+    std::string key;
+    Unique<Arena> arena;
+    ast::Command* command;
+    size_t memoryBytes;
+  };
+
+  /// Removes the matching entry, unbound
+  auto take(const NormalizedQuery& query) -> std::optional<CachedCommand>;
+  void evictOverflow();
+
+  mutable std::mutex m_Mutex;
+  size_t m_Capacity;
+  std::list<Entry> m_Entries; ///< most recently used first
+  /// views into Entry::key, list nodes don't move
+  std::unordered_map<std::string_view, std::list<Entry>::iterator>
+      m_Index;
+  Stats m_Stats;
+};
+
+} // namespace adun
@@ -0,0 +1,119 @@
+#pragma once
+#include "adun/Parser/ASTNode.hpp"
+#include "adun/Parser/Utils.hpp"
+#include "adun/PerfCounters.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace adun {
+
+/// Log-linear latency buckets as in HdrHistogram: 8 buckets per power of
+/// two, so a recorded value is off by at most 12.5%
+class LatencyHistogram {
+public:
+  static constexpr size_t s_SubBuckets{ 8 };
+  /// Values from 2^36 ns (~69 s) up share the last bucket
+  static constexpr size_t s_NumBuckets{ (36 - 2) * s_SubBuckets };
+
+  void add(std::chrono::nanoseconds value);
+
+  [[nodiscard]] auto getCount() const -> uint64_t;
+  [[nodiscard]] auto getSum() const -> std::chrono::nanoseconds;
+  /// @param quantile in [0, 1]
+  /// @returns upper bound of the bucket holding the quantile, 0 if empty
+  [[nodiscard]] auto getQuantile(double quantile) const
+      -> std::chrono::nanoseconds;
+
+  static auto getBucketIndex(uint64_t value) -> size_t;
+  /// Smallest value of the bucket
+  static auto getBucketStart(size_t index) -> uint64_t;
+
+  friend class QueryMetrics;
+
+private:
+  std::array<uint64_t, s_NumBuckets> m_Buckets{};
+  uint64_t m_Count{ 0 };
+  uint64_t m_SumNs{ 0 };
+};
+
+/// Counts statements and their rows and times their phases, per command
+/// kind. Recording is lock free: threads add to one of a few shards of
+/// relaxed atomic counters, which a snapshot sums up.
+class QueryMetrics {
+public:
+  enum class CommandKind : uint8_t {
+    Create,
+    Insert,
+    Select,
+    Update,
+    Delete,
+    Copy,
+    Transaction,
+    Explain,
+    Invalid, ///< failed to lex or parse
+    NUM_KINDS
+  };
+  static constexpr auto s_NumKinds{ static_cast<size_t>(
+      CommandKind::NUM_KINDS) };
+
+  /// Outcome of one statement, filled in as it runs
+  struct Sample {
+    CommandKind kind{ CommandKind::Invalid };
+    bool failed{ false };
+    std::chrono::nanoseconds lexTime{ 0 };
+    std::chrono::nanoseconds parseTime{ 0 };
+    std::chrono::nanoseconds executeTime{ 0 }; ///< including commit
+    size_t rowsScanned{ 0 };                   ///< row versions visited
+    size_t rowsReturned{ 0 };
+    size_t rowsAffected{ 0 };
+    /// Of execution, if hardware counters are enabled and available
+    PerfCounters::Values executeEvents;
+  };
+
+  struct CommandStats {
+    uint64_t count{ 0 };
+    uint64_t errors{ 0 };
+    uint64_t rowsScanned{ 0 };
+    uint64_t rowsReturned{ 0 };
+    uint64_t rowsAffected{ 0 };
+    LatencyHistogram lexTime;
+    LatencyHistogram parseTime;
+    LatencyHistogram executeTime;
+    std::array<uint64_t, PerfCounters::s_NumEvents> executeEvents{};
+  };
+
+  struct Snapshot {
+    std::array<CommandStats, s_NumKinds> commands;
+
+    [[nodiscard]] auto get(CommandKind kind) const -> const CommandStats&;
+    /// Prometheus text exposition format, latencies as summaries
+    [[nodiscard]] auto toPrometheus() const -> std::string;
+  };
+
+  QueryMetrics();
+  ~QueryMetrics();
+
+  QueryMetrics(const QueryMetrics&)                    = delete;
+  QueryMetrics(QueryMetrics&&)                         = delete;
+  auto operator=(const QueryMetrics&) -> QueryMetrics& = delete;
+  auto operator=(QueryMetrics&&) -> QueryMetrics&      = delete;
+
+  static auto getCommandKind(ast::NodeKind kind) -> CommandKind;
+  static auto getCommandName(CommandKind kind) -> std::string_view;
+
+  void record(const Sample& sample);
+  [[nodiscard]] auto getSnapshot() const -> Snapshot;
+
+private:
+  struct Shard;
+  static constexpr size_t s_NumShards{ 8 };
+
+  Unique<Shard[]> m_Shards; // NOLINT
+};
+
+} // namespace adun
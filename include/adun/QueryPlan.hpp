@@ -0,0 +1,67 @@
+#pragma once
+#include "adun/PerfCounters.hpp"
+#include "adun/Types.hpp"
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace adun {
+
+/// Step of executing a command as shown by EXPLAIN, counters are only
+/// collected by EXPLAIN ANALYZE
+struct PlanStage {
+  std::string name;
+  std::vector<std::string> details;
+
+  std::chrono::nanoseconds time{ 0 };
+  size_t rowsExamined{ 0 }; ///< rows the filter was evaluated on
+  size_t rowsMatched{ 0 };
+  size_t versionsAppended{ 0 }; ///< row versions allocated
+  size_t constraintChecks{ 0 }; ///< UNIQUE index lookups
+  /// Only with hardware counters enabled and available
+  PerfCounters::Values events;
+};
+
+/// Stages of a command in execution order, see ast::Command::explain
+class QueryPlan {
+public:
+  auto addStage(std::string name, std::vector<std::string> details = {})
+      -> PlanStage&;
+  auto getStage(size_t index) -> PlanStage&;
+
+  /// One line per stage and per detail, with counters if analyzed
+  [[nodiscard]] auto format(bool analyzed) const
+      -> std::vector<std::string>;
+
+private:
+  std::vector<PlanStage> m_Stages;
+};
+
+/// Times a plan stage from construction to destruction and counts its
+/// work, does nothing without a stage, i.e. unless EXPLAIN ANALYZE runs
+class StageProfiler {
+public:
+  /// @param countEvents whether to read hardware counters as well
+  StageProfiler(PlanStage* stage, bool countEvents);
+  ~StageProfiler();
+
+  StageProfiler(const StageProfiler&)                    = delete;
+  StageProfiler(StageProfiler&&)                         = delete;
+  auto operator=(const StageProfiler&) -> StageProfiler& = delete;
+  auto operator=(StageProfiler&&) -> StageProfiler&      = delete;
+
+  /// @returns filter counting rows it examines and matches, or filter
+  /// itself when not profiling
+  [[nodiscard]] auto countRows(Selector filter) const -> Selector;
+  void addVersions(size_t count);
+  void addConstraintChecks(size_t count);
+
+private:
+  PlanStage* m_Stage;
+  std::chrono::steady_clock::time_point m_Start;
+  bool m_CountEvents;
+  PerfCounters::Values m_StartEvents;
+};
+
+} // namespace adun
@@ -1,15 +1,19 @@
 #pragma once
 #include "adun/ResultIterator.hpp"
+#include "adun/Row.hpp"
+#include "adun/Parser/Utils.hpp"
 #include "adun/Types.hpp"
 #include <vector>
 
 namespace adun {
 
+/// Rows belong to a table snapshot kept alive by the result, so it stays
+/// valid while other threads modify the table
 class Result {
 public:
   Result() = default;
-  Result(std::vector<RowRefWrapper> rows, ColumnNameIndexMap columnNames,
-         size_t affectedRows);
+  Result(std::vector<const Row*> rows, ColumnNameIndexMap columnNames,
+         size_t affectedRows, Ref<const void> snapshot = nullptr);
 
   auto begin() -> ResultIterator;
   auto end() -> ResultIterator;
@@ -17,11 +21,42 @@ public:
   [[nodiscard]] auto getNumAffectedRows() const -> size_t {
     return m_AffectedRows;
   }
+  [[nodiscard]] auto getNumRows() const -> size_t {
+    return m_Rows.size();
+  }
+
+  [[nodiscard]] auto getRows() const -> const std::vector<const Row*>& {
+    return m_Rows;
+  }
+  /// Column names to indices into the rows
+  [[nodiscard]] auto getColumnMap() const -> const ColumnNameIndexMap& {
+    return m_ColumnNames;
+  }
+
+  /// Row versions the statement visited, for metrics
+  [[nodiscard]] auto getNumScannedRows() const -> size_t {
+    return m_ScannedRows;
+  }
+  void setNumScannedRows(size_t scannedRows) {
+    m_ScannedRows = scannedRows;
+  }
+
+  /// Most bytes the statement had in use at once, including rows it
+  /// wrote and the row references of the result
+  [[nodiscard]] auto getPeakMemory() const -> size_t {
+    return m_PeakMemory;
+  }
+  void setPeakMemory(size_t bytes) {
+    m_PeakMemory = bytes;
+  }
 
 private:
-  std::vector<RowRefWrapper> m_Rows;
+  std::vector<const Row*> m_Rows;
+  Ref<const void> m_Snapshot;
   ColumnNameIndexMap m_ColumnNames;
   size_t m_AffectedRows{ 0 };
+  size_t m_ScannedRows{ 0 };
+  size_t m_PeakMemory{ 0 };
 };
 
 } // namespace adun
@@ -9,8 +9,8 @@ namespace adun {
 class ResultIterator {
 public:
   using iterator_category  = std::random_access_iterator_tag;
-  using UnderlyingIterator = std::vector<RowRefWrapper>::const_iterator;
-  using value_type         = const RowRefWrapper;
+  using UnderlyingIterator = std::vector<const Row*>::const_iterator;
+  using value_type         = const Row;
   using difference_type    = std::ptrdiff_t;
   using pointer            = const RowWrapper*;
   using reference          = const RowWrapper&;
@@ -11,14 +11,26 @@ public:
       : m_Values{ std::move(values) } {
   }
 
-  [[nodiscard]] auto get(size_t index) const -> Value {
+  [[nodiscard]] auto get(size_t index) const -> const Value& {
     return m_Values[index];
-    ;
   }
 
   [[nodiscard]] auto get(size_t index) -> Value& {
     return m_Values[index];
-    ;
+  }
+
+  /// Bytes of the value array
+  [[nodiscard]] auto getValuesSize() const -> size_t {
+    return m_Values.capacity() * sizeof(Value);
+  }
+
+  /// Bytes of strings and byte arrays of the values
+  [[nodiscard]] auto getHeapSize() const -> size_t {
+    size_t size{ 0 };
+    for (const auto& value : m_Values) {
+      size += value.getHeapSize();
+    }
+    return size;
   }
 
 private:
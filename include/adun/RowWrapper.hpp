@@ -10,7 +10,7 @@ class RowWrapper {
 
 public:
   RowWrapper() = default;
-  RowWrapper(Row* row, ColumnNameIndexMap columnNames)
+  RowWrapper(const Row* row, ColumnNameIndexMap columnNames)
       : m_RowPtr{ row },
         m_Columns{ std::move(columnNames) } {
   }
@@ -26,7 +26,7 @@ public:
   friend class ResultIterator;
 
 private:
-  Row* m_RowPtr{ nullptr };
+  const Row* m_RowPtr{ nullptr };
   ColumnNameIndexMap m_Columns;
 };
 
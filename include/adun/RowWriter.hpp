@@ -0,0 +1,78 @@
+#pragma once
+#include "adun/Parser/Utils.hpp"
+#include "adun/Row.hpp"
+#include "adun/Table.hpp"
+#include "adun/Types.hpp"
+#include "adun/Value.hpp"
+#include <cstddef>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace adun {
+
+enum class ExportFormat {
+  /// RFC 4180 with a header record, readable by CsvLoader
+  Csv,
+  /// Little endian, strings and bytes are length prefixed:
+  /// - header: "ADUN", u8 version, u32 column count, then per column u8
+  ///   ValueType and u32 length prefixed name
+  /// - rows: u8 1, then per column u8 ValueType and the value: i32
+  ///   integer, u8 boolean, u32 length prefixed string or bytes, nothing
+  ///   for null
+  /// - end: u8 0
+  Binary,
+};
+
+/// Streams table rows into a buffered output in one of ExportFormat
+/// formats, without materializing a Result
+class RowWriter {
+public:
+  static auto create(ExportFormat format, std::ostream& out)
+      -> Unique<RowWriter>;
+
+  virtual ~RowWriter() = default;
+
+  RowWriter(const RowWriter&)                    = delete;
+  RowWriter(RowWriter&&)                         = delete;
+  auto operator=(const RowWriter&) -> RowWriter& = delete;
+  auto operator=(RowWriter&&) -> RowWriter&      = delete;
+
+  /// Writes header, every row of snapshot passing filter and flushes
+  /// @returns number of written rows
+  auto write(const Table& table, const Table::Snapshot& snapshot,
+             const Selector& filter,
+             const std::vector<std::string>& columns) -> size_t;
+
+protected:
+  explicit RowWriter(std::ostream& out);
+
+  virtual void writeHeader(std::span<const std::string> names,
+                           std::span<const ValueType> types) = 0;
+  virtual void writeRow(const Row& row,
+                        std::span<const size_t> columns)   = 0;
+  virtual void writeEnd() {
+  }
+
+  void append(std::string_view bytes) {
+    m_Buffer.append(bytes);
+  }
+
+  void append(char c) {
+    m_Buffer.push_back(c);
+  }
+
+  /// Called between rows, so the buffer may overshoot by one row
+  void flushIfFull();
+  void flush();
+
+private:
+  static constexpr size_t s_BufferSize{ 1 << 16 };
+
+  std::ostream& m_Out;
+  std::string m_Buffer;
+};
+
+} // namespace adun
@@ -0,0 +1,138 @@
+#pragma once
+#include "adun/Exceptions.hpp"
+#include "adun/Parser/Utils.hpp"
+#include "adun/Protocol.hpp"
+#include "adun/Result.hpp"
+#include "adun/ThreadPool.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace adun {
+class Database;
+
+class ServerException : public DatabaseException {
+public:
+  using DatabaseException::DatabaseException;
+};
+
+/// Serves a Database over TCP and Unix domain sockets, see protocol.
+/// One thread runs an epoll loop doing all socket I/O, statements run on
+/// a worker pool of the server. Its workers may wait for locks, which
+/// must not hold up the pool of the database that async queries and CSV
+/// loads use. Each connection has a Session of its own, so a transaction
+/// spans the requests of a connection until COMMIT or ROLLBACK, and its
+/// requests run one at a time in order.
+///
+/// Clients may pipeline requests. The requests buffered when a worker
+/// is free run in one task, and their responses are coalesced into
+/// writes of about s_CoalesceSize bytes, so a run of small queries costs
+/// one wake up and one write rather than one each. Results are sent in
+/// batches as they are encoded. Once a slow client has
+/// s_MaxPendingOutput bytes unsent, its worker parks the rest of the
+/// result and of the requests and moves on; the loop resumes them when
+/// the client has read everything. The loop stops reading from a busy
+/// or parked connection with s_MaxPendingInput bytes buffered. Closing
+/// a connection, or stopping, cancels its running statement, drops its
+/// pipelined requests not started yet and rolls back its transaction.
+///
+/// Linux only.
+class Server {
+public:
+  struct Options {
+    std::string host{ "127.0.0.1" };
+    uint16_t port{ 0 }; ///< 0 picks a free one, see getPort
+    bool listenTcp{ true };
+    std::string unixPath; ///< empty for no Unix domain socket
+    size_t batchRows{ 1024 }; ///< rows per RowBatch message
+    size_t maxMessageSize{ protocol::s_MaxMessageSize };
+    /// Statements run at once, 0 picks hardware concurrency
+    size_t numWorkers{ 0 };
+  };
+
+  /// Bytes a connection buffers before its requests wait for the client
+  static constexpr size_t s_MaxPendingOutput{ size_t{ 1 } << 20U };
+  static constexpr size_t s_MaxPendingInput{ size_t{ 1 } << 20U };
+  /// Response bytes a worker gathers before handing them to the loop
+  static constexpr size_t s_CoalesceSize{ size_t{ 64 } << 10U };
+
+  /// Listens right away, connections are served once started
+  /// @throws ServerException if a socket can't be set up
+  Server(Database& db, Options options);
+  /// Stops, if running
+  ~Server();
+
+  Server(const Server&)                    = delete;
+  Server(Server&&)                         = delete;
+  auto operator=(const Server&) -> Server& = delete;
+  auto operator=(Server&&) -> Server&      = delete;
+
+  /// Runs the event loop on a thread of its own
+  void start();
+  /// Closes all connections, waiting for their running statements to
+  /// be cancelled
+  void stop();
+
+  /// Bound TCP port, 0 without a TCP socket
+  [[nodiscard]] auto getPort() const -> uint16_t;
+  [[nodiscard]] auto getNumConnections() const -> size_t;
+
+private:
+  struct Connection;
+
+  void loop(const std::stop_token& stop);
+  void accept(int listenFd);
+  void readFrom(const Ref<Connection>& conn);
+  /// Writes pending output, runs the next request or closes conn
+  void service(const Ref<Connection>& conn);
+  void close(const Ref<Connection>& conn);
+  /// Worker side, answers what a parked worker left, then frames, in
+  /// order. Parks conn rather than wait for the client to read.
+  void runRequests(const Ref<Connection>& conn,
+                   std::vector<std::string> frames);
+  /// Appends the response to frame to out, of a result only its Columns
+  /// message, see writeRows
+  /// @returns false if conn is to be closed
+  auto handleRequest(const Ref<Connection>& conn, const std::string& frame,
+                     std::string& out) -> bool;
+  /// Appends the Columns message of result to out and keeps the result
+  /// in conn for writeRows
+  void startResult(const Ref<Connection>& conn, Result result,
+                   std::string& out);
+  /// Appends the rest of the result of conn to out as RowBatch and
+  /// Complete messages, sending them on once out grows past
+  /// s_CoalesceSize
+  /// @returns false if the client has to read first, the rest is kept
+  auto writeRows(const Ref<Connection>& conn, std::string& out) -> bool;
+  /// Moves bytes to the output of conn
+  /// @returns false if s_MaxPendingOutput bytes or more are unsent
+  /// @throws QueryCancelledException if conn is closing
+  auto send(const Ref<Connection>& conn, std::string& bytes) -> bool;
+  /// Has the loop service conn
+  void notify(const Ref<Connection>& conn);
+  void wake();
+
+  Database& m_Db;
+  Options m_Options;
+  int m_Epoll{ -1 };
+  int m_WakeFd{ -1 }; ///< eventfd, written by notify and stop
+  int m_TcpFd{ -1 };
+  int m_UnixFd{ -1 };
+  uint16_t m_Port{ 0 };
+
+  /// loop only, by file descriptor
+  std::unordered_map<int, Ref<Connection>> m_Connections;
+  std::atomic<size_t> m_NumConnections{ 0 };
+  std::atomic<bool> m_Stopping{ false }; ///< set by stop, read by workers
+  std::mutex m_NotifiedMutex;
+  std::vector<Ref<Connection>> m_Notified;
+  ThreadPool m_Pool;
+  std::jthread m_Loop;
+};
+
+} // namespace adun
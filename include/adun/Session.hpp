@@ -0,0 +1,70 @@
+#pragma once
+#include "adun/CancellationToken.hpp"
+#include "adun/Parser/Command.hpp"
+#include "adun/Parser/Lexer.hpp"
+#include "adun/QueryMetrics.hpp"
+#include "adun/Result.hpp"
+#include "adun/Transaction.hpp"
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace adun {
+class Database;
+
+/// Executes statements of one client in order. BEGIN starts a
+/// transaction spanning the statements up to COMMIT or ROLLBACK, other
+/// statements commit on their own. A failing statement changes nothing
+/// and leaves the transaction open.
+///
+/// Not thread safe, use a session per thread, except for cancel. An
+/// open transaction is rolled back on destruction.
+class Session {
+public:
+  explicit Session(Database& db);
+
+  auto execute(const std::string& query) -> Result;
+  /// Executes a lexed statement with literals bound in place of its own,
+  /// in order, as prepared statements do. Its text must outlive tokens.
+  /// @throws CommandException if their numbers differ
+  auto execute(const Ref<TokenList>& tokens,
+               std::span<const Value> literals) -> Result;
+
+  /// Executes ';'-separated statements in order, lexing one statement at
+  /// a time. Statements before a failing one stay applied unless they are
+  /// in a transaction.
+  auto executeScript(std::string_view script) -> std::vector<Result>;
+
+  [[nodiscard]] auto inTransaction() const -> bool;
+
+  /// Makes the running statement fail with QueryCancelledException once
+  /// it reaches a check, see CancellationToken. Its changes are reverted
+  /// and a transaction it runs in stays open. Thread safe; between
+  /// statements it fails the next one before it starts.
+  void cancel();
+
+  /// Each statement of this session fails like a cancelled one after
+  /// running for timeout, 0 means none. Overrides
+  /// Database::setStatementTimeout.
+  void setStatementTimeout(std::chrono::milliseconds timeout);
+
+private:
+  /// Runs lex, recording sample as failed if it throws
+  void timeLexing(QueryMetrics::Sample& sample,
+                  const std::function<void()>& lex);
+  auto executeTokens(const Ref<TokenList>& tokens,
+                     QueryMetrics::Sample& sample,
+                     std::span<const Value> literals = {}) -> Result;
+  auto controlTransaction(const ast::Command& command) -> Result;
+
+  Database& m_Db;
+  CancellationToken m_Cancel; ///< rearmed for each statement
+  std::optional<std::chrono::milliseconds> m_StatementTimeout;
+  std::optional<Transaction> m_Transaction; ///< refers to m_Cancel
+};
+
+} // namespace adun
@@ -0,0 +1,67 @@
+#pragma once
+#include "adun/QueryMetrics.hpp"
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace adun {
+
+/// Statements that ran for at least a threshold, with their timings and
+/// plans. The latest ones are kept in a ring buffer and, given a path,
+/// appended to a text file which is rotated to path.1 once it grows
+/// past a size.
+///
+/// Thread safe.
+class SlowQueryLog {
+public:
+  struct Options {
+    /// Of lexing, parsing and execution together
+    std::chrono::nanoseconds threshold{ std::chrono::milliseconds{ 100 } };
+    size_t capacity{ 128 }; ///< entries kept in memory
+    /// EXPLAIN output of the statement, without ANALYZE
+    bool capturePlan{ true };
+    /// Call stack of the thread running the statement, which tells the
+    /// code path of the application that issued it
+    bool captureStacktrace{ false };
+    std::string path; ///< empty keeps entries in memory only
+    size_t maxFileSize{ size_t{ 16 } << 20U };
+  };
+
+  struct Entry {
+    std::chrono::system_clock::time_point time; ///< when it finished
+    std::string query;
+    QueryMetrics::Sample sample;
+    std::vector<std::string> plan; ///< empty unless captured
+    std::string stacktrace;        ///< empty unless captured
+
+    [[nodiscard]] auto getTotalTime() const -> std::chrono::nanoseconds;
+    /// Header line, query, then the plan and stack trace indented
+    [[nodiscard]] auto toString() const -> std::string;
+  };
+
+  /// @throws FileException if options.path can't be opened
+  explicit SlowQueryLog(Options options);
+
+  [[nodiscard]] auto getOptions() const -> const Options&;
+
+  /// @throws FileException if the file can't be written or rotated, the
+  /// entry is kept in memory still
+  void record(Entry entry);
+  /// Oldest first
+  [[nodiscard]] auto getEntries() const -> std::vector<Entry>;
+
+private:
+  void openFile();
+
+  Options m_Options;
+  mutable std::mutex m_Mutex;
+  std::vector<Entry> m_Entries;
+  size_t m_NextEntry{ 0 }; ///< overwritten once the ring is full
+  std::ofstream m_File;
+  size_t m_FileSize{ 0 };
+};
+
+} // namespace adun
@@ -1,14 +1,20 @@
 #pragma once
+#include "adun/CancellationToken.hpp"
 #include "adun/Column.hpp"
 #include "adun/Exceptions.hpp"
+#include "adun/MemoryTracker.hpp"
+#include "adun/Parser/Utils.hpp"
 #include "adun/Result.hpp"
 #include "adun/Row.hpp"
 #include "adun/Types.hpp"
 #include "adun/Value.hpp"
-#include <list>
+#include "adun/VersionStore.hpp"
+#include <atomic>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace adun {
 
@@ -17,35 +23,242 @@ public:
   explicit InvalidRowException(const std::string& msg);
 };
 
+/// Rows are kept as versions (MVCC). Readers see the snapshot of the
+/// latest commit and never wait for writers. Writers must hold
+/// getMutex(); each write call is atomic and becomes visible to readers
+/// all at once, or not at all if it throws. Several calls are grouped
+/// into one atomic change by passing them the same PendingWrite.
+///
+/// Versions dead for every snapshot are dropped by compacting into a new
+/// store, the old one is freed with the last snapshot still reading it.
+///
+/// Memory of the current store and of the indexes is accounted for as
+/// it grows. Writes fail with MemoryLimitException, changing nothing,
+/// when it would exceed the limit of a parent tracker.
 class Table {
 public:
-  using Scheme = std::unordered_map<std::string, Column>;
+  using Scheme      = std::unordered_map<std::string, Column>;
+  using Assignments = std::vector<std::pair<std::string, Value>>;
 
-  Table(std::string name, Scheme scheme);
+  /// @param memory tracker the usage of the table is charged to, if any
+  Table(std::string name, Scheme scheme, MemoryTracker* memory = nullptr);
 
   [[nodiscard]] auto getName() const -> std::string;
   [[nodiscard]] auto getScheme() const -> const Scheme&;
 
-  auto getColumnMap() const -> const ColumnNameIndexMap&;
+  [[nodiscard]] auto getColumnMap() const -> const ColumnNameIndexMap&;
+  /// In column index order
+  [[nodiscard]] auto getColumnNames() const -> std::vector<std::string>;
 
+  struct Snapshot {
+    Ref<VersionStore> store;
+    Timestamp ts;
+    size_t size;
+    /// Of the statement scanning it, if any
+    const CancellationToken* cancel{ nullptr };
+  };
+
+  class PendingWrite;
+
+  /// Of the latest commit
+  [[nodiscard]] auto takeSnapshot() const -> Snapshot;
+
+  /// Result keeps the snapshot alive, no rows are copied. Scans and
+  /// writes check the cancellation token of the snapshot or write, if
+  /// set, every CancellationToken::s_CheckInterval versions and throw
+  /// QueryCancelledException, reverting the changes of the call.
   auto selectRows(const Selector& filter,
-                  const std::vector<std::string>& columns) -> Result;
+                  const std::vector<std::string>& columns) const
+      -> Result;
+  auto selectRows(const Selector& filter,
+                  const std::vector<std::string>& columns,
+                  const Snapshot& snapshot) const -> Result;
+
+  void scanRows(const Selector& filter,
+                const std::function<void(const Row&)>& callback) const;
+  void scanRows(const Selector& filter,
+                const std::function<void(const Row&)>& callback,
+                const Snapshot& snapshot) const;
 
-  void traverseRows(const Selector& filter,
-                    const std::function<void(Row&)>& callback);
+  /// update modifies a copy of each matching row, which replaces it
+  auto updateRows(const Selector& filter,
+                  const std::function<void(Row&)>& update) -> size_t;
+  auto updateRows(const Selector& filter,
+                  const std::function<void(Row&)>& update,
+                  PendingWrite& write) -> size_t;
 
   auto deleteRows(const Selector& filter) -> size_t;
+  auto deleteRows(const Selector& filter, PendingWrite& write) -> size_t;
+
+  /// Rows checked against the scheme and filled with defaults, but not
+  /// autoincrement, which is assigned on insertion
+  struct PreparedRows {
+    std::vector<Row> rows;
+
+    /// Bytes of the values and their heaps
+    [[nodiscard]] auto getMemoryUsage() const -> size_t;
+  };
+
+  /// Needs no lock, so concurrent writers prepare rows in parallel and
+  /// serialize only on insertRows
+  auto prepareRows(const std::vector<Assignments>& rows) const
+      -> PreparedRows;
+  /// Rows laid out by column index, empty values take defaults and
+  /// autoincrement
+  auto prepareRows(std::vector<std::vector<Value>> rows) const
+      -> PreparedRows;
+  /// Assigns autoincrement and checks UNIQUE columns against the index,
+  /// inserts all rows or none of them
+  void insertRows(PreparedRows prepared, PendingWrite& write);
+
+  void addRow(const Assignments& assignments);
 
-  void addRow(
-      const std::vector<std::pair<std::string, Value>>& assignments);
+  /// Inserts all rows or none of them
+  void addRows(const std::vector<Assignments>& rows);
+  void addRows(const std::vector<Assignments>& rows, PendingWrite& write);
+
+  /// Same as insertRows(prepareRows(rows))
+  void appendRows(std::vector<std::vector<Value>> rows);
+  void appendRows(std::vector<std::vector<Value>> rows,
+                  PendingWrite& write);
+
+  /// Including dead ones not collected yet
+  [[nodiscard]] auto getNumVersions() const -> size_t;
+  /// Each one is checked by an index lookup per written row
+  [[nodiscard]] auto getNumUniqueColumns() const -> size_t;
+
+  /// Bytes of the current store, dead versions included until compacted
+  struct MemoryUsage {
+    size_t rows;    ///< version slots and value arrays
+    size_t strings; ///< heaps of strings and byte arrays
+    size_t indexes; ///< UNIQUE column indexes, estimated per entry
+
+    [[nodiscard]] auto getTotal() const -> size_t {
+      return rows + strings + indexes;
+    }
+  };
+  [[nodiscard]] auto getMemoryUsage() const -> MemoryUsage;
+
+  [[nodiscard]] auto getMutex() const -> std::timed_mutex&;
 
-  void checkConstraintsAgainst(const Row& row) const;
 private:
+  struct Versions {
+    /// swapped by compaction
+    Ref<VersionStore> store{ makeRef<VersionStore>() };
+    /// held only to copy or swap store, std::atomic<Ref> of libstdc++ 12
+    /// releases its internal lock with relaxed ordering on load
+    mutable std::mutex storeMutex;
+    std::timed_mutex writeMutex;
+  };
+
+  [[nodiscard]] auto loadStore() const -> Ref<VersionStore>;
+
+  /// Written by the writer only, the total is charged to the parent
+  struct Memory {
+    explicit Memory(MemoryTracker* parent)
+        : total{ parent } {
+    }
+
+    MemoryTracker total;
+    std::atomic<size_t> rows{ 0 };
+    std::atomic<size_t> strings{ 0 };
+    std::atomic<size_t> indexes{ 0 };
+  };
+
+  /// Node and bucket of an index entry in libstdc++, without key heap
+  static constexpr size_t s_IndexEntrySize{
+    sizeof(std::pair<const Value, uint32_t>) + 2 * sizeof(void*) +
+    sizeof(size_t)
+  };
+
+  /// Live values of a UNIQUE column as the writer sees them, including
+  /// pending changes. Counts exceed 1 only until a failing update is
+  /// rolled back.
+  struct UniqueIndex {
+    size_t column;
+    std::string name;
+    std::unordered_map<Value, uint32_t> counts;
+  };
+
+  void indexRow(const Row& row);
+  void unindexRow(const Row& row);
+
+  /// Checks unique columns of batch against each other and live rows
+  void checkUnique(const std::vector<Row>& batch) const;
+  /// Checks unique columns of versions appended from index first on,
+  /// which are indexed already
+  void checkUniqueAppended(const VersionStore& store, size_t first) const;
+
+  /// Compacts once dead versions outnumber live ones
+  void collectGarbage();
+
+  /// Fewer dead versions are not worth a compaction
+  static constexpr size_t s_MinGarbage{ 1024 };
 
   std::string m_Name;
   Scheme m_Header;
-  std::list<Row> m_Rows;
-  mutable ColumnNameIndexMap m_ColumnMap;
+  ColumnNameIndexMap m_ColumnMap;
+  std::vector<int32_t> m_Counters; ///< autoincrement, by column index
+  std::vector<UniqueIndex> m_UniqueIndexes; ///< writer only
+  /// boxed to keep Table movable
+  Unique<Versions> m_Versions{ makeUnique<Versions>() };
+  Unique<Memory> m_Memory;
+};
+
+/// Stamps changes of write calls with the timestamp following the latest
+/// commit. commit() publishes them all at once, otherwise they are
+/// reverted on destruction; readers never see them either way until
+/// commit. Autoincrement counters and unique indexes are restored along
+/// with the rows, which is safe as the writer holds the table until it is
+/// done.
+class Table::PendingWrite {
+public:
+  struct Savepoint {
+    size_t storeSize;
+    size_t numEnded;
+    std::vector<int32_t> counters;
+  };
+
+  explicit PendingWrite(Table& table);
+  ~PendingWrite();
+
+  PendingWrite(const PendingWrite&)                    = delete;
+  PendingWrite(PendingWrite&&)                         = delete;
+  auto operator=(const PendingWrite&) -> PendingWrite& = delete;
+  auto operator=(PendingWrite&&) -> PendingWrite&      = delete;
+
+  [[nodiscard]] auto getSavepoint() const -> Savepoint;
+  /// Reverts changes made since savepoint was taken
+  void rollbackTo(const Savepoint& savepoint);
+
+  /// Rows as the writer sees them: latest commit and own changes
+  [[nodiscard]] auto getSnapshot() const -> Snapshot;
+
+  /// Versions appended from now on are charged to memory as well, if
+  /// set, see Transaction::setQueryMemory
+  void setQueryMemory(MemoryTracker* memory);
+  /// Checked by scans of following write calls, if set
+  void setCancellation(const CancellationToken* cancel);
+
+  void commit();
+
+  friend class Table;
+
+private:
+  /// Charges numRows versions about to be appended
+  /// @throws MemoryLimitException, nothing is charged then
+  void reserve(size_t numRows, size_t valuesSize, size_t heapSize);
+  void append(Row row);
+  void end(RowVersion& version);
+
+  Table& m_Table;
+  MemoryTracker* m_QueryMemory{ nullptr };
+  const CancellationToken* m_Cancel{ nullptr };
+  Ref<VersionStore> m_Store;
+  Timestamp m_Ts;
+  std::vector<RowVersion*> m_Ended;
+  Savepoint m_Initial;
+  bool m_Committed{ false };
 };
 
 } // namespace adun
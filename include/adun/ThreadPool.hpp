@@ -0,0 +1,55 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace adun {
+
+/// Fixed set of worker threads running submitted tasks in FIFO order.
+/// Tasks still queued on destruction are run before workers exit.
+class ThreadPool {
+public:
+  /// @param numThreads 0 picks hardware concurrency
+  explicit ThreadPool(size_t numThreads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&)                    = delete;
+  ThreadPool(ThreadPool&&)                         = delete;
+  auto operator=(const ThreadPool&) -> ThreadPool& = delete;
+  auto operator=(ThreadPool&&) -> ThreadPool&      = delete;
+
+  /// Exceptions thrown by task are rethrown from the future
+  template <typename F>
+  auto submit(F&& task) -> std::future<std::invoke_result_t<F>> {
+    using R = std::invoke_result_t<F>;
+    auto packaged{ std::make_shared<std::packaged_task<R()>>(
+        std::forward<F>(task)) };
+    auto future{ packaged->get_future() };
+    post([packaged] { (*packaged)(); });
+    return future;
+  }
+
+  /// Runs task without a way to wait for it, task must not throw
+  void post(std::function<void()> task);
+
+  [[nodiscard]] auto getNumThreads() const -> size_t;
+
+private:
+  void workerLoop(const std::stop_token& stop);
+
+  std::mutex m_Mutex;
+  std::condition_variable_any m_TaskAvailable;
+  std::queue<std::function<void()>> m_Tasks;
+  /// last, so workers are joined before the queue dies
+  std::vector<std::jthread> m_Workers;
+};
+
+} // namespace adun
@@ -0,0 +1,58 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace adun {
+
+/// Process wide timeline of TraceSpans, exported in the Chrome trace
+/// event format which chrome://tracing and Perfetto open. Each thread
+/// records into a buffer of its own, so spans of workers don't contend,
+/// and while tracing is stopped a span costs a relaxed atomic load.
+class Tracer {
+public:
+  /// Spans begun from now on are recorded
+  static void start();
+  static void stop();
+  [[nodiscard]] static auto isEnabled() -> bool;
+
+  /// Shown for the calling thread instead of its number
+  static void setThreadName(std::string name);
+
+  /// Spans recorded so far by all threads, as a JSON object
+  [[nodiscard]] static auto exportJson() -> std::string;
+  static void clear();
+
+  /// Spans a thread records beyond this are dropped
+  static constexpr size_t s_MaxEventsPerThread{ size_t{ 1 } << 20U };
+};
+
+/// Records the time from construction to destruction as a span of the
+/// calling thread, if tracing was on at construction. Name, category and
+/// argument keys are kept as pointers, so they must be string literals.
+class TraceSpan {
+public:
+  explicit TraceSpan(const char* name, const char* category = "adun");
+  ~TraceSpan();
+
+  TraceSpan(const TraceSpan&)                    = delete;
+  TraceSpan(TraceSpan&&)                         = delete;
+  auto operator=(const TraceSpan&) -> TraceSpan& = delete;
+  auto operator=(TraceSpan&&) -> TraceSpan&      = delete;
+
+  /// Shown with the span, ignored past s_MaxArgs
+  void addArg(const char* key, int64_t value);
+
+  static constexpr size_t s_MaxArgs{ 3 };
+
+private:
+  const char* m_Name;
+  const char* m_Category;
+  int64_t m_StartNs{ -1 }; ///< negative if not recording
+  std::array<std::pair<const char*, int64_t>, s_MaxArgs> m_Args{};
+  size_t m_NumArgs{ 0 };
+};
+
+} // namespace adun
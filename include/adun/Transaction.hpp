@@ -0,0 +1,106 @@
+#pragma once
+#include "adun/CommitLog.hpp"
+#include "adun/Exceptions.hpp"
+#include "adun/MemoryTracker.hpp"
+#include "adun/Parser/Utils.hpp"
+#include "adun/QueryPlan.hpp"
+#include "adun/Table.hpp"
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace adun {
+class Database;
+
+class TransactionException : public DatabaseException {
+public:
+  using DatabaseException::DatabaseException;
+};
+
+/// Groups changes of several statements into one atomic change. Tables
+/// are locked for writing from the first write until the transaction
+/// ends and are read as of the latest commit plus own changes (read
+/// committed), so other transactions never see uncommitted rows.
+///
+/// Pending row versions are the undo log: rollback reverts them in
+/// place without copying rows. Commit appends a single record to the
+/// commit log, if the database has one, and publishes the changes once
+/// the record is on disk.
+class Transaction {
+public:
+  struct ReadView {
+    const Table& table;
+    Table::Snapshot snapshot;
+  };
+
+  struct WriteView {
+    Table& table;
+    Table::PendingWrite& write;
+  };
+
+  explicit Transaction(Database& db);
+  /// Rolls back unless committed
+  ~Transaction();
+
+  Transaction(const Transaction&)                    = delete;
+  Transaction(Transaction&&)                         = delete;
+  auto operator=(const Transaction&) -> Transaction& = delete;
+  auto operator=(Transaction&&) -> Transaction&      = delete;
+
+  /// @throws CommandException if there is no such table
+  auto read(const std::string& tableName) -> ReadView;
+  /// Locks the table until the transaction ends
+  /// @throws CommandException if there is no such table
+  /// @throws TransactionException if another transaction holds the table
+  /// for longer than the lock timeout
+  /// @throws QueryCancelledException if it does past the deadline of the
+  /// cancellation token
+  auto write(const std::string& tableName) -> WriteView;
+  auto write(Table& table) -> WriteView;
+
+  /// Adds a change to redo on recovery, see CommitLog
+  void log(CommitLog::Entry entry);
+
+  /// @throws FileException if the commit record can't be written, the
+  /// transaction stays uncommitted then
+  void commit();
+  void rollback();
+
+  [[nodiscard]] auto getDatabase() const -> Database&;
+
+  /// Statements record stage metrics into plan while it is set, see
+  /// ast::ExplainCommand
+  void setProfile(QueryPlan* plan);
+  /// @returns profiler of stage index of the profiled plan, inactive if
+  /// there is none
+  [[nodiscard]] auto profileStage(size_t index) const -> StageProfiler;
+
+  /// Memory used by the running statement is charged to memory while it
+  /// is set, rows it writes included
+  void setQueryMemory(MemoryTracker* memory);
+  /// Charges memory the statement holds outside of tables, such as rows
+  /// staged for insertion
+  /// @throws MemoryLimitException if the database would exceed its limit
+  void reserveMemory(size_t bytes);
+  void releaseMemory(size_t bytes);
+
+  /// Statements check cancel, if set, while scanning and writing, and
+  /// wait for table locks until its deadline at most
+  void setCancellation(const CancellationToken* cancel);
+
+private:
+  struct TableWrite {
+    Table* table;
+    std::unique_lock<std::timed_mutex> lock;
+    Unique<Table::PendingWrite> write; ///< reverted before unlocking
+  };
+
+  Database& m_Db;
+  std::vector<TableWrite> m_Writes;
+  CommitLog::Record m_Redo;
+  QueryPlan* m_Profile{ nullptr };
+  MemoryTracker* m_QueryMemory{ nullptr };
+  const CancellationToken* m_Cancel{ nullptr };
+};
+
+} // namespace adun
@@ -114,7 +114,7 @@ public:
   template <internal::IsDBValue T>
   void set(T&& value) {
     m_Data = std::forward<T>(value);
-    m_Type = internal::TypeToEnumMap<T>::value;
+    m_Type = internal::TypeToEnumMap<std::remove_cvref_t<T>>::value;
   }
 
   template <typename F>
@@ -144,6 +144,11 @@ public:
 
   [[nodiscard]] auto toString() const -> std::string;
 
+  [[nodiscard]] auto hash() const -> size_t;
+
+  /// Bytes allocated for a string or a byte array, 0 if held inline
+  [[nodiscard]] auto getHeapSize() const -> size_t;
+
   static auto typeToString(ValueType type) -> std::string_view;
 
   auto operator==(const Value& other) const -> bool {
@@ -272,3 +277,10 @@ private:
 };
 
 } // namespace adun
+
+template <>
+struct std::hash<adun::Value> {
+  auto operator()(const adun::Value& value) const -> size_t {
+    return value.hash();
+  }
+};
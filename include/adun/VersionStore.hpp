@@ -0,0 +1,134 @@
+#pragma once
+#include "adun/Row.hpp"
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+
+namespace adun {
+
+using Timestamp = uint64_t;
+
+/// One version of a row, visible to snapshots taken at [begin, end)
+struct RowVersion {
+  static constexpr Timestamp s_Infinity{
+    std::numeric_limits<Timestamp>::max()
+  };
+
+  RowVersion(Row values, Timestamp beginTs)
+      : row{ std::move(values) },
+        begin{ beginTs } {
+  }
+
+  [[nodiscard]] auto isVisibleAt(Timestamp ts) const -> bool {
+    return begin <= ts && ts < end.load(std::memory_order_acquire);
+  }
+
+  [[nodiscard]] auto isLive() const -> bool {
+    return end.load(std::memory_order_acquire) == s_Infinity;
+  }
+
+  const Row row; ///< versions are immutable, updates append new ones
+  const Timestamp begin;
+  std::atomic<Timestamp> end{ s_Infinity };
+};
+
+/// Append-only storage of row versions. A single writer appends while
+/// any number of readers iterate without locks: slots never move, and
+/// readers only look below the size published with release semantics.
+///
+/// Storage is split in chunks doubling in size, so there is no
+/// reallocation and no upper limit in practice.
+class VersionStore {
+public:
+  VersionStore() = default;
+  ~VersionStore();
+
+  VersionStore(const VersionStore&)                    = delete;
+  VersionStore(VersionStore&&)                         = delete;
+  auto operator=(const VersionStore&) -> VersionStore& = delete;
+  auto operator=(VersionStore&&) -> VersionStore&      = delete;
+
+  /// Writer only
+  auto append(Row row, Timestamp begin) -> RowVersion&;
+
+  [[nodiscard]] auto getSize() const -> size_t {
+    return m_Size.load(std::memory_order_acquire);
+  }
+
+  [[nodiscard]] auto operator[](size_t index) const -> RowVersion& {
+    auto [chunk, offset]{ locate(index) };
+    return m_Chunks[chunk].load(std::memory_order_acquire)[offset];
+  }
+
+  /// Calls f on each of the first count versions, chunk by chunk
+  template <typename F>
+  void forEach(size_t count, F&& f) const {
+    forEachIn(0, count, f);
+  }
+
+  /// Calls f on each version in [first, last), chunk by chunk
+  template <typename F>
+  void forEachIn(size_t first, size_t last, F&& f) const {
+    if (first >= last) {
+      return;
+    }
+    auto [chunk, offset]{ locate(first) };
+    for (auto index{ first }; index < last; chunk++, offset = 0) {
+      auto* versions{ m_Chunks[chunk].load(std::memory_order_acquire) };
+      auto chunkEnd{
+        std::min(last, index + getChunkSize(chunk) - offset)
+      };
+      for (auto i{ offset }; index < chunkEnd; i++, index++) {
+        f(versions[i]);
+      }
+    }
+  }
+
+  /// Latest committed timestamp, snapshots are taken at it
+  [[nodiscard]] auto getCommitTs() const -> Timestamp {
+    return m_CommitTs.load(std::memory_order_acquire);
+  }
+
+  /// Writer only, publishes everything stamped with ts
+  void setCommitTs(Timestamp ts) {
+    m_CommitTs.store(ts, std::memory_order_release);
+  }
+
+  /// Writer only, versions not live at the latest commit
+  size_t numDead{ 0 };
+
+  /// Slots allocated once size versions are appended
+  static auto getCapacity(size_t size) -> size_t {
+    if (size == 0) {
+      return 0;
+    }
+    auto [chunk, _]{ locate(size - 1) };
+    return getChunkSize(chunk + 1) - getChunkSize(0);
+  }
+
+private:
+  static constexpr size_t s_FirstChunkBits{ 6 };
+  static constexpr size_t s_NumChunks{ 48 };
+
+  static auto getChunkSize(size_t chunk) -> size_t {
+    return size_t{ 1 } << (chunk + s_FirstChunkBits);
+  }
+
+  /// Chunk k starts at index (2^k - 1) * first chunk size
+  static auto locate(size_t index) -> std::pair<size_t, size_t> {
+    auto biased{ (index >> s_FirstChunkBits) + 1 };
+    auto chunk{ static_cast<size_t>(std::bit_width(biased)) - 1 };
+    auto chunkStart{ (getChunkSize(chunk) - getChunkSize(0)) };
+    return { chunk, index - chunkStart };
+  }
+
+  std::array<std::atomic<RowVersion*>, s_NumChunks> m_Chunks{};
+  std::atomic<size_t> m_Size{ 0 };
+  std::atomic<Timestamp> m_CommitTs{ 0 };
+};
+
+} // namespace adun
@@ -0,0 +1,108 @@
+// Serves a database over TCP and a Unix domain socket until SIGINT or
+// SIGTERM, see Server and Protocol.hpp for the wire format.
+//
+// Usage: adundb_server [--host=ADDRESS] [--port=N] [--unix=PATH]
+//   [--log=PATH] [--no-tcp]
+#include "adun/Database.hpp"
+#include "adun/Exceptions.hpp"
+#include "adun/Server.hpp"
+#include <csignal>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace {
+
+using namespace adun; // NOLINT
+
+struct Options {
+  Server::Options server;
+  std::string logPath; ///< empty for an in-memory database
+};
+
+/// @returns value of a --name=value argument
+auto getArgValue(std::string_view arg, std::string_view name)
+    -> std::optional<std::string> {
+  auto prefix{ "--" + std::string{ name } + "=" };
+  if (!arg.starts_with(prefix)) {
+    return std::nullopt;
+  }
+  return std::string{ arg.substr(prefix.size()) };
+}
+
+/// @throws std::invalid_argument on malformed arguments
+auto parseOptions(int argc, char** argv) -> Options {
+  Options options;
+  for (int i{ 1 }; i < argc; i++) {
+    std::string_view arg{ argv[i] };
+    if (auto v{ getArgValue(arg, "host") }) {
+      options.server.host = *v;
+    } else if (auto v{ getArgValue(arg, "port") }) {
+      auto port{ std::stoul(*v) };
+      if (port > UINT16_MAX) {
+        throw std::invalid_argument{ "Port out of range " + *v };
+      }
+      options.server.port = static_cast<uint16_t>(port);
+    } else if (auto v{ getArgValue(arg, "unix") }) {
+      options.server.unixPath = *v;
+    } else if (auto v{ getArgValue(arg, "log") }) {
+      options.logPath = *v;
+    } else if (arg == "--no-tcp") {
+      options.server.listenTcp = false;
+    } else {
+      throw std::invalid_argument{ "Unknown argument " +
+                                   std::string{ arg } };
+    }
+  }
+  if (!options.server.listenTcp && options.server.unixPath.empty()) {
+    throw std::invalid_argument{ "Nothing to listen on, --no-tcp needs "
+                                 "--unix" };
+  }
+  return options;
+}
+
+} // namespace
+
+auto main(int argc, char** argv) -> int {
+  Options options;
+  try {
+    options = parseOptions(argc, argv);
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+
+  // blocked before any thread starts, so that only sigwait gets them
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  try {
+    auto db{ options.logPath.empty()
+                 ? std::make_unique<Database>()
+                 : std::make_unique<Database>(options.logPath) };
+    Server server{ *db, options.server };
+    server.start();
+    if (options.server.listenTcp) {
+      std::printf("Listening on %s:%u\n", options.server.host.c_str(),
+                  static_cast<unsigned>(server.getPort()));
+    }
+    if (!options.server.unixPath.empty()) {
+      std::printf("Listening on %s\n", options.server.unixPath.c_str());
+    }
+    std::fflush(stdout);
+
+    int signal{ 0 };
+    sigwait(&signals, &signal);
+    server.stop();
+  } catch (const DatabaseException& e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
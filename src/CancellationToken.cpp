@@ -0,0 +1,35 @@
+#include "adun/CancellationToken.hpp"
+
+namespace adun {
+
+void CancellationToken::reset(Clock::time_point deadline) {
+  m_Deadline = deadline;
+}
+
+void CancellationToken::cancel() {
+  m_Cancelled.store(true, std::memory_order_relaxed);
+}
+
+void CancellationToken::clear() {
+  m_Cancelled.store(false, std::memory_order_relaxed);
+}
+
+auto CancellationToken::getDeadline() const -> Clock::time_point {
+  return m_Deadline;
+}
+
+void CancellationToken::check() const {
+  if (m_Cancelled.load(std::memory_order_relaxed)) {
+    throw QueryCancelledException{
+      QueryCancelledException::Cause::Cancelled, "Statement was cancelled"
+    };
+  }
+  if (m_Deadline != Clock::time_point::max() &&
+      Clock::now() >= m_Deadline) {
+    throw QueryCancelledException{
+      QueryCancelledException::Cause::TimedOut, "Statement timed out"
+    };
+  }
+}
+
+} // namespace adun
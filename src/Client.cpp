@@ -0,0 +1,361 @@
+#include "adun/Client.hpp"
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fmt/format.h>
+#include <utility>
+
+#ifdef __linux__
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace adun {
+
+using namespace protocol;
+
+StatementException::StatementException(ErrorCode code,
+                                       const std::string& msg)
+    : ClientException{ msg },
+      m_Code{ code } {
+}
+
+auto StatementException::getCode() const -> ErrorCode {
+  return m_Code;
+}
+
+Client::Client(int fd)
+    : m_Fd{ fd } {
+}
+
+#ifdef __linux__
+
+Client::~Client() {
+  if (m_Fd >= 0) {
+    ::close(m_Fd);
+  }
+}
+
+auto Client::connect(const std::string& host, uint16_t port) -> Client {
+  addrinfo hints{};
+  hints.ai_family   = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags    = AI_NUMERICSERV;
+  addrinfo* addresses{ nullptr };
+  auto service{ std::to_string(port) };
+  if (auto error{ ::getaddrinfo(host.c_str(), service.c_str(), &hints,
+                                &addresses) };
+      error != 0) {
+    throw ClientException{ fmt::format("Cannot resolve '{}': {}", host,
+                                       ::gai_strerror(error)) };
+  }
+
+  int fd{ -1 };
+  for (auto* address{ addresses }; address != nullptr;
+       address = address->ai_next) {
+    fd = ::socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC,
+                  address->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    if (::connect(fd, address->ai_addr, address->ai_addrlen) == 0) {
+      break;
+    }
+    ::close(fd);
+    fd = -1;
+  }
+  ::freeaddrinfo(addresses);
+  if (fd < 0) {
+    throw ClientException{ fmt::format("Cannot connect to {}:{}: {}",
+                                       host, port,
+                                       std::strerror(errno)) };
+  }
+  // requests are written whole, they must not wait for more
+  int on{ 1 };
+  ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  return Client{ fd };
+}
+
+auto Client::connectUnix(const std::string& path) -> Client {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    throw ClientException{ fmt::format("Socket path '{}' is too long",
+                                       path) };
+  }
+  std::ranges::copy(path, std::begin(address.sun_path));
+
+  Client client{ ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0) };
+  if (client.m_Fd < 0 ||
+      ::connect(client.m_Fd, reinterpret_cast<const sockaddr*>(&address),
+                sizeof(address)) != 0) {
+    throw ClientException{ fmt::format("Cannot connect to '{}': {}", path,
+                                       std::strerror(errno)) };
+  }
+  return client;
+}
+
+void Client::flush() {
+  size_t sent{ 0 };
+  while (sent < m_Output.size()) {
+    auto size{ ::send(m_Fd, m_Output.data() + sent, m_Output.size() - sent,
+                      MSG_NOSIGNAL | MSG_DONTWAIT) };
+    if (size >= 0) {
+      sent += static_cast<size_t>(size);
+      continue;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      throw ClientException{ fmt::format("Cannot send request: {}",
+                                         std::strerror(errno)) };
+    }
+    // the server stops reading while its responses are not read
+    pollfd ready{ .fd = m_Fd, .events = POLLIN | POLLOUT, .revents = 0 };
+    if (::poll(&ready, 1, -1) < 0 && errno != EINTR) {
+      throw ClientException{ fmt::format("Cannot wait for the server: {}",
+                                         std::strerror(errno)) };
+    }
+    if ((ready.revents & POLLIN) != 0) {
+      receiveSome(MSG_DONTWAIT);
+    }
+  }
+  m_Output.clear();
+}
+
+auto Client::receiveSome(int flags) -> bool {
+  std::array<char, 1 << 16> buffer{};
+  auto received{ ::recv(m_Fd, buffer.data(), buffer.size(), flags) };
+  if (received > 0) {
+    m_Input.append(buffer.data(), static_cast<size_t>(received));
+    return true;
+  }
+  if (received < 0 &&
+      (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) {
+    return false;
+  }
+  throw ClientException{
+    received == 0 ? std::string{ "Connection closed by the server" }
+                  : fmt::format("Cannot receive response: {}",
+                                std::strerror(errno))
+  };
+}
+
+#else
+
+Client::~Client() = default;
+
+auto Client::connect(const std::string& /*host*/, uint16_t /*port*/)
+    -> Client {
+  throw ClientException{ "The client is Linux only, as is the server" };
+}
+
+auto Client::connectUnix(const std::string& /*path*/) -> Client {
+  throw ClientException{ "The client is Linux only, as is the server" };
+}
+
+void Client::flush() {
+}
+
+auto Client::receiveSome(int /*flags*/) -> bool {
+  return false;
+}
+
+#endif
+
+Client::Client(Client&& other) noexcept
+    : m_Fd{ std::exchange(other.m_Fd, -1) },
+      m_Input{ std::move(other.m_Input) },
+      m_Consumed{ other.m_Consumed },
+      m_Output{ std::move(other.m_Output) },
+      m_NumPending{ other.m_NumPending } {
+}
+
+auto Client::operator=(Client&& other) noexcept -> Client& {
+  std::swap(m_Fd, other.m_Fd);
+  std::swap(m_Input, other.m_Input);
+  std::swap(m_Consumed, other.m_Consumed);
+  std::swap(m_Output, other.m_Output);
+  std::swap(m_NumPending, other.m_NumPending);
+  return *this;
+}
+
+auto Client::execute(std::string_view query) -> QueryResult {
+  checkNotPipelining();
+  writeStatement(MessageType::Query, query);
+  flush();
+  return receiveResult();
+}
+
+auto Client::execute(std::string_view query, const RowCallback& onRow)
+    -> size_t {
+  checkNotPipelining();
+  writeStatement(MessageType::Query, query);
+  flush();
+  return receiveResponse(MessageType::Complete, onRow).readU64();
+}
+
+auto Client::prepare(std::string_view query) -> Statement {
+  checkNotPipelining();
+  writeStatement(MessageType::Prepare, query);
+  flush();
+  auto prepared{ receiveResponse(MessageType::Prepared) };
+  auto id{ prepared.readU32() };
+  return { id, prepared.readU32() };
+}
+
+auto Client::execute(const Statement& statement,
+                     std::span<const Value> params) -> QueryResult {
+  checkNotPipelining();
+  writeExecute(statement, params);
+  flush();
+  return receiveResult();
+}
+
+void Client::close(const Statement& statement) {
+  checkNotPipelining();
+  {
+    MessageWriter request{ m_Output, MessageType::CloseStatement };
+    request.writeU32(statement.id);
+  }
+  flush();
+  receiveResponse(MessageType::Complete);
+}
+
+void Client::post(std::string_view query) {
+  writeStatement(MessageType::Query, query);
+  m_NumPending++;
+}
+
+void Client::post(const Statement& statement,
+                  std::span<const Value> params) {
+  writeExecute(statement, params);
+  m_NumPending++;
+}
+
+auto Client::getResult() -> QueryResult {
+  if (m_NumPending == 0) {
+    throw ClientException{ "No posted request to get the result of" };
+  }
+  flush();
+  m_NumPending--;
+  return receiveResult();
+}
+
+auto Client::getNumPending() const -> size_t {
+  return m_NumPending;
+}
+
+auto Client::receiveResult() -> QueryResult {
+  QueryResult result;
+  auto keep{ [&](std::vector<Value> row) {
+    result.rows.push_back(std::move(row));
+  } };
+  auto complete{ receiveResponse(MessageType::Complete, keep,
+                                 &result.columns) };
+  result.affectedRows = complete.readU64();
+  return result;
+}
+
+void Client::writeStatement(MessageType type, std::string_view query) {
+  MessageWriter request{ m_Output, type };
+  request.writeString(query);
+}
+
+void Client::writeExecute(const Statement& statement,
+                          std::span<const Value> params) {
+  MessageWriter request{ m_Output, MessageType::Execute };
+  request.writeU32(statement.id);
+  request.writeU32(params.size());
+  for (const auto& param : params) {
+    request.writeValue(param);
+  }
+}
+
+void Client::checkNotPipelining() const {
+  if (m_NumPending > 0) {
+    throw ClientException{ fmt::format(
+        "{} posted results must be read first", m_NumPending) };
+  }
+}
+
+auto Client::receive() -> MessageReader {
+  m_Input.erase(0, m_Consumed);
+  m_Consumed = 0;
+  while (true) {
+    size_t size{ 0 };
+    try {
+      size = getFrameSize(m_Input);
+    } catch (const ProtocolException& e) {
+      throw ClientException{ e.what() };
+    }
+    if (size > 0) {
+      m_Consumed = size;
+      return MessageReader{ std::string_view{ m_Input }.substr(0, size) };
+    }
+    receiveSome(0);
+  }
+}
+
+auto Client::receiveResponse(MessageType expected,
+                             const RowCallback& onRow,
+                             std::vector<std::string>* columns)
+    -> MessageReader {
+  size_t numColumns{ 0 };
+  try {
+    while (true) {
+      auto message{ receive() };
+      switch (message.getType()) {
+      case MessageType::Columns:
+        numColumns = message.readU32();
+        for (size_t i{ 0 }; i < numColumns; i++) {
+          auto name{ message.readString() };
+          if (columns != nullptr) {
+            columns->emplace_back(name);
+          }
+        }
+        break;
+      case MessageType::RowBatch: {
+        std::vector<std::vector<Value>> rows(message.readU32());
+        for (auto& row : rows) {
+          row.reserve(numColumns);
+        }
+        for (size_t j{ 0 }; j < numColumns; j++) {
+          auto column{ message.readColumn(rows.size()) };
+          for (size_t i{ 0 }; i < rows.size(); i++) {
+            rows[i].push_back(std::move(column[i]));
+          }
+        }
+        if (onRow) {
+          for (auto& row : rows) {
+            onRow(std::move(row));
+          }
+        }
+        break;
+      }
+      case MessageType::Error: {
+        auto code{ static_cast<ErrorCode>(message.readU8()) };
+        throw StatementException{ code,
+                                  std::string{ message.readString() } };
+      }
+      default:
+        if (message.getType() != expected) {
+          throw ClientException{ fmt::format(
+              "Unexpected message type {}",
+              static_cast<unsigned>(message.getType())) };
+        }
+        return message;
+      }
+    }
+  } catch (const ProtocolException& e) {
+    throw ClientException{ e.what() };
+  }
+}
+
+} // namespace adun
@@ -0,0 +1,357 @@
+#include "adun/CommitLog.hpp"
+#include "adun/MappedFile.hpp"
+#include "adun/Tracer.hpp"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fmt/format.h>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ADUN_HAS_FSYNC
+#include <unistd.h>
+#endif
+
+namespace adun {
+
+namespace {
+
+constexpr size_t s_RecordHeaderSize{ 8 };
+
+constexpr auto makeCrcTable() -> std::array<uint32_t, 256> {
+  std::array<uint32_t, 256> table{};
+  for (uint32_t i{ 0 }; i < table.size(); i++) {
+    uint32_t crc{ i };
+    for (int bit{ 0 }; bit < 8; bit++) {
+      crc = (crc & 1U) != 0 ? 0xEDB88320U ^ (crc >> 1U) : crc >> 1U;
+    }
+    table[i] = crc;
+  }
+  return table;
+}
+
+/// CRC-32 as in zlib
+auto crc32(std::string_view data) -> uint32_t {
+  static constexpr auto s_Table{ makeCrcTable() };
+  uint32_t crc{ 0xFFFFFFFFU };
+  for (auto c : data) {
+    crc = s_Table[(crc ^ static_cast<uint8_t>(c)) & 0xFFU] ^ (crc >> 8U);
+  }
+  return crc ^ 0xFFFFFFFFU;
+}
+
+template <typename T>
+void appendInt(std::string& out, T value) {
+  for (size_t i{ 0 }; i < sizeof(T); i++) {
+    out += static_cast<char>(value >> (i * 8U) & 0xFFU);
+  }
+}
+
+void appendBytes(std::string& out, std::string_view bytes) {
+  appendInt<uint32_t>(out, bytes.size());
+  out += bytes;
+}
+
+/// Reads a log front to back, every read is bounds checked as the tail
+/// may be torn
+class RecordReader {
+public:
+  explicit RecordReader(std::string_view data)
+      : m_Data{ data } {
+  }
+
+  template <typename T>
+  auto readInt() -> std::optional<T> {
+    if (m_Data.size() < sizeof(T)) {
+      return std::nullopt;
+    }
+    T value{ 0 };
+    for (size_t i{ 0 }; i < sizeof(T); i++) {
+      value |= static_cast<T>(static_cast<uint8_t>(m_Data[i]))
+               << (i * 8U);
+    }
+    m_Data.remove_prefix(sizeof(T));
+    return value;
+  }
+
+  auto readBytes(size_t size) -> std::optional<std::string_view> {
+    if (m_Data.size() < size) {
+      return std::nullopt;
+    }
+    auto bytes{ m_Data.substr(0, size) };
+    m_Data.remove_prefix(size);
+    return bytes;
+  }
+
+  auto readBytes() -> std::optional<std::string_view> {
+    auto size{ readInt<uint32_t>() };
+    return size ? readBytes(*size) : std::nullopt;
+  }
+
+  [[nodiscard]] auto atEnd() const -> bool {
+    return m_Data.empty();
+  }
+
+private:
+  std::string_view m_Data;
+};
+
+/// @returns nullopt if payload is malformed
+auto decode(std::string_view payload) -> std::optional<CommitLog::Record> {
+  CommitLog::Record record;
+  RecordReader reader{ payload };
+  while (!reader.atEnd()) {
+    auto kind{ reader.readInt<uint8_t>() };
+    auto table{ reader.readBytes() };
+    auto data{ reader.readBytes() };
+    if (!kind || !table || !data ||
+        *kind > static_cast<uint8_t>(CommitLog::Entry::Kind::Literals) ||
+        (*kind == static_cast<uint8_t>(CommitLog::Entry::Kind::Literals) &&
+         !CommitLog::decodeLiterals(*data))) {
+      return std::nullopt;
+    }
+    record.push_back({ static_cast<CommitLog::Entry::Kind>(*kind),
+                       std::string{ *table }, std::string{ *data } });
+  }
+  return record;
+}
+
+} // namespace
+
+CommitLog::CommitLog(std::string path)
+    : CommitLog{ std::move(path), Options{} } {
+}
+
+CommitLog::CommitLog(std::string path, Options options)
+    : m_Path{ std::move(path) },
+      m_Options{ options },
+      m_File{ std::fopen(m_Path.c_str(), "ab") } {
+  if (m_File == nullptr) {
+    throw FileException{ fmt::format("Cannot open '{}': {}", m_Path,
+                                     std::strerror(errno)) };
+  }
+  m_Flusher = std::jthread{ [this](const std::stop_token& stop) {
+    Tracer::setThreadName("adun commit log");
+    flushLoop(stop);
+  } };
+}
+
+CommitLog::~CommitLog() {
+  m_Flusher.request_stop();
+  m_Flusher.join();
+  std::fclose(m_File);
+}
+
+void CommitLog::replay(const std::function<void(const Record&)>& apply) {
+  size_t intactSize{ 0 };
+  {
+    MappedFile file{ m_Path };
+    auto data{ file.getView() };
+    RecordReader reader{ data };
+    while (true) {
+      auto size{ reader.readInt<uint32_t>() };
+      auto crc{ reader.readInt<uint32_t>() };
+      auto payload{ size ? reader.readBytes(*size) : std::nullopt };
+      if (!payload || crc32(*payload) != *crc) {
+        break;
+      }
+      auto record{ decode(*payload) };
+      if (!record) {
+        break;
+      }
+      apply(*record);
+      intactSize += s_RecordHeaderSize + payload->size();
+    }
+    if (intactSize == data.size()) {
+      return;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::resize_file(m_Path, intactSize, error);
+  if (error) {
+    throw FileException{ fmt::format("Cannot truncate '{}': {}", m_Path,
+                                     error.message()) };
+  }
+}
+
+void CommitLog::append(const Record& record) {
+  auto payload{ encode(record) };
+  std::string bytes;
+  bytes.reserve(s_RecordHeaderSize + payload.size());
+  appendInt<uint32_t>(bytes, payload.size());
+  appendInt<uint32_t>(bytes, crc32(payload));
+  bytes += payload;
+
+  std::unique_lock lock{ m_Mutex };
+  if (!m_Error.empty()) {
+    throw FileException{ m_Error };
+  }
+  m_Queue += bytes;
+  m_NumQueued++;
+  auto group{ m_FormingGroup };
+  m_RecordQueued.notify_one();
+
+  m_GroupSynced.wait(lock, [this, group] {
+    return m_SyncedGroup >= group || !m_Error.empty();
+  });
+  if (m_SyncedGroup < group) {
+    throw FileException{ m_Error };
+  }
+}
+
+auto CommitLog::getStats() const -> Stats {
+  std::lock_guard lock{ m_Mutex };
+  return m_Stats;
+}
+
+void CommitLog::flushLoop(const std::stop_token& stop) {
+  std::unique_lock lock{ m_Mutex };
+  while (true) {
+    // returns with an empty queue only once stop is requested
+    m_RecordQueued.wait(lock, stop, [this] { return m_NumQueued > 0; });
+    if (m_NumQueued == 0) {
+      return;
+    }
+    if (m_Options.maxDelay.count() > 0) {
+      m_RecordQueued.wait_for(lock, stop, m_Options.maxDelay, [this] {
+        return m_NumQueued >= m_Options.maxGroupSize;
+      });
+    }
+
+    std::string bytes;
+    std::swap(bytes, m_Queue);
+    auto numRecords{ std::exchange(m_NumQueued, 0) };
+    auto group{ m_FormingGroup++ };
+    // committers queue the next group meanwhile
+    lock.unlock();
+    auto start{ std::chrono::steady_clock::now() };
+    bool synced{ false };
+    {
+      TraceSpan span{ "log flush", "commit log" };
+      span.addArg("records", static_cast<int64_t>(numRecords));
+      span.addArg("bytes", static_cast<int64_t>(bytes.size()));
+      synced = writeAndSync(bytes);
+    }
+    auto syncTime{ std::chrono::steady_clock::now() - start };
+    auto error{ synced ? std::string{} : std::strerror(errno) };
+    lock.lock();
+
+    if (!synced) {
+      m_Error = fmt::format("Cannot write '{}': {}", m_Path, error);
+      m_GroupSynced.notify_all();
+      return;
+    }
+    m_SyncedGroup = group;
+    m_Stats.numGroups++;
+    m_Stats.numRecords += numRecords;
+    m_Stats.numBytes += bytes.size();
+    m_Stats.maxGroupSize = std::max(m_Stats.maxGroupSize, numRecords);
+    m_Stats.totalSyncTime += syncTime;
+    m_Stats.maxSyncTime = std::max<std::chrono::nanoseconds>(
+        m_Stats.maxSyncTime, syncTime);
+    m_GroupSynced.notify_all();
+  }
+}
+
+auto CommitLog::writeAndSync(const std::string& bytes) -> bool {
+  bool written{ std::fwrite(bytes.data(), 1, bytes.size(), m_File) ==
+                    bytes.size() &&
+                std::fflush(m_File) == 0 };
+#ifdef ADUN_HAS_FSYNC
+#ifdef __APPLE__
+  written = written && ::fsync(::fileno(m_File)) == 0;
+#else
+  written = written && ::fdatasync(::fileno(m_File)) == 0;
+#endif
+#endif
+  return written;
+}
+
+auto CommitLog::encodeLiterals(std::span<const Value> literals)
+    -> std::string {
+  std::string data;
+  for (const auto& literal : literals) {
+    if (literal.isEmpty() || literal.isNull()) {
+      appendInt<uint8_t>(data, static_cast<uint8_t>(ValueType::None));
+      continue;
+    }
+    appendInt<uint8_t>(data, static_cast<uint8_t>(literal.getType()));
+    literal.visit([&data](const auto& v) {
+      using T = std::remove_cvref_t<decltype(v)>;
+      if constexpr (std::is_same_v<T, int32_t>) {
+        appendInt<uint32_t>(data, static_cast<uint32_t>(v));
+      } else if constexpr (std::is_same_v<T, bool>) {
+        appendInt<uint8_t>(data, v ? 1 : 0);
+      } else if constexpr (std::is_same_v<T, std::string>) {
+        appendBytes(data, v);
+      } else if constexpr (std::is_same_v<T, ByteArray>) {
+        appendBytes(data, { reinterpret_cast<const char*>(v.data()),
+                            v.size() });
+      }
+    });
+  }
+  return data;
+}
+
+auto CommitLog::decodeLiterals(std::string_view data)
+    -> std::optional<std::vector<Value>> {
+  std::vector<Value> literals;
+  RecordReader reader{ data };
+  while (!reader.atEnd()) {
+    auto type{ reader.readInt<uint8_t>() };
+    switch (static_cast<ValueType>(*type)) {
+    case ValueType::Integer: {
+      auto value{ reader.readInt<uint32_t>() };
+      if (!value) {
+        return std::nullopt;
+      }
+      literals.emplace_back(static_cast<int32_t>(*value));
+      break;
+    }
+    case ValueType::Boolean: {
+      auto value{ reader.readInt<uint8_t>() };
+      if (!value) {
+        return std::nullopt;
+      }
+      literals.emplace_back(*value != 0);
+      break;
+    }
+    case ValueType::String:
+    case ValueType::Binary: {
+      auto bytes{ reader.readBytes() };
+      if (!bytes) {
+        return std::nullopt;
+      }
+      if (static_cast<ValueType>(*type) == ValueType::String) {
+        literals.emplace_back(std::string{ *bytes });
+      } else {
+        literals.emplace_back(ByteArray(bytes->begin(), bytes->end()));
+      }
+      break;
+    }
+    case ValueType::None:
+      literals.emplace_back();
+      break;
+    default:
+      return std::nullopt;
+    }
+  }
+  return literals;
+}
+
+auto CommitLog::encode(const Record& record) -> std::string {
+  std::string payload;
+  for (const auto& entry : record) {
+    appendInt<uint8_t>(payload, static_cast<uint8_t>(entry.kind));
+    appendBytes(payload, entry.table);
+    appendBytes(payload, entry.data);
+  }
+  return payload;
+}
+
+} // namespace adun
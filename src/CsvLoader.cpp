@@ -0,0 +1,426 @@
+#include "adun/CsvLoader.hpp"
+#include "adun/MappedFile.hpp"
+#include "adun/Parser/Utils.hpp"
+#include "adun/Tracer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <fmt/format.h>
+#include <iterator>
+#include <latch>
+#include <optional>
+#include <unordered_set>
+
+namespace adun {
+
+CsvException::CsvException(const std::string& msg)
+    : DatabaseException{ msg } {
+}
+
+namespace {
+
+/// Thrown while parsing chunks, which don't know their line numbers
+struct FieldError {
+  const char* pos;
+  std::string msg;
+};
+
+struct Field {
+  std::string_view text; ///< without surrounding quotes
+  bool quoted{ false };
+  bool hasEscapedQuotes{ false };
+};
+
+/// Reads fields of records between begin and end, begin must start a
+/// record
+class RecordReader {
+public:
+  RecordReader(const char* begin, const char* end)
+      : m_Pos{ begin },
+        m_End{ end } {
+  }
+
+  [[nodiscard]] auto getPos() const -> const char* {
+    return m_Pos;
+  }
+
+  /// @returns false if no records are left
+  auto skipBlankLines() -> bool {
+    while (m_Pos != m_End && (*m_Pos == '\n' || *m_Pos == '\r')) {
+      m_Pos++;
+    }
+    return m_Pos != m_End;
+  }
+
+  /// @returns true if field was the last one of its record
+  auto readField(Field& field) -> bool {
+    field = Field{};
+    if (m_Pos != m_End && *m_Pos == '"') {
+      readQuoted(field);
+    } else {
+      const auto* begin{ m_Pos };
+      while (m_Pos != m_End && *m_Pos != ',' && *m_Pos != '\n') {
+        m_Pos++;
+      }
+      field.text = { begin, m_Pos };
+      if (m_Pos != m_End && *m_Pos == '\n' &&
+          field.text.ends_with('\r')) {
+        field.text.remove_suffix(1);
+      }
+    }
+    return consumeSeparator();
+  }
+
+private:
+  /// "" stands for a quote inside quoted field
+  void readQuoted(Field& field) {
+    const auto* open{ m_Pos };
+    const auto* begin{ ++m_Pos };
+    while (true) {
+      const auto* quote{ static_cast<const char*>(
+          std::memchr(m_Pos, '"', m_End - m_Pos)) };
+      if (quote == nullptr) {
+        throw FieldError{ open, "Unterminated quoted field" };
+      }
+      if (quote + 1 != m_End && quote[1] == '"') {
+        field.hasEscapedQuotes = true;
+        m_Pos                  = quote + 2;
+        continue;
+      }
+      field.text   = { begin, quote };
+      field.quoted = true;
+      m_Pos        = quote + 1;
+      break;
+    }
+    if (m_Pos != m_End && *m_Pos == '\r') {
+      m_Pos++;
+      if (m_Pos != m_End && *m_Pos != '\n') {
+        throw FieldError{ m_Pos, "Unexpected carriage return" };
+      }
+    }
+    if (m_Pos != m_End && *m_Pos != ',' && *m_Pos != '\n') {
+      throw FieldError{ m_Pos, "Expected ',' after quoted field" };
+    }
+  }
+
+  auto consumeSeparator() -> bool {
+    if (m_Pos == m_End) {
+      return true;
+    }
+    return *m_Pos++ == '\n';
+  }
+
+  const char* m_Pos;
+  const char* m_End;
+};
+
+auto unquote(const Field& field) -> std::string {
+  if (!field.hasEscapedQuotes) {
+    return std::string{ field.text };
+  }
+  std::string result;
+  result.reserve(field.text.size());
+  for (size_t i{ 0 }; i < field.text.size(); i++) {
+    result += field.text[i];
+    if (field.text[i] == '"') {
+      i++; // skip the second quote of ""
+    }
+  }
+  return result;
+}
+
+auto hexDigitValue(char c) -> int {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  c = static_cast<char>(std::tolower(c));
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+auto parseInteger(std::string_view text) -> std::optional<int32_t> {
+  if (text.starts_with('+')) {
+    text.remove_prefix(1);
+  }
+  int32_t value{};
+  auto [ptr, ec]{ std::from_chars(text.begin(), text.end(), value) };
+  if (ec != std::errc{} || ptr != text.end()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+auto parseBoolean(std::string_view text) -> std::optional<bool> {
+  auto equalsIgnoreCase{ [text](std::string_view word) {
+    return std::ranges::equal(text, word, [](char a, char b) {
+      return std::tolower(a) == b;
+    });
+  } };
+  if (text == "1" || equalsIgnoreCase("true")) {
+    return true;
+  }
+  if (text == "0" || equalsIgnoreCase("false")) {
+    return false;
+  }
+  return std::nullopt;
+}
+
+/// Odd digit count is padded from the left, like hex literals in queries
+auto parseBytes(std::string_view text) -> std::optional<ByteArray> {
+  if (text.starts_with("0x") || text.starts_with("0X")) {
+    text.remove_prefix(2);
+  }
+  if (!std::ranges::all_of(
+          text, [](char c) { return hexDigitValue(c) >= 0; })) {
+    return std::nullopt;
+  }
+
+  ByteArray result;
+  result.reserve((text.size() + 1) / 2);
+  if (text.size() % 2 != 0) {
+    result.push_back(hexDigitValue(text.front()));
+    text.remove_prefix(1);
+  }
+  for (size_t i{ 0 }; i < text.size(); i += 2) {
+    result.push_back(hexDigitValue(text[i]) * 16 +
+                     hexDigitValue(text[i + 1]));
+  }
+  return result;
+}
+
+auto convertField(const Field& field, ValueType type) -> Value {
+  if (field.text.empty() && !field.quoted) {
+    return Value{}; // filled by Table::appendRows
+  }
+
+  auto fail{ [&field, type] {
+    return FieldError{ field.text.data(),
+                       fmt::format("Cannot convert '{}' to {}",
+                                   field.text,
+                                   Value::typeToString(type)) };
+  } };
+
+  switch (type) {
+  case ValueType::Integer:
+    if (auto value{ parseInteger(field.text) }) {
+      return *value;
+    }
+    throw fail();
+  case ValueType::Boolean:
+    if (auto value{ parseBoolean(field.text) }) {
+      return *value;
+    }
+    throw fail();
+  case ValueType::String:
+    return unquote(field);
+  case ValueType::Binary:
+    if (auto value{ parseBytes(field.text) }) {
+      return std::move(*value);
+    }
+    throw fail();
+  default:
+    throw fail();
+  }
+}
+
+/// Shared with pool tasks, which may start after the load is over
+struct ChunkJob {
+  explicit ChunkJob(std::vector<const char*> chunkBounds)
+      : bounds{ std::move(chunkBounds) },
+        results(bounds.size() - 1),
+        errors(bounds.size() - 1),
+        chunksLeft{ static_cast<std::ptrdiff_t>(bounds.size() - 1) } {
+  }
+
+  std::vector<const char*> bounds;
+  std::vector<std::vector<std::vector<Value>>> results;
+  std::vector<std::exception_ptr> errors;
+  std::atomic<size_t> nextChunk{ 0 };
+  std::latch chunksLeft;
+};
+
+} // namespace
+
+CsvLoader::CsvLoader(Table& table, ThreadPool& pool)
+    : m_Table{ table },
+      m_Pool{ pool } {
+}
+
+CsvLoader::CsvLoader(Table& table, Table::PendingWrite& write,
+                     ThreadPool& pool)
+    : m_Table{ table },
+      m_Write{ &write },
+      m_Pool{ pool } {
+}
+
+auto CsvLoader::loadFile(const std::string& path) -> size_t {
+  MappedFile file{ path };
+  return loadFile(file, path);
+}
+
+auto CsvLoader::loadFile(const MappedFile& file, const std::string& path)
+    -> size_t {
+  try {
+    return load(file.getView());
+  } catch (const CsvException& e) {
+    throw CsvException{ fmt::format("{}: {}", path, e.what()) };
+  }
+}
+
+auto CsvLoader::load(std::string_view text) -> size_t {
+  const auto* begin{ text.data() };
+  const auto* end{ begin + text.size() };
+  try {
+    const auto* body{ parseHeader(text) };
+    auto job{ makeRef<ChunkJob>(splitIntoChunks(body, end)) };
+
+    // tasks only touch the loader while they own a chunk
+    auto work{ [this, job] {
+      for (size_t i{ job->nextChunk++ }; i < job->results.size();
+           i = job->nextChunk++) {
+        try {
+          TraceSpan span{ "csv chunk", "copy" };
+          span.addArg("chunk", static_cast<int64_t>(i));
+          job->results[i] =
+              parseChunk(job->bounds[i], job->bounds[i + 1]);
+          span.addArg("rows",
+                      static_cast<int64_t>(job->results[i].size()));
+        } catch (...) {
+          job->errors[i] = std::current_exception();
+        }
+        job->chunksLeft.count_down();
+      }
+    } };
+    for (size_t i{ 1 }; i < job->results.size(); i++) {
+      m_Pool.post(work);
+    }
+    // the caller takes chunks too, so loading from a pool thread can't
+    // deadlock waiting for busy workers
+    work();
+    job->chunksLeft.wait();
+
+    size_t numRows{ 0 };
+    for (size_t i{ 0 }; i < job->results.size(); i++) {
+      if (job->errors[i]) {
+        std::rethrow_exception(job->errors[i]);
+      }
+      numRows += job->results[i].size();
+    }
+
+    Rows rows;
+    rows.reserve(numRows);
+    for (auto& chunk : job->results) {
+      std::ranges::move(chunk, std::back_inserter(rows));
+    }
+    if (m_Write != nullptr) {
+      m_Table.appendRows(std::move(rows), *m_Write);
+    } else {
+      m_Table.appendRows(std::move(rows));
+    }
+    return numRows;
+  } catch (const FieldError& e) {
+    auto line{ std::count(begin, e.pos, '\n') + 1 };
+    throw CsvException{ fmt::format("Line {}: {}", line, e.msg) };
+  }
+}
+
+auto CsvLoader::parseHeader(std::string_view text) -> const char* {
+  RecordReader reader{ text.data(), text.data() + text.size() };
+  if (!reader.skipBlankLines()) {
+    throw CsvException{ "Missing header record" };
+  }
+
+  const auto& scheme{ m_Table.getScheme() };
+  m_FieldColumns.clear();
+  m_FieldTypes.clear();
+  std::unordered_set<size_t> seen;
+  Field field;
+  bool lastField{ false };
+  while (!lastField) {
+    lastField = reader.readField(field);
+    auto name{ unquote(field) };
+    auto it{ scheme.find(name) };
+    if (it == scheme.end()) {
+      throw NoSuchColumnException(name);
+    }
+    if (!seen.insert(it->second.index).second) {
+      throw CsvException{ fmt::format("Column {} is listed twice",
+                                      name) };
+    }
+    m_FieldColumns.push_back(it->second.index);
+    m_FieldTypes.push_back(it->second.getType());
+  }
+  return reader.getPos();
+}
+
+auto CsvLoader::parseChunk(const char* begin, const char* end) const
+    -> Rows {
+  auto numColumns{ m_Table.getScheme().size() };
+  auto numFields{ m_FieldColumns.size() };
+
+  Rows rows;
+  // rough guess to avoid most regrowth
+  rows.reserve(static_cast<size_t>(end - begin) / (numFields * 8 + 1));
+  RecordReader reader{ begin, end };
+  Field field;
+  while (reader.skipBlankLines()) {
+    const auto* recordBegin{ reader.getPos() };
+    auto& values{ rows.emplace_back(numColumns) };
+    size_t i{ 0 };
+    bool lastField{ false };
+    while (!lastField) {
+      lastField = reader.readField(field);
+      if (i == numFields) {
+        throw FieldError{ recordBegin,
+                          fmt::format("Expected {} fields", numFields) };
+      }
+      values[m_FieldColumns[i]] = convertField(field, m_FieldTypes[i]);
+      i++;
+    }
+    if (i != numFields) {
+      throw FieldError{ recordBegin,
+                        fmt::format("Expected {} fields, got {}",
+                                    numFields, i) };
+    }
+  }
+  return rows;
+}
+
+auto CsvLoader::splitIntoChunks(const char* begin, const char* end) const
+    -> std::vector<const char*> {
+  auto size{ static_cast<size_t>(end - begin) };
+  auto numChunks{ std::clamp(size / s_MinChunkSize, size_t{ 1 },
+                             m_Pool.getNumThreads()) };
+  auto chunkSize{ size / numChunks };
+
+  std::vector<const char*> bounds{ begin };
+  // a newline only ends a record outside quotes, so quote parity is
+  // carried from the start
+  bool inQuotes{ false };
+  const auto* scanned{ begin };
+  for (size_t i{ 1 }; i < numChunks; i++) {
+    const auto* it{ std::max(begin + i * chunkSize, scanned) };
+    inQuotes ^= std::count(scanned, it, '"') % 2 != 0;
+    for (; it != end; it++) {
+      if (*it == '"') {
+        inQuotes = !inQuotes;
+      } else if (*it == '\n' && !inQuotes) {
+        break;
+      }
+    }
+    if (it == end || it + 1 == end) {
+      break;
+    }
+    scanned = it + 1;
+    bounds.push_back(scanned);
+  }
+  bounds.push_back(end);
+  return bounds;
+}
+
+} // namespace adun
@@ -1,18 +1,454 @@
 #include "adun/Database.hpp"
+#include "adun/CsvLoader.hpp"
+#include "adun/MappedFile.hpp"
+#include "adun/Parser/Arena.hpp"
 #include "adun/Parser/Lexer.hpp"
 #include "adun/Parser/Parser.hpp"
+#include "adun/Tracer.hpp"
+#include <boost/stacktrace.hpp>
+#include <fmt/format.h>
+#include <fstream>
 
 namespace adun {
 
+Database::Database(const std::string& logPath,
+                   CommitLog::Options logOptions) {
+  auto log{ makeUnique<CommitLog>(logPath, logOptions) };
+  try {
+    log->replay([this](const CommitLog::Record& record) { redo(record); });
+  } catch (const std::exception& e) {
+    throw FileException{ fmt::format("Cannot recover from '{}': {}",
+                                     logPath, e.what()) };
+  }
+  // not logging what is redone
+  m_CommitLog = std::move(log);
+}
+
 auto Database::execute(const std::string& queryString) -> Result {
+  return Session{ *this }.execute(queryString);
+}
+
+auto Database::executeScript(std::string_view script)
+    -> std::vector<Result> {
+  return Session{ *this }.executeScript(script);
+}
+
+auto Database::executeAsync(std::string query) -> std::future<Result> {
+  return getThreadPool().submit(
+      [this, query = std::move(query)] { return execute(query); });
+}
+
+auto Database::executeAwaitable(std::string query) -> QueryAwaitable {
+  return { getThreadPool(),
+           [this, query = std::move(query)] { return execute(query); } };
+}
+
+auto Database::runCommand(const Ref<TokenList>& tokens,
+                          const std::function<Result(ast::Command&)>& run,
+                          QueryMetrics::Sample* sample,
+                          std::span<const Value> literals) -> Result {
+  using Clock = std::chrono::steady_clock;
+  auto record{ [this, sample](bool failed) {
+    if (sample) {
+      sample->failed = failed;
+      m_Metrics.record(*sample);
+    }
+  } };
+
+  auto parseStart{ Clock::now() };
+  QueryCache::NormalizedQuery normalized;
+  std::optional<QueryCache::CachedCommand> cached;
+  {
+    TraceSpan span{ "plan", "planner" };
+    normalized = QueryCache::normalize(*tokens);
+    if (!literals.empty() && literals.size() != normalized.numLiterals) {
+      record(true);
+      throw CommandException{ fmt::format(
+          "Statement takes {} parameters, got {}", normalized.numLiterals,
+          literals.size()) };
+    }
+    // taken out of the cache, as literals are bound into the AST in place
+    cached = literals.empty() ? m_QueryCache.take(normalized, *tokens)
+                              : m_QueryCache.take(normalized, literals);
+    span.addArg("cached", cached.has_value() ? 1 : 0);
+  }
+  bool wasCached{ cached.has_value() };
+  // released at once at the end of the query unless the cache keeps it
+  Unique<Arena> arena;
+  ast::Command* query{ nullptr };
+  if (cached) {
+    arena = std::move(cached->arena);
+    query = cached->command;
+  } else {
+    arena = makeUnique<Arena>();
+    try {
+      Parser parser{ tokens, *arena };
+      query = parser.buildAST();
+      if (!literals.empty()) {
+        query->bindLiterals(literals);
+      }
+    } catch (...) {
+      if (sample) {
+        sample->parseTime = Clock::now() - parseStart;
+        sample->failed    = true;
+        logSlowQuery(nullptr, *tokens, *sample);
+      }
+      record(true);
+      throw;
+    }
+  }
+
+  auto kind{ query->getKind() };
+  auto executeStart{ Clock::now() };
+  if (sample) {
+    sample->kind      = QueryMetrics::getCommandKind(kind);
+    sample->parseTime = executeStart - parseStart;
+  }
+  auto countEvents{ sample && getHardwareCounters() };
+  auto startEvents{ countEvents ? PerfCounters::forThisThread().read()
+                                : PerfCounters::Values{} };
+  auto stopEvents{ [&] {
+    if (countEvents) {
+      sample->executeEvents =
+          PerfCounters::forThisThread().read() - startEvents;
+    }
+  } };
+  Result result;
+  try {
+    // names are literals, as the tracer wants them
+    TraceSpan span{ QueryMetrics::getCommandName(
+                        QueryMetrics::getCommandKind(kind))
+                        .data(),
+                    "query" };
+    result = run(*query);
+    span.addArg("rows scanned",
+                static_cast<int64_t>(result.getNumScannedRows()));
+    span.addArg("rows", static_cast<int64_t>(result.getNumRows()));
+  } catch (...) {
+    stopEvents();
+    if (sample) {
+      sample->executeTime = Clock::now() - executeStart;
+      sample->failed      = true;
+      logSlowQuery(query, *tokens, *sample);
+    }
+    // the plan is still fine, only this execution failed
+    if (wasCached) {
+      m_QueryCache.insert(std::move(normalized), std::move(arena), query);
+    }
+    record(true);
+    throw;
+  }
+  stopEvents();
+  if (sample) {
+    sample->executeTime  = Clock::now() - executeStart;
+    sample->rowsScanned  = result.getNumScannedRows();
+    sample->rowsReturned = result.getNumRows();
+    if (kind == ast::NodeKind::InsertCommand ||
+        kind == ast::NodeKind::UpdateCommand ||
+        kind == ast::NodeKind::DeleteCommand ||
+        kind == ast::NodeKind::CopyCommand) {
+      sample->rowsAffected = result.getNumAffectedRows();
+    }
+    logSlowQuery(query, *tokens, *sample);
+  }
+
+  // schema changes and bulk loads are one-off, don't let them evict hot
+  // queries
+  if (kind != ast::NodeKind::CreateCommand &&
+      kind != ast::NodeKind::CopyCommand) {
+    m_QueryCache.insert(std::move(normalized), std::move(arena), query);
+  }
+  record(false);
+  return result;
+}
+
+auto Database::executeCommand(ast::Command& command,
+                              const TokenList& tokens, Transaction& txn,
+                              std::span<const Value> literals) -> Result {
+  MemoryTracker memory;
+  txn.setQueryMemory(&memory);
+  Result result;
+  try {
+    result = command.execute(txn);
+  } catch (...) {
+    txn.setQueryMemory(nullptr);
+    throw;
+  }
+  txn.setQueryMemory(nullptr);
+  result.setPeakMemory(memory.getPeak());
+
+  auto logStatement{ [&] {
+    txn.log({ CommitLog::Entry::Kind::Statement, {},
+              std::string{ getSourceText(tokens) } });
+    if (!literals.empty()) {
+      txn.log({ CommitLog::Entry::Kind::Literals, {},
+                CommitLog::encodeLiterals(literals) });
+    }
+  } };
+
+  switch (command.getKind()) {
+  case ast::NodeKind::CreateCommand:
+  case ast::NodeKind::InsertCommand:
+  case ast::NodeKind::UpdateCommand:
+  case ast::NodeKind::DeleteCommand:
+    // statements are deterministic, redoing them in commit order
+    // reproduces the tables
+    if (m_CommitLog) {
+      logStatement();
+    }
+    break;
+  case ast::NodeKind::ExplainCommand: {
+    // EXPLAIN ANALYZE applies the statement too
+    const auto& explain{ static_cast<ast::ExplainCommand&>(command) };
+    if (m_CommitLog && explain.isAnalyze() &&
+        explain.getCommand().getKind() != ast::NodeKind::SelectCommand) {
+      logStatement();
+    }
+    break;
+  }
+  default:
+    // COPY logs the loaded data itself
+    break;
+  }
+  return result;
+}
+
+void Database::redo(const CommitLog::Record& record) {
+  Transaction txn{ *this };
+  for (auto it{ record.begin() }; it != record.end(); it++) {
+    switch (it->kind) {
+    case CommitLog::Entry::Kind::Statement: {
+      Lexer lexer;
+      lexer.lex(it->data);
+      std::vector<Value> literals;
+      if (auto next{ it + 1 }; next != record.end() &&
+                               next->kind ==
+                                   CommitLog::Entry::Kind::Literals) {
+        // checked when the record was read
+        literals = *CommitLog::decodeLiterals(next->data);
+        it       = next;
+      }
+      runCommand(
+          lexer.getTokens(),
+          [&txn](ast::Command& command) { return command.execute(txn); },
+          nullptr, literals);
+      break;
+    }
+    case CommitLog::Entry::Kind::Csv: {
+      auto view{ txn.write(it->table) };
+      CsvLoader{ view.table, view.write, getThreadPool() }.load(it->data);
+      break;
+    }
+    case CommitLog::Entry::Kind::Literals:
+      // consumed with their statement
+      break;
+    }
+  }
+  txn.commit();
+}
+
+void Database::logSlowQuery(ast::Command* command,
+                            const TokenList& tokens,
+                            const QueryMetrics::Sample& sample) {
+  auto time{ sample.lexTime + sample.parseTime + sample.executeTime };
+  if (time < m_SlowQueryThreshold.load(std::memory_order_relaxed)) {
+    return;
+  }
+  Ref<SlowQueryLog> log;
+  {
+    std::lock_guard lock{ m_SlowQueryLogMutex };
+    log = m_SlowQueryLog;
+  }
+  if (!log) {
+    return;
+  }
+
+  SlowQueryLog::Entry entry{ std::chrono::system_clock::now(),
+                             std::string{ getSourceText(tokens) },
+                             sample,
+                             {},
+                             {} };
+  const auto& options{ log->getOptions() };
+  if (options.capturePlan && command != nullptr) {
+    // planned again, execution doesn't keep its plan
+    try {
+      QueryPlan plan;
+      Transaction txn{ *this };
+      command->explain(txn, plan);
+      entry.plan = plan.format(false);
+    } catch (const std::exception&) {
+      // not explainable, or failing like the statement did
+    }
+  }
+  if (options.captureStacktrace) {
+    entry.stacktrace =
+        boost::stacktrace::to_string(boost::stacktrace::stacktrace());
+  }
+  try {
+    log->record(std::move(entry));
+  } catch (const FileException&) {
+    // a broken log file must not fail the statement, the entry is kept
+    // in memory
+  }
+}
+
+auto Database::importCsv(const std::string& tableName,
+                         const std::string& path) -> size_t {
+  Transaction txn{ *this };
+  auto numRows{ importCsv(txn, tableName, path) };
+  txn.commit();
+  return numRows;
+}
+
+auto Database::importCsv(Transaction& txn, const std::string& tableName,
+                         const std::string& path) -> size_t {
+  auto view{ txn.write(tableName) };
+  CsvLoader loader{ view.table, view.write, getThreadPool() };
+  if (!m_CommitLog) {
+    return loader.loadFile(path);
+  }
+
+  // logged as data, recovery can't count on the file being still there
+  MappedFile file{ path };
+  auto numRows{ loader.loadFile(file, path) };
+  txn.log({ CommitLog::Entry::Kind::Csv, tableName,
+            std::string{ file.getView() } });
+  return numRows;
+}
+
+auto Database::exportCsv(const std::string& tableName,
+                         const std::string& path) -> size_t {
+  Transaction txn{ *this };
+  return exportCsv(txn, tableName, path);
+}
+
+auto Database::exportCsv(Transaction& txn, const std::string& tableName,
+                         const std::string& path) -> size_t {
+  auto view{ txn.read(tableName) };
+  std::ofstream file{ path, std::ios::binary };
+  if (!file) {
+    throw FileException{ fmt::format("Cannot open '{}'", path) };
+  }
+  return RowWriter::create(ExportFormat::Csv, file)
+      ->write(
+          view.table, view.snapshot, [](const Row&) { return true; },
+          view.table.getColumnNames());
+}
+
+auto Database::exportQuery(const std::string& selectQuery,
+                           std::ostream& out, ExportFormat format)
+    -> size_t {
   Lexer lexer;
-  lexer.lex(queryString);
-  auto tokens{ lexer.getTokens() };
+  lexer.lex(selectQuery);
+  // one-off like bulk loads, so the query cache is bypassed
+  Arena arena;
+  Parser parser{ lexer.getTokens(), arena };
+  auto* query{ parser.buildAST() };
+  if (query->getKind() != ast::NodeKind::SelectCommand) {
+    throw CommandException{ "Only SELECT queries can be exported" };
+  }
+  auto writer{ RowWriter::create(format, out) };
+  Transaction txn{ *this };
+  return static_cast<ast::SelectCommand*>(query)->exportRows(txn,
+                                                             *writer);
+}
 
-  Parser parser{ tokens };
-  auto query{ parser.buildAST() };
+auto Database::getThreadPool() -> ThreadPool& {
+  std::call_once(m_ThreadPoolStarted,
+                 [this] { m_ThreadPool = makeUnique<ThreadPool>(); });
+  return *m_ThreadPool;
+}
+
+auto Database::findTable(const std::string& name) -> Table& {
+  auto it{ m_Tables.find(name) };
+  if (it == m_Tables.end()) {
+    throw CommandException{ fmt::format("Table '{}' does not exist",
+                                        name) };
+  }
+  return it->second;
+}
+
+auto Database::getQueryCacheStats() const -> QueryCache::Stats {
+  return m_QueryCache.getStats();
+}
+
+auto Database::getCommitLogStats() const -> CommitLog::Stats {
+  return m_CommitLog ? m_CommitLog->getStats() : CommitLog::Stats{};
+}
+
+auto Database::getMetrics() const -> QueryMetrics::Snapshot {
+  return m_Metrics.getSnapshot();
+}
+
+void Database::setQueryCacheCapacity(size_t capacity) {
+  m_QueryCache.setCapacity(capacity);
+}
+
+auto Database::getMemoryUsage() const -> size_t {
+  return m_Memory.getUsed();
+}
+
+auto Database::getMemoryUsage(const std::string& tableName)
+    -> Table::MemoryUsage {
+  std::shared_lock catalogLock{ m_CatalogMutex };
+  return findTable(tableName).getMemoryUsage();
+}
+
+void Database::setMemoryLimit(size_t bytes) {
+  m_Memory.setLimit(bytes);
+}
+
+auto Database::getMemoryLimit() const -> size_t {
+  return m_Memory.getLimit();
+}
+
+void Database::setSlowQueryLog(SlowQueryLog::Options options) {
+  auto log{ makeRef<SlowQueryLog>(std::move(options)) };
+  auto threshold{ log->getOptions().threshold };
+  std::lock_guard lock{ m_SlowQueryLogMutex };
+  m_SlowQueryLog = std::move(log);
+  m_SlowQueryThreshold.store(threshold, std::memory_order_relaxed);
+}
+
+void Database::disableSlowQueryLog() {
+  std::lock_guard lock{ m_SlowQueryLogMutex };
+  m_SlowQueryLog.reset();
+  m_SlowQueryThreshold.store(std::chrono::nanoseconds::max(),
+                             std::memory_order_relaxed);
+}
+
+auto Database::getSlowQueries() const -> std::vector<SlowQueryLog::Entry> {
+  Ref<SlowQueryLog> log;
+  {
+    std::lock_guard lock{ m_SlowQueryLogMutex };
+    log = m_SlowQueryLog;
+  }
+  return log ? log->getEntries() : std::vector<SlowQueryLog::Entry>{};
+}
+
+void Database::setHardwareCounters(bool enabled) {
+  m_HardwareCounters.store(enabled, std::memory_order_relaxed);
+}
+
+auto Database::getHardwareCounters() const -> bool {
+  return m_HardwareCounters.load(std::memory_order_relaxed);
+}
+
+void Database::setLockTimeout(std::chrono::milliseconds timeout) {
+  m_LockTimeout.store(timeout, std::memory_order_relaxed);
+}
+
+auto Database::getLockTimeout() const -> std::chrono::milliseconds {
+  return m_LockTimeout.load(std::memory_order_relaxed);
+}
+
+void Database::setStatementTimeout(std::chrono::milliseconds timeout) {
+  m_StatementTimeout.store(timeout, std::memory_order_relaxed);
+}
 
-  return query->execute(*this);
+auto Database::getStatementTimeout() const
+    -> std::chrono::milliseconds {
+  return m_StatementTimeout.load(std::memory_order_relaxed);
 }
 
 } // namespace adun
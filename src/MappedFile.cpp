@@ -0,0 +1,79 @@
+#include "adun/MappedFile.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fmt/format.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ADUN_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <sstream>
+#endif
+
+namespace adun {
+
+#ifdef ADUN_HAS_MMAP
+
+MappedFile::MappedFile(const std::string& path) {
+  int fd{ ::open(path.c_str(), O_RDONLY) };
+  if (fd < 0) {
+    throw FileException{ fmt::format("Cannot open '{}': {}", path,
+                                     std::strerror(errno)) };
+  }
+
+  struct stat info {};
+  if (::fstat(fd, &info) != 0) {
+    ::close(fd);
+    throw FileException{ fmt::format("Cannot stat '{}': {}", path,
+                                     std::strerror(errno)) };
+  }
+
+  m_Size = static_cast<size_t>(info.st_size);
+  // mapping zero bytes is an error
+  if (m_Size > 0) {
+    void* data{ ::mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fd, 0) };
+    if (data == MAP_FAILED) {
+      ::close(fd);
+      throw FileException{ fmt::format("Cannot map '{}': {}", path,
+                                       std::strerror(errno)) };
+    }
+    // whole file is read front to back exactly once
+    ::madvise(data, m_Size, MADV_SEQUENTIAL);
+    m_Data = static_cast<const char*>(data);
+  }
+  ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (m_Data != nullptr) {
+    ::munmap(const_cast<char*>(m_Data), m_Size); // NOLINT
+  }
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) {
+  std::ifstream file{ path, std::ios::binary };
+  if (!file) {
+    throw FileException{ fmt::format("Cannot open '{}'", path) };
+  }
+  std::ostringstream contents;
+  contents << file.rdbuf();
+  m_Buffer = std::move(contents).str();
+  m_Data   = m_Buffer.data();
+  m_Size   = m_Buffer.size();
+}
+
+MappedFile::~MappedFile() = default;
+
+#endif
+
+auto MappedFile::getView() const -> std::string_view {
+  return { m_Data, m_Size };
+}
+
+} // namespace adun
@@ -0,0 +1,73 @@
+#include "adun/MemoryTracker.hpp"
+#include <fmt/format.h>
+
+namespace adun {
+
+MemoryTracker::MemoryTracker(MemoryTracker* parent)
+    : m_Parent{ parent } {
+}
+
+MemoryTracker::~MemoryTracker() {
+  if (m_Parent != nullptr) {
+    m_Parent->release(getUsed());
+  }
+}
+
+void MemoryTracker::reserve(size_t bytes) {
+  auto used{ m_Used.fetch_add(bytes, std::memory_order_relaxed) + bytes };
+  auto limit{ getLimit() };
+  if (limit != 0 && used > limit) {
+    m_Used.fetch_sub(bytes, std::memory_order_relaxed);
+    throw MemoryLimitException{ fmt::format(
+        "Memory limit of {} bytes exceeded, {} bytes more needed", limit,
+        used - limit) };
+  }
+  if (m_Parent != nullptr) {
+    try {
+      m_Parent->reserve(bytes);
+    } catch (...) {
+      m_Used.fetch_sub(bytes, std::memory_order_relaxed);
+      throw;
+    }
+  }
+  updatePeak(used);
+}
+
+void MemoryTracker::charge(size_t bytes) noexcept {
+  updatePeak(m_Used.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+  if (m_Parent != nullptr) {
+    m_Parent->charge(bytes);
+  }
+}
+
+void MemoryTracker::release(size_t bytes) noexcept {
+  m_Used.fetch_sub(bytes, std::memory_order_relaxed);
+  if (m_Parent != nullptr) {
+    m_Parent->release(bytes);
+  }
+}
+
+auto MemoryTracker::getUsed() const -> size_t {
+  return m_Used.load(std::memory_order_relaxed);
+}
+
+auto MemoryTracker::getPeak() const -> size_t {
+  return m_Peak.load(std::memory_order_relaxed);
+}
+
+void MemoryTracker::setLimit(size_t bytes) {
+  m_Limit.store(bytes, std::memory_order_relaxed);
+}
+
+auto MemoryTracker::getLimit() const -> size_t {
+  return m_Limit.load(std::memory_order_relaxed);
+}
+
+void MemoryTracker::updatePeak(size_t used) {
+  auto peak{ m_Peak.load(std::memory_order_relaxed) };
+  while (used > peak && !m_Peak.compare_exchange_weak(
+                            peak, used, std::memory_order_relaxed)) {
+  }
+}
+
+} // namespace adun
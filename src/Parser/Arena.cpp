@@ -0,0 +1,31 @@
+#include "adun/Parser/Arena.hpp"
+
+namespace adun {
+
+Arena::Arena()
+    : m_Resource{ m_InlineBuffer.data(), m_InlineBuffer.size() } {
+}
+
+Arena::~Arena() {
+  // finalizers are prepended, so nodes die in reverse creation order
+  for (auto* finalizer{ m_Finalizers }; finalizer != nullptr;
+       finalizer = finalizer->next) {
+    finalizer->destroy(finalizer->object);
+  }
+}
+
+auto Arena::getBytesUsed() const -> size_t {
+  return m_BytesUsed;
+}
+
+auto Arena::allocate(size_t size, size_t alignment) -> void* {
+  m_BytesUsed += size;
+  return m_Resource.allocate(size, alignment);
+}
+
+void Arena::registerFinalizer(void* object, void (*destroy)(void*)) {
+  auto* memory{ allocate(sizeof(Finalizer), alignof(Finalizer)) };
+  m_Finalizers = new (memory) Finalizer{ destroy, object, m_Finalizers };
+}
+
+} // namespace adun
@@ -2,24 +2,30 @@
 
 namespace adun::ast {
 
-BinOpExpr::BinOpExpr(Ref<ExpressionNode> lhs, Ref<ExpressionNode> rhs,
+BinOpExpr::BinOpExpr(ExpressionNode* lhs, ExpressionNode* rhs,
                      TokenKind op)
     : ExpressionNode{ NodeKind::BinOpExpr },
       m_Op{ op },
-      m_Lhs{ std::move(lhs) },
-      m_Rhs{ std::move(rhs) } {
+      m_Lhs{ lhs },
+      m_Rhs{ rhs } {
+}
+
+auto BinOpExpr::toString() const -> std::string {
+  return "(" + m_Lhs->toString() + " " +
+         std::string{ getPunctuatorSpelling(m_Op) } + " " +
+         m_Rhs->toString() + ")";
 }
 
 auto BinOpExpr::getOp() const -> TokenKind {
   return m_Op;
 }
 
-auto BinOpExpr::getLhs() -> Ref<ExpressionNode> {
+auto BinOpExpr::getLhs() -> ExpressionNode* {
   return m_Lhs;
 }
 
-auto BinOpExpr::getRhs() -> Ref<ExpressionNode> {
+auto BinOpExpr::getRhs() -> ExpressionNode* {
   return m_Rhs;
 }
 
-}  // namespace adun::ast
+} // namespace adun::ast
@@ -0,0 +1,14 @@
+#include "adun/Parser/CopyCommand.hpp"
+#include "adun/Database.hpp"
+
+namespace adun::ast {
+
+auto CopyCommand::execute(Transaction& txn) -> Result {
+  auto& db{ txn.getDatabase() };
+  auto numRows{ m_Direction == Direction::FromFile
+                     ? db.importCsv(txn, m_TableName, m_Path)
+                     : db.exportCsv(txn, m_TableName, m_Path) };
+  return Result{ {}, {}, numRows };
+}
+
+} // namespace adun::ast
@@ -4,13 +4,19 @@
 
 namespace adun::ast {
 
-auto CreateCommand::execute(Database& db) -> Result {
+auto CreateCommand::execute(Transaction& txn) -> Result {
+  auto& db{ txn.getDatabase() };
+  std::unique_lock catalogLock{ db.m_CatalogMutex };
   if (db.m_Tables.contains(m_TableName)) {
     throw CommandException{ fmt::format("Table '{}' already exists",
                                         m_TableName) };
   }
-  db.m_Tables.insert(
-      std::make_pair(m_TableName, Table{ m_TableName, m_Scheme }));
+  auto [it, _]{ db.m_Tables.insert(
+      std::make_pair(m_TableName,
+                     Table{ m_TableName, m_Scheme, &db.m_Memory })) };
+  // others write the table only after its creation is committed, which
+  // keeps their commit records behind this one
+  txn.write(it->second);
   return Result{};
 }
 
@@ -5,14 +5,13 @@
 
 namespace adun::ast {
 
-auto DeleteCommand::execute(Database& db) -> Result {
-  if (!db.m_Tables.contains(m_TableName)) {
-    throw CommandException{ fmt::format("Table '{}' does not exist",
-                                        m_TableName) };
-  }
-
-  Table& table{ db.m_Tables.at(m_TableName) };
-  Selector filter{ [this, &table](auto row) {
+auto DeleteCommand::execute(Transaction& txn) -> Result {
+  auto view{ [&] {
+    auto stage{ txn.profileStage(LockStage) };
+    return txn.write(m_TableName);
+  }() };
+  auto& table{ view.table };
+  Selector filter{ [this, &table](const Row& row) {
     auto evalCond{ m_Condition->evaluate(row, table.getColumnMap()) };
     if (evalCond.getType() != ValueType::Boolean) {
       throw CommandException{ fmt::format(
@@ -22,8 +21,20 @@ auto DeleteCommand::execute(Database& db) -> Result {
     return evalCond.template get<bool>();
   } };
 
-  auto affectedRows{ table.deleteRows(filter) };
-  return Result{ {}, {}, affectedRows };
+  auto scannedRows{ view.write.getSnapshot().size };
+  auto stage{ txn.profileStage(WriteStage) };
+  auto affectedRows{ table.deleteRows(stage.countRows(std::move(filter)),
+                                      view.write) };
+  Result result{ {}, {}, affectedRows };
+  result.setNumScannedRows(scannedRows);
+  return result;
+}
+
+void DeleteCommand::explain(Transaction& txn, QueryPlan& plan) {
+  txn.read(m_TableName);
+  plan.addStage(fmt::format("Lock {}", m_TableName));
+  plan.addStage(fmt::format("Seq Scan and Delete on {}", m_TableName),
+                { fmt::format("Filter: {}", m_Condition->toString()) });
 }
 
 } // namespace adun::ast
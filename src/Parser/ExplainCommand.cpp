@@ -0,0 +1,62 @@
+#include "adun/Parser/ExplainCommand.hpp"
+#include "adun/Database.hpp"
+#include "adun/QueryPlan.hpp"
+#include "adun/Row.hpp"
+#include "adun/Transaction.hpp"
+#include <chrono>
+#include <fmt/format.h>
+
+namespace adun::ast {
+
+namespace {
+
+auto makePlanResult(const std::vector<std::string>& lines) -> Result {
+  // rows are owned by the result like a table snapshot would be
+  auto rows{ makeRef<std::vector<Row>>() };
+  rows->reserve(lines.size());
+  std::vector<const Row*> rowPtrs;
+  for (const auto& line : lines) {
+    rowPtrs.push_back(&rows->emplace_back(std::vector<Value>{ line }));
+  }
+  return Result{ std::move(rowPtrs), { { "plan", 0 } }, lines.size(),
+                 std::move(rows) };
+}
+
+} // namespace
+
+auto ExplainCommand::execute(Transaction& txn) -> Result {
+  QueryPlan plan;
+  m_Command->explain(txn, plan);
+  if (!m_Analyze) {
+    return makePlanResult(plan.format(false));
+  }
+
+  auto start{ std::chrono::steady_clock::now() };
+  txn.setProfile(&plan);
+  Result result;
+  try {
+    result = m_Command->execute(txn);
+  } catch (...) {
+    txn.setProfile(nullptr);
+    throw;
+  }
+  txn.setProfile(nullptr);
+  std::chrono::duration<double, std::milli> time{
+    std::chrono::steady_clock::now() - start
+  };
+
+  auto lines{ plan.format(true) };
+  lines.push_back(fmt::format("Rows: {}", result.getNumAffectedRows()));
+  lines.push_back(fmt::format("Execution Time: {:.3f} ms", time.count()));
+  const auto& counters{ PerfCounters::forThisThread() };
+  if (txn.getDatabase().getHardwareCounters() &&
+      !counters.getError().empty()) {
+    lines.push_back(fmt::format("Hardware Counters Unavailable: {}",
+                                counters.getError()));
+  }
+  auto planResult{ makePlanResult(lines) };
+  planResult.setNumScannedRows(result.getNumScannedRows());
+  return planResult;
+}
+
+} // namespace adun::ast
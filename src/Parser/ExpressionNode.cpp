@@ -1,5 +1,7 @@
 #include "adun/Parser/ExpressionNode.hpp"
+#include "adun/Parser/ValueExpr.hpp"
 #include "adun/Value.hpp"
+#include <fmt/format.h>
 
 namespace adun::ast {
 
@@ -24,4 +26,24 @@ void ExpressionNode::setType(ValueType type) {
   m_Type = type;
 }
 
-} // namespace adun
+auto ValueExpr::toString() const -> std::string {
+  switch (m_Value.getType()) {
+  case ValueType::Integer:
+    return std::to_string(m_Value.get<int32_t>());
+  case ValueType::Boolean:
+    return m_Value.get<bool>() ? "true" : "false";
+  case ValueType::String:
+    return fmt::format("\"{}\"", m_Value.get<std::string>());
+  case ValueType::Binary: {
+    std::string hex{ "0x" };
+    for (auto byte : m_Value.get<ByteArray>()) {
+      hex += fmt::format("{:02x}", byte);
+    }
+    return hex;
+  }
+  default:
+    return "null";
+  }
+}
+
+} // namespace adun::ast
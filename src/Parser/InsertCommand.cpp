@@ -5,13 +5,54 @@
 
 namespace adun::ast {
 
-auto InsertCommand::execute(Database& db) -> Result {
-  if (!db.m_Tables.contains(m_TableName)) {
-    throw CommandException{ fmt::format("Table '{}' does not exist",
-                                        m_TableName) };
+auto InsertCommand::execute(Transaction& txn) -> Result {
+  // rows are checked before taking the table, writers only serialize on
+  // autoincrement and UNIQUE
+  Table::PreparedRows prepared;
+  {
+    auto stage{ txn.profileStage(PrepareStage) };
+    prepared = txn.read(m_TableName).table.prepareRows(m_Rows);
   }
-  db.m_Tables.at(m_TableName).addRow(m_Values);
-  return Result{ {}, {}, 1 };
+  // staged rows count until they are moved into the table, which
+  // charges them again
+  auto stagedSize{ prepared.getMemoryUsage() };
+  txn.reserveMemory(stagedSize);
+  auto view{ [&] {
+    auto stage{ txn.profileStage(LockStage) };
+    try {
+      return txn.write(m_TableName);
+    } catch (...) {
+      txn.releaseMemory(stagedSize);
+      throw;
+    }
+  }() };
+  txn.releaseMemory(stagedSize);
+
+  auto stage{ txn.profileStage(InsertStage) };
+  view.table.insertRows(std::move(prepared), view.write);
+  stage.addVersions(m_Rows.size());
+  stage.addConstraintChecks(m_Rows.size() *
+                            view.table.getNumUniqueColumns());
+  return Result{ {}, {}, m_Rows.size() };
+}
+
+void InsertCommand::explain(Transaction& txn, QueryPlan& plan) {
+  const auto& table{ txn.read(m_TableName).table };
+  plan.addStage("Prepare Rows",
+                { fmt::format("Rows: {}", m_Rows.size()) });
+  plan.addStage(fmt::format("Lock {}", m_TableName));
+
+  std::vector<std::string> details;
+  for (const auto& [name, column] : table.getScheme()) {
+    if (column.modifiers & Column::Modifier::AutoIncrement) {
+      details.push_back(fmt::format("Autoincrement: {}", name));
+    }
+    if (column.modifiers & Column::Modifier::Unique) {
+      details.push_back(fmt::format("Unique Check: index on {}", name));
+    }
+  }
+  plan.addStage(fmt::format("Insert on {}", m_TableName),
+                std::move(details));
 }
 
 } // namespace adun::ast
@@ -2,68 +2,257 @@
 #include "adun/Assert.hpp"
 #include "adun/Parser/Token.hpp"
 #include "adun/Parser/Utils.hpp"
+#include "adun/Tracer.hpp"
 #include <array>
-#include <cctype>
+#include <bit>
 #include <cstdint>
-#include <cul/cul.hpp>
 #include <fmt/color.h>
 #include <fmt/format.h>
-#include <iterator>
-#include <sstream>
 #include <string_view>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                              \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ADUN_LEXER_SSE2
+#endif
 
 namespace adun {
 
+namespace detail {
+
 // clang-format off
 #undef TOK
 #undef KEYWORD
-#define KEYWORD(t) .Case(#t, TokenKind::KW_ ## t)
-static constexpr cul::BiMap s_IdentifierMapping{
-  [](auto selector) {
-    return selector 
+#define KEYWORD(t) std::pair{ std::string_view{ #t }, TokenKind::KW_ ## t },
+static constexpr std::array s_Keywords{
 #include "adun/Parser/Tokens.def"
-      ;
-  }
 };
 #undef KEYWORD
 #undef PPTOK
-// clang-format on
 
-// clang-format off
 #undef TOK
 #undef PUNCT
-#define PUNCT(t, s) .Case(s, TokenKind::t)
-static constexpr cul::BiMap s_PunctuatorMapping{
-  [](auto selector) {
-    return selector 
-#include "adun/Parser/Tokens.def" 
-      ;
-  }
+#define PUNCT(t, s) std::pair{ std::string_view{ s }, TokenKind::t },
+static constexpr std::array s_Punctuators{
+#include "adun/Parser/Tokens.def"
 };
+#undef PUNCT
 // clang-format on
 
-#undef PUNCT
-#define PUNCT(t, s) t,
-namespace detail {
-enum class CountPunctuators {
-#include "adun/Parser/Tokens.def" // LParen, RParen, Equals, ...
-  value
+using KeywordEntry = std::pair<std::string_view, TokenKind>;
+
+constexpr auto toLowerAscii(char c) -> char {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+/// Case-insensitive FNV-1a, lowercasing only touches letters so
+/// identifier characters never collide artificially
+constexpr auto hashKeyword(std::string_view str,
+                           uint32_t seed) -> uint32_t {
+  uint32_t hash{ 2166136261U ^ seed };
+  for (auto c : str) {
+    hash ^= static_cast<uint8_t>(toLowerAscii(c));
+    hash *= 16777619U;
+  }
+  return hash ^ (hash >> 15);
+}
+
+constexpr size_t s_KeywordTableSize{ std::bit_ceil(s_Keywords.size() *
+                                                   4) };
+
+constexpr auto keywordSlot(std::string_view str,
+                           uint32_t seed) -> size_t {
+  return hashKeyword(str, seed) & (s_KeywordTableSize - 1);
+}
+
+constexpr auto isCollisionFree(uint32_t seed) -> bool {
+  std::array<bool, s_KeywordTableSize> taken{};
+  for (const auto& [keyword, _] : s_Keywords) {
+    auto slot{ keywordSlot(keyword, seed) };
+    if (taken[slot]) {
+      return false;
+    }
+    taken[slot] = true;
+  }
+  return true;
+}
+
+constexpr auto findPerfectSeed() -> uint32_t {
+  for (uint32_t seed{ 0 }; seed < 100000; seed++) {
+    if (isCollisionFree(seed)) {
+      return seed;
+    }
+  }
+  return UINT32_MAX;
+}
+
+constexpr uint32_t s_KeywordSeed{ findPerfectSeed() };
+static_assert(s_KeywordSeed != UINT32_MAX,
+              "No perfect hash seed for keywords, grow the table");
+
+constexpr size_t s_MaxKeywordLength{ [] {
+  size_t result{ 0 };
+  for (const auto& [keyword, _] : s_Keywords) {
+    result = std::max(result, keyword.size());
+  }
+  return result;
+}() };
+
+/// Perfect hash table, empty slots have empty keyword
+static constexpr auto s_KeywordTable{ [] {
+  std::array<KeywordEntry, s_KeywordTableSize> table{};
+  for (const auto& entry : s_Keywords) {
+    table[keywordSlot(entry.first, s_KeywordSeed)] = entry;
+  }
+  return table;
+}() };
+
+static auto findKeyword(std::string_view ident) -> TokenKind {
+  if (ident.size() > s_MaxKeywordLength) {
+    return TokenKind::Identifier;
+  }
+  const auto& [keyword, kind]{
+    s_KeywordTable[keywordSlot(ident, s_KeywordSeed)]
+  };
+  if (keyword.size() != ident.size()) {
+    return TokenKind::Identifier;
+  }
+  for (size_t i{ 0 }; i < ident.size(); i++) {
+    // keywords are stored in lowercase
+    if (toLowerAscii(ident[i]) != keyword[i]) {
+      return TokenKind::Identifier;
+    }
+  }
+  return kind;
+}
+
+/// Punctuators starting with each character, longest first so "<="
+/// wins over "<"
+static constexpr size_t s_MaxPunctuatorsPerChar{ 2 };
+using PunctuatorCandidates =
+    std::array<KeywordEntry, s_MaxPunctuatorsPerChar>;
+static constexpr auto s_PunctuatorTable{ [] {
+  std::array<PunctuatorCandidates, 256> table{};
+  auto sorted{ sortConstexpr(
+      s_Punctuators, [](const KeywordEntry& a, const KeywordEntry& b) {
+        return a.first.length() > b.first.length();
+      }) };
+  for (const auto& entry : sorted) {
+    auto& candidates{ table[static_cast<uint8_t>(entry.first.front())] };
+    size_t i{ 0 };
+    while (!candidates[i].first.empty()) {
+      i++; // overflow fails constant evaluation
+    }
+    candidates[i] = entry;
+  }
+  return table;
+}() };
+
+enum CharClass : uint8_t {
+  Space      = 1U << 0U,
+  IdentStart = 1U << 1U,
+  Ident      = 1U << 2U,
+  Digit      = 1U << 3U,
+  HexDigit   = 1U << 4U,
 };
-constexpr size_t CountPunctuators_v =
-    static_cast<size_t>(CountPunctuators::value);
-} // namespace detail
 
-#undef PUNCT
-#define PUNCT(t, s) s,
-static constexpr std::array<std::string_view, detail::CountPunctuators_v>
-    s_PunctuatorStrings = sortConstexpr(
-        std::array<std::string_view, detail::CountPunctuators_v>{
-#include "adun/Parser/Tokens.def" // "<=", "<", "&&", ...
-        },
-        [](const auto& a, const auto& b) {
-          return a.length() > b.length();
-        });
-#undef PUNCT
+static constexpr auto s_CharClasses{ [] {
+  std::array<uint8_t, 256> classes{};
+  classes[' ']  = Space;
+  classes['\n'] = Space;
+  for (int c{ 'a' }; c <= 'z'; c++) {
+    classes[c]            = IdentStart | Ident;
+    classes[c - 'a' + 'A'] = IdentStart | Ident;
+  }
+  for (int c{ 'a' }; c <= 'f'; c++) {
+    classes[c] |= HexDigit;
+    classes[c - 'a' + 'A'] |= HexDigit;
+  }
+  classes['_'] = IdentStart | Ident;
+  for (int c{ '0' }; c <= '9'; c++) {
+    classes[c] = Ident | Digit | HexDigit;
+  }
+  return classes;
+}() };
+
+inline auto hasClass(char c, uint8_t charClass) -> bool {
+  return (s_CharClasses[static_cast<uint8_t>(c)] & charClass) != 0;
+}
+
+#ifdef ADUN_LEXER_SSE2
+static constexpr ptrdiff_t s_BlockSize{ 16 };
+
+/// Mask of bytes within [lo, hi]
+inline auto inRange(__m128i block, char lo, char hi) -> __m128i {
+  auto shifted{ _mm_sub_epi8(block, _mm_set1_epi8(lo)) };
+  auto over{ _mm_subs_epu8(shifted, _mm_set1_epi8(
+                                        static_cast<char>(hi - lo))) };
+  return _mm_cmpeq_epi8(over, _mm_setzero_si128());
+}
+
+inline auto classMask(__m128i block, uint8_t charClass) -> __m128i {
+  auto mask{ _mm_setzero_si128() };
+  if (charClass & Space) {
+    mask = _mm_or_si128(mask,
+                        _mm_cmpeq_epi8(block, _mm_set1_epi8(' ')));
+    mask = _mm_or_si128(mask,
+                        _mm_cmpeq_epi8(block, _mm_set1_epi8('\n')));
+  }
+  if (charClass & Ident) {
+    auto lower{ _mm_or_si128(block, _mm_set1_epi8(0x20)) };
+    mask = _mm_or_si128(mask, inRange(lower, 'a', 'z'));
+    mask = _mm_or_si128(mask,
+                        _mm_cmpeq_epi8(block, _mm_set1_epi8('_')));
+  }
+  if (charClass & (Ident | Digit)) {
+    mask = _mm_or_si128(mask, inRange(block, '0', '9'));
+  }
+  return mask;
+}
+#endif
+
+/// @returns first position in [pos, end) not of charClass
+template <uint8_t charClass>
+inline auto skipClass(SourceIt pos, SourceIt end) -> SourceIt {
+#ifdef ADUN_LEXER_SSE2
+  while (end - pos >= s_BlockSize) {
+    auto block{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos)) };
+    auto stops{ ~_mm_movemask_epi8(classMask(block, charClass)) &
+                0xFFFF };
+    if (stops != 0) {
+      return pos + std::countr_zero(static_cast<uint32_t>(stops));
+    }
+    pos += s_BlockSize;
+  }
+#endif
+  while (pos != end && hasClass(*pos, charClass)) {
+    ++pos;
+  }
+  return pos;
+}
+
+/// @returns first quote or backslash in [pos, end)
+inline auto findStringStop(SourceIt pos, SourceIt end) -> SourceIt {
+#ifdef ADUN_LEXER_SSE2
+  while (end - pos >= s_BlockSize) {
+    auto block{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos)) };
+    auto stops{ _mm_movemask_epi8(_mm_or_si128(
+        _mm_cmpeq_epi8(block, _mm_set1_epi8('"')),
+        _mm_cmpeq_epi8(block, _mm_set1_epi8('\\')))) };
+    if (stops != 0) {
+      return pos + std::countr_zero(static_cast<uint32_t>(stops));
+    }
+    pos += s_BlockSize;
+  }
+#endif
+  while (pos != end && *pos != '"' && *pos != '\\') {
+    ++pos;
+  }
+  return pos;
+}
+
+} // namespace detail
 
 template <typename... Args>
 static void emitError(const SourceIt& around, size_t length,
@@ -72,36 +261,25 @@ static void emitError(const SourceIt& around, size_t length,
   std::string str{};
   str += fmt::format(
       fmt::fg(fmt::color::red), "Error around: '{}'\n",
-      std::string_view{
-          around,
-          around + static_cast<SourceIt::difference_type>(length) });
+      std::string_view{ around, around + length });
   str += fmt::format(msg, std::forward<Args>(args)...);
   throw LexerFatalError{ str };
 }
 
-static auto decodeEscapedChar(const SourceIt& pos) -> char {
-  switch (*pos) {
+static auto isValidEscape(char c) -> bool {
+  switch (c) {
   case 'a':
-    return '\a';
   case 'b':
-    return '\b';
   case 'f':
-    return '\f';
   case 'n':
-    return '\n';
   case 'r':
-    return '\r';
   case 't':
-    return '\t';
   case 'v':
-    return '\v';
   case '0':
-    return '\0';
   case '\\':
-    return '\\';
+    return true;
   default:
-    emitError(pos, 1, "Invalid escape sequence, ignoring '\\'");
-    return *pos;
+    return false;
   }
 }
 
@@ -113,82 +291,36 @@ auto Lexer::lexIdentifier(SourceIt& pos) -> bool {
     return false;
   }
 
-  Token newTok{ TokenKind::Unknown, start, ident.size() };
-  auto kind{ s_IdentifierMapping.FindByFirstIgnoreCase(
-      newTok.getStringView()) };
-  newTok.setKind(
-      kind.value_or(TokenKind::Identifier)); // either keyword or name
-  m_Tokens->push_back(std::move(newTok));
+  // either keyword or name
+  m_Tokens->emplace_back(detail::findKeyword(ident), start, ident.size());
   return true;
 }
 
-static auto byteArrayFromString(std::string_view str) -> ByteArray {
-  ByteArray result;
-  for (int32_t i{ static_cast<int32_t>(str.size() - 1) }; i >= 2;
-       i -= 2) {
-    uint8_t byte{};
-    if (str[i] >= '0' && str[i] <= '9') {
-      byte += str[i] - '0';
-    } else if (tolower(str[i]) >= 'a' && tolower(str[i]) <= 'f') {
-      byte += tolower(str[i]) - 'a' + 10;
-    }
-
-    if (tolower(str[i - 1]) == 'x') {
-      byte += 0;
-    } else if (str[i - 1] >= '0' && str[i - 1] <= '9') {
-      byte += (str[i - 1] - '0') * 16;
-    } else if (tolower(str[i - 1]) >= 'a' && tolower(str[i - 1]) <= 'f') {
-      byte += (tolower(str[i - 1]) - 'a' + 10) * 16;
-    }
-
-    result.push_back(byte);
-  }
-
-  std::reverse(result.begin(), result.end());
-  return result;
-}
-
 auto Lexer::lexNumericLiteral(SourceIt& pos) -> bool {
   auto start{ pos };
-  if (!std::isdigit(*pos)) {
+  if (!detail::hasClass(*pos, detail::Digit)) {
     return false;
   }
 
-  size_t length{ 1 };
-  auto firstDigit{ *pos };
   ++pos;
-  if (firstDigit == '0' && (tolower(*pos) == 'x')) {
+  if (*start == '0' && !atEnd(pos) && detail::toLowerAscii(*pos) == 'x') {
     ++pos;
-    ++length;
-    if (!std::isdigit(*pos) &&
-        (tolower(*pos) < 'a' || tolower(*pos) > 'f')) {
-      return false;
+    if (atEnd(pos) || !detail::hasClass(*pos, detail::HexDigit)) {
+      // plain zero followed by an identifier
+      pos = start + 1;
+      m_Tokens->emplace_back(TokenKind::NumericLiteral, start, 1);
+      return true;
     }
-    while (!nearEnd(pos) &&
-           (std::isdigit(*pos) ||
-            (tolower(*pos) >= 'a' && tolower(*pos) <= 'f'))) {
+    while (!atEnd(pos) && detail::hasClass(*pos, detail::HexDigit)) {
       ++pos;
-      ++length;
     }
-    m_Tokens->emplace_back(TokenKind::HexLiteral, start, length);
-    auto literal{ byteArrayFromString(std::string_view{
-        start,
-        start + static_cast<SourceIt::difference_type>(length) }) };
-    m_Tokens->back().setLiteralValue(literal);
+    m_Tokens->emplace_back(TokenKind::HexLiteral, start, pos - start);
     return true;
   }
 
-  while (!nearEnd(pos) && std::isdigit(*pos)) {
-    ++pos;
-    ++length;
-  }
+  pos = detail::skipClass<detail::Digit>(pos, m_QueryEnd);
 
-  m_Tokens->emplace_back(TokenKind::NumericLiteral, start, length);
-  std::stringstream ss;
-  ss << std::string{ start, start + length };
-  int32_t intVal{};
-  ss >> intVal;
-  m_Tokens->back().setLiteralValue(intVal);
+  m_Tokens->emplace_back(TokenKind::NumericLiteral, start, pos - start);
   return true;
 }
 
@@ -198,40 +330,37 @@ auto Lexer::lexStringLiteral(SourceIt& pos) -> bool {
     return false;
   }
 
+  // only validated here, unescaping is deferred to Token
   ++pos;
-  std::string value{};
-
-  while (*pos != '"' && !nearEnd(pos)) {
-    if (*pos == '\\') {
-      ++pos; // consume backslash
-      value += decodeEscapedChar(pos);
-      ++pos;
-      continue;
+  while (true) {
+    pos = detail::findStringStop(pos, m_QueryEnd);
+    if (atEnd(pos) || *pos == '"') {
+      break;
+    }
+    ++pos; // consume backslash
+    if (atEnd(pos)) {
+      break;
+    }
+    if (!isValidEscape(*pos)) {
+      emitError(pos, 1, "Invalid escape sequence, ignoring '\\'");
     }
-    value += *pos;
     ++pos;
   }
-  if (*pos == '"') {
-    ++pos;
-  } else {
-    emitError(start, value.length(), "Unclosed string literal");
+  if (atEnd(pos)) {
+    emitError(start, pos - start, "Unclosed string literal");
     return false;
   }
-  m_Tokens->emplace_back(TokenKind::StringLiteral, start,
-                         value.length() + 2); // plus quotes
-  m_Tokens->back().setLiteralValue(value);
+  ++pos; // closing quote
+
+  m_Tokens->emplace_back(TokenKind::StringLiteral, start, pos - start);
   return true;
 }
 
 auto Lexer::lexPunctuator(SourceIt& pos) -> bool {
-  // s_PunctuatorStrings is sorted by length descending, so we'll match
-  // long punctuators first
-  for (const auto& punct : s_PunctuatorStrings) {
-    if (startsWith(pos, punct)) {
-      auto pucntKindOpt{ s_PunctuatorMapping.FindByFirst(punct) };
-      adun_assert(pucntKindOpt.has_value(),
-                  "Punctuator mapping and list somehow doesn't match");
-      m_Tokens->emplace_back(pucntKindOpt.value(), pos, punct.length());
+  for (const auto& [punct, kind] :
+       detail::s_PunctuatorTable[static_cast<uint8_t>(*pos)]) {
+    if (!punct.empty() && startsWith(pos, punct)) {
+      m_Tokens->emplace_back(kind, pos, punct.length());
       pos += punct.length();
       return true;
     }
@@ -244,17 +373,44 @@ Lexer::Lexer()
     : m_Tokens{ makeRef<TokenList>() } {
 }
 
-void Lexer::lex(const std::string& query) {
-  m_QueryLength = query.size();
-  SourceIt pos{ query.cbegin() };
-  m_QueryStart = pos;
+void Lexer::lex(std::string_view query) {
+  TraceSpan span{ "lex", "parser" };
+  m_QueryEnd = query.data() + query.size();
+  // rough guess to avoid most of reallocations on long scripts
+  m_Tokens->reserve(m_Tokens->size() + query.size() / 4 + 1);
+
+  auto pos{ lexUntil(query.data(), false) };
+  m_Tokens->emplace_back(TokenKind::Eof, pos, 0);
+}
+
+void Lexer::startScript(std::string_view script) {
+  m_Tokens->clear();
+  m_ScriptPos = script.data();
+  m_QueryEnd  = script.data() + script.size();
+}
 
-  while (pos != query.cend()) {
+auto Lexer::lexNextStatement() -> bool {
+  TraceSpan span{ "lex", "parser" };
+  // keeps capacity, so a script is lexed without reallocating
+  do {
+    m_Tokens->clear();
+    m_ScriptPos = lexUntil(m_ScriptPos, true);
+    // skip empty statements
+  } while (m_Tokens->size() == 1 &&
+           m_Tokens->front().is(TokenKind::Semicolon));
+  if (m_Tokens->empty()) {
+    return false;
+  }
+  m_Tokens->emplace_back(TokenKind::Eof, m_ScriptPos, 0);
+  return true;
+}
 
+auto Lexer::lexUntil(SourceIt pos, bool stopAfterSemicolon) -> SourceIt {
+  while (true) {
     // Newlines and spaces
-    if (*pos == '\n' || *pos == ' ') {
-      ++pos;
-      continue;
+    skipSpacesSince(pos);
+    if (atEnd(pos)) {
+      break;
     }
 
     // Numeric literals
@@ -274,56 +430,57 @@ void Lexer::lex(const std::string& query) {
 
     // Punctuators
     if (lexPunctuator(pos)) {
+      if (stopAfterSemicolon &&
+          m_Tokens->back().is(TokenKind::Semicolon)) {
+        break;
+      }
       continue;
     }
 
     emitError(pos, 1, "Unknown token");
   }
 
-  m_Tokens->emplace_back(TokenKind::Eof, pos, 0);
+  return pos;
 }
 
 auto Lexer::startsWith(const SourceIt& pos,
                        std::string_view prefix) -> bool {
-  if (std::distance(m_QueryStart, pos) + prefix.length() >
-      m_QueryLength) {
+  if (static_cast<size_t>(m_QueryEnd - pos) < prefix.length()) {
     return false;
   }
   return std::equal(prefix.begin(), prefix.end(), pos);
 }
 
 void Lexer::skipSpacesSince(SourceIt& pos) {
-  while (*pos == ' ') {
-    ++pos;
-    if (static_cast<size_t>(std::distance(m_QueryStart, pos)) >=
-        m_QueryLength) {
-      return;
-    }
-  }
+  pos = detail::skipClass<detail::Space>(pos, m_QueryEnd);
 }
 
 auto Lexer::consumeIdent(SourceIt& pos) -> std::string_view {
-  size_t length{ 0 };
   auto start{ pos };
 
-  if (!std::isalpha(*pos) && *pos != '_') {
+  if (!detail::hasClass(*pos, detail::IdentStart)) {
     return {};
   }
 
-  while (std::isalnum(*pos) || *pos == '_') {
-    ++pos;
-    ++length;
-    if (nearEnd(pos)) {
-      break;
-    }
-  }
-  return std::string_view{
-    start, start + static_cast<SourceIt::difference_type>(length)
-  };
+  pos = detail::skipClass<detail::Ident>(pos + 1, m_QueryEnd);
+  return std::string_view{ start, pos };
 }
 
-auto Lexer::nearEnd(const SourceIt& pos) const -> bool {
-  return static_cast<size_t>(std::distance(m_QueryStart, pos) + 1) >=
-         m_QueryLength;
+auto Lexer::atEnd(const SourceIt& pos) const -> bool {
+  return pos == m_QueryEnd;
 }
+
+auto getSourceText(const TokenList& tokens) -> std::string_view {
+  if (tokens.empty() || tokens.front().is(TokenKind::Eof)) {
+    return {};
+  }
+  auto last{ tokens.end() - 1 };
+  if (last->is(TokenKind::Eof)) {
+    last--;
+  }
+  const auto* begin{ tokens.front().getStringView().data() };
+  auto lastText{ last->getStringView() };
+  return { begin, lastText.data() + lastText.size() };
+}
+
 } // namespace adun
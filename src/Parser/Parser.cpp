@@ -3,15 +3,18 @@
 #include "adun/Column.hpp"
 #include "adun/Parser/ASTNode.hpp"
 #include "adun/Parser/BinOpExpr.hpp"
+#include "adun/Parser/CopyCommand.hpp"
 #include "adun/Parser/CreateCommand.hpp"
 #include "adun/Parser/DeleteCommand.hpp"
 #include "adun/Parser/ExpressionNode.hpp"
 #include "adun/Parser/Token.hpp"
+#include "adun/Parser/TransactionCommand.hpp"
 #include "adun/Parser/UnaryOpExpr.hpp"
 #include "adun/Parser/UpdateCommand.hpp"
 #include "adun/Parser/Utils.hpp"
 #include "adun/Parser/ValueExpr.hpp"
 #include "adun/Parser/VariableExpr.hpp"
+#include "adun/Tracer.hpp"
 #include "adun/Value.hpp"
 #include <fmt/base.h>
 #include <fmt/color.h>
@@ -47,7 +50,8 @@ static void emitError(const Token& around,
   throw ParserException{ str };
 }
 
-auto Parser::buildAST() -> Ref<ast::Command> {
+auto Parser::buildAST() -> ast::Command* {
+  TraceSpan span{ "parse", "parser" };
   switch (curTok().getKind()) {
   case TokenKind::KW_create:
     m_ASTRoot = parseCreateCommand();
@@ -64,13 +68,24 @@ auto Parser::buildAST() -> Ref<ast::Command> {
   case TokenKind::KW_delete:
     m_ASTRoot = parseDeleteCommand();
     break;
+  case TokenKind::KW_copy:
+    m_ASTRoot = parseCopyCommand();
+    break;
+  case TokenKind::KW_begin:
+  case TokenKind::KW_commit:
+  case TokenKind::KW_rollback:
+    m_ASTRoot = parseTransactionCommand();
+    break;
+  case TokenKind::KW_explain:
+    m_ASTRoot = parseExplainCommand();
+    break;
   default:
     emitError(curTok(), "Expected command name");
   }
   return m_ASTRoot;
 }
 
-auto Parser::parseCreateCommand() -> Unique<ast::CreateCommand> {
+auto Parser::parseCreateCommand() -> ast::CreateCommand* {
   adun_assert(curTok().is(TokenKind::KW_create), "Expected 'CREATE'");
   consumeToken();
   expectConsume(TokenKind::KW_table);
@@ -89,35 +104,44 @@ auto Parser::parseCreateCommand() -> Unique<ast::CreateCommand> {
 
   // RParen already consumed by parseScheme
   expectConsumeEnd();
-  return makeUnique<ast::CreateCommand>(std::move(tableName),
-                                        std::move(scheme));
+  return m_Arena.create<ast::CreateCommand>(std::move(tableName),
+                                            std::move(scheme));
 }
 
-auto Parser::parseInsertCommand() -> Unique<ast::InsertCommand> {
+auto Parser::parseInsertCommand() -> ast::InsertCommand* {
   adun_assert(curTok().is(TokenKind::KW_insert), "Expected 'INSERT'");
   consumeToken();
-  expectConsume(TokenKind::LParen);
 
-  std::vector<std::pair<std::string, Value>> assignments;
-  while (curTok().isNot(TokenKind::RParen)) {
-    expect(TokenKind::Identifier);
-    std::string columnName{ curTok().getStringView() };
-    consumeToken();
+  std::vector<Table::Assignments> rows;
+  do {
+    if (!rows.empty()) {
+      consumeToken(); // ',' between tuples
+    }
+    expectConsume(TokenKind::LParen);
+
+    auto& assignments{ rows.emplace_back() };
+    // tuples of a batch usually have the same width
+    assignments.reserve(rows.size() > 1 ? rows.front().size() : 0);
+    while (curTok().isNot(TokenKind::RParen)) {
+      expect(TokenKind::Identifier);
+      std::string columnName{ curTok().getStringView() };
+      consumeToken();
 
-    expectConsume(TokenKind::Equals);
+      expectConsume(TokenKind::Equals);
 
-    auto value{ parseValueExpr()->getValue() };
+      auto value{ parseLiteral() };
 
-    if (curTok().is(TokenKind::Comma)) {
-      consumeToken();
-    } else if (curTok().is(TokenKind::RParen)) { // will be consumed later
-    } else {
-      emitError(curTok(), "Expected ','");
-    }
+      if (curTok().is(TokenKind::Comma)) {
+        consumeToken();
+      } else if (curTok().is(TokenKind::RParen)) { // will be consumed
+      } else {
+        emitError(curTok(), "Expected ','");
+      }
 
-    assignments.emplace_back(columnName, value);
-  }
-  consumeToken();
+      assignments.emplace_back(std::move(columnName), std::move(value));
+    }
+    consumeToken();
+  } while (curTok().is(TokenKind::Comma));
 
   expectConsume(TokenKind::KW_into);
 
@@ -127,11 +151,11 @@ auto Parser::parseInsertCommand() -> Unique<ast::InsertCommand> {
 
   expectConsumeEnd();
 
-  return makeUnique<ast::InsertCommand>(std::move(tableName),
-                                        std::move(assignments));
+  return m_Arena.create<ast::InsertCommand>(std::move(tableName),
+                                            std::move(rows));
 }
 
-auto Parser::parseSelectCommand() -> Unique<ast::SelectCommand> {
+auto Parser::parseSelectCommand() -> ast::SelectCommand* {
   adun_assert(curTok().is(TokenKind::KW_select), "Expected 'SELECT'");
   consumeToken();
 
@@ -143,20 +167,20 @@ auto Parser::parseSelectCommand() -> Unique<ast::SelectCommand> {
   std::string tableName{ curTok().getStringView() };
   consumeToken();
 
-  Unique<ast::ExpressionNode> cond;
+  ast::ExpressionNode* cond{ nullptr };
   if (curTok().isNot(TokenKind::KW_where)) {
-    cond = makeUnique<ast::ValueExpr>(true);
+    cond = m_Arena.create<ast::ValueExpr>(true);
   } else {
     consumeToken();
     cond = parseExpression();
   }
   expectConsumeEnd();
 
-  return makeUnique<ast::SelectCommand>(
-      std::move(columns), std::move(tableName), std::move(cond));
+  return m_Arena.create<ast::SelectCommand>(
+      std::move(columns), std::move(tableName), cond);
 }
 
-auto Parser::parseUpdateCommand() -> Unique<ast::UpdateCommand> {
+auto Parser::parseUpdateCommand() -> ast::UpdateCommand* {
   adun_assert(curTok().is(TokenKind::KW_update), "Expected 'UPDATE'");
   consumeToken();
 
@@ -167,7 +191,7 @@ auto Parser::parseUpdateCommand() -> Unique<ast::UpdateCommand> {
   expectConsume(TokenKind::KW_set);
   expectConsume(TokenKind::LParen);
 
-  std::vector<std::pair<std::string, Ref<ast::ExpressionNode>>>
+  std::vector<std::pair<std::string, ast::ExpressionNode*>>
       assignments;
   while (curTok().isNot(TokenKind::RParen)) {
     expect(TokenKind::Identifier);
@@ -176,7 +200,7 @@ auto Parser::parseUpdateCommand() -> Unique<ast::UpdateCommand> {
 
     expectConsume(TokenKind::Equals);
 
-    Ref<ast::ExpressionNode> expr{ parseExpression() };
+    ast::ExpressionNode* expr{ parseExpression() };
 
     if (curTok().is(TokenKind::Comma)) {
       consumeToken();
@@ -186,20 +210,20 @@ auto Parser::parseUpdateCommand() -> Unique<ast::UpdateCommand> {
       emitError(curTok(), "Expected ','");
     }
 
-    assignments.emplace_back(columnName, std::move(expr));
+    assignments.emplace_back(columnName, expr);
   }
   consumeToken();
 
   expectConsume(TokenKind::KW_where);
 
-  Ref<ast::ExpressionNode> cond{ parseExpression() };
+  ast::ExpressionNode* cond{ parseExpression() };
 
   expectConsumeEnd();
-  return makeUnique<ast::UpdateCommand>(
-      std::move(tableName), std::move(assignments), std::move(cond));
+  return m_Arena.create<ast::UpdateCommand>(
+      std::move(tableName), std::move(assignments), cond);
 }
 
-auto Parser::parseDeleteCommand() -> Unique<ast::DeleteCommand> {
+auto Parser::parseDeleteCommand() -> ast::DeleteCommand* {
   adun_assert(curTok().is(TokenKind::KW_delete), "Expected 'DELETE'");
   consumeToken();
 
@@ -211,45 +235,94 @@ auto Parser::parseDeleteCommand() -> Unique<ast::DeleteCommand> {
 
   expectConsume(TokenKind::KW_where);
 
-  Ref<ast::ExpressionNode> cond{ parseExpression() };
+  ast::ExpressionNode* cond{ parseExpression() };
 
   expectConsumeEnd();
-  return makeUnique<ast::DeleteCommand>(std::move(tableName),
-                                        std::move(cond));
+  return m_Arena.create<ast::DeleteCommand>(std::move(tableName), cond);
 }
 
-auto Parser::parseValueExpr() -> Unique<ast::ValueExpr> {
-  Value value;
-  Unique<ast::ExpressionNode> compoundResult;
+auto Parser::parseCopyCommand() -> ast::CopyCommand* {
+  adun_assert(curTok().is(TokenKind::KW_copy), "Expected 'COPY'");
+  consumeToken();
+
+  expect(TokenKind::Identifier);
+  std::string tableName{ curTok().getStringView() };
+  consumeToken();
+
+  auto direction{ ast::CopyCommand::Direction::FromFile };
+  if (curTok().is(TokenKind::KW_to)) {
+    direction = ast::CopyCommand::Direction::ToFile;
+    consumeToken();
+  } else {
+    expectConsume(TokenKind::KW_from);
+  }
+
+  expect(TokenKind::StringLiteral);
+  auto path{ parseLiteral().get<std::string>() };
+
+  expectConsumeEnd();
+  return m_Arena.create<ast::CopyCommand>(std::move(tableName), direction,
+                                          std::move(path));
+}
+
+auto Parser::parseTransactionCommand() -> ast::TransactionCommand* {
+  auto action{ ast::TransactionCommand::Action::Begin };
+  if (curTok().is(TokenKind::KW_commit)) {
+    action = ast::TransactionCommand::Action::Commit;
+  } else if (curTok().is(TokenKind::KW_rollback)) {
+    action = ast::TransactionCommand::Action::Rollback;
+  }
+  consumeToken();
+
+  expectConsumeEnd();
+  return m_Arena.create<ast::TransactionCommand>(action);
+}
+
+auto Parser::parseExplainCommand() -> ast::ExplainCommand* {
+  adun_assert(curTok().is(TokenKind::KW_explain), "Expected 'EXPLAIN'");
+  consumeToken();
+
+  bool analyze{ curTok().is(TokenKind::KW_analyze) };
+  if (analyze) {
+    consumeToken();
+  }
+
+  ast::Command* command{ nullptr };
   switch (curTok().getKind()) {
-  case TokenKind::NumericLiteral:
-    value = curTok().getLiteralValue<int32_t>();
-    break;
-  case TokenKind::StringLiteral:
-    value = curTok().getLiteralValue<std::string>();
-    break;
-  case TokenKind::KW_true:
-    value = true;
+  case TokenKind::KW_insert:
+    command = parseInsertCommand();
     break;
-  case TokenKind::KW_false:
-    value = false;
+  case TokenKind::KW_select:
+    command = parseSelectCommand();
     break;
-  case TokenKind::HexLiteral:
-    value = curTok().getLiteralValue<ByteArray>();
+  case TokenKind::KW_update:
+    command = parseUpdateCommand();
     break;
-  case TokenKind::KW_null:
-    value = curTok().getLiteralValue();
+  case TokenKind::KW_delete:
+    command = parseDeleteCommand();
     break;
   default:
+    emitError(curTok(), "Expected SELECT, INSERT, UPDATE or DELETE");
+  }
+  return m_Arena.create<ast::ExplainCommand>(command, analyze);
+}
+
+auto Parser::parseLiteral() -> Value {
+  if (!curTok().isLiteral()) {
     emitError(curTok(), "Expected value expression");
-    break;
   }
-  auto token{ curTok() };
+  auto value{ curTok().getLiteralValue() };
   consumeToken();
-  return makeUnique<ast::ValueExpr>(value);
+  m_NumLiterals++;
+  return value;
+}
+
+auto Parser::parseValueExpr() -> ast::ValueExpr* {
+  auto literalIndex{ m_NumLiterals };
+  return m_Arena.create<ast::ValueExpr>(parseLiteral(), literalIndex);
 }
 
-auto Parser::parseParenExpr() -> Unique<ast::ExpressionNode> {
+auto Parser::parseParenExpr() -> ast::ExpressionNode* {
   adun_assert(curTok().is(TokenKind::LParen), "Expected '('");
   consumeToken();
 
@@ -265,19 +338,17 @@ auto Parser::parseParenExpr() -> Unique<ast::ExpressionNode> {
   return result;
 }
 
-auto Parser::parseIdentifierExpr() -> Unique<ast::ExpressionNode> {
+auto Parser::parseIdentifierExpr() -> ast::ExpressionNode* {
   adun_assert(curTok().is(TokenKind::Identifier), "Expected identifier");
-  auto identifierTok{ curTok() };
+  std::string name{ curTok().getStringView() };
 
   consumeToken();
 
-  return makeUnique<ast::VariableExpr>(
-      std::string{ identifierTok.getStringView() });
+  return m_Arena.create<ast::VariableExpr>(std::move(name));
 }
 
-auto Parser::parseCompoundExpression()
-    -> std::unique_ptr<ast::ExpressionNode> {
-  Unique<ast::ExpressionNode> compoundResult;
+auto Parser::parseCompoundExpression() -> ast::ExpressionNode* {
+  ast::ExpressionNode* compoundResult{ nullptr };
   switch (curTok().getKind()) {
   case TokenKind::Identifier:
     return parseIdentifierExpr();
@@ -285,12 +356,12 @@ auto Parser::parseCompoundExpression()
     return parseParenExpr();
   case TokenKind::Minus:
     consumeToken();
-    return makeUnique<ast::UnaryOpExpr>(parseValueExpr(),
-                                        TokenKind::Minus);
+    return m_Arena.create<ast::UnaryOpExpr>(parseValueExpr(),
+                                            TokenKind::Minus);
   case TokenKind::Pipe:
     consumeToken();
-    compoundResult =
-        makeUnique<ast::UnaryOpExpr>(parseExpression(), TokenKind::Pipe);
+    compoundResult = m_Arena.create<ast::UnaryOpExpr>(parseExpression(),
+                                                      TokenKind::Pipe);
     if (curTok().isNot(TokenKind::Pipe)) {
       emitError(curTok(), "Expected closing '|'");
     }
@@ -301,9 +372,9 @@ auto Parser::parseCompoundExpression()
   }
 }
 
-auto Parser::parseExpression() -> std::unique_ptr<ast::ExpressionNode> {
+auto Parser::parseExpression() -> ast::ExpressionNode* {
   auto lhs{ parseCompoundExpression() };
-  return parseBinOpRhs(std::move(lhs));
+  return parseBinOpRhs(lhs);
 }
 
 static auto getTokPrecedence(const Token& tok) -> int32_t {
@@ -313,9 +384,8 @@ static auto getTokPrecedence(const Token& tok) -> int32_t {
   return -1;
 }
 
-auto Parser::parseBinOpRhs(std::unique_ptr<ast::ExpressionNode> lhs,
-                           int32_t prevPrecedence)
-    -> std::unique_ptr<ast::ExpressionNode> {
+auto Parser::parseBinOpRhs(ast::ExpressionNode* lhs,
+                           int32_t prevPrecedence) -> ast::ExpressionNode* {
   while (true) {
     // precedence or -1 if not a binop
     auto tokPrecedence{ getTokPrecedence(curTok()) };
@@ -323,7 +393,7 @@ auto Parser::parseBinOpRhs(std::unique_ptr<ast::ExpressionNode> lhs,
       return lhs;
     }
 
-    auto binOp{ curTok() };
+    auto binOpKind{ curTok().getKind() };
     consumeToken();
     auto rhs{ parseCompoundExpression() };
 
@@ -332,12 +402,11 @@ auto Parser::parseBinOpRhs(std::unique_ptr<ast::ExpressionNode> lhs,
     auto nextPrecedence{ getTokPrecedence(curTok()) };
     // if associates to the right: lhs binOp (rhs lookahead unparsed)
     if (tokPrecedence < nextPrecedence) {
-      rhs = parseBinOpRhs(std::move(rhs), tokPrecedence + 1);
+      rhs = parseBinOpRhs(rhs, tokPrecedence + 1);
     }
 
     // now: (lhs binOp rhs) lookahead unparsed
-    lhs = makeUnique<ast::BinOpExpr>(std::move(lhs), std::move(rhs),
-                                     binOp.getKind());
+    lhs = m_Arena.create<ast::BinOpExpr>(lhs, rhs, binOpKind);
   }
 }
 
@@ -402,7 +471,7 @@ auto Parser::parseScheme() -> Table::Scheme {
         defaultKWTok = curTok();
         consumeToken();
         expectConsume(TokenKind::LParen);
-        columnValue = parseValueExpr()->getValue();
+        columnValue = parseLiteral();
         if (columnValue.isEmpty() || columnValue.isNull()) {
           emitError(defaultKWTok, "Expected non-empty value");
           return {};
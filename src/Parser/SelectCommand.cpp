@@ -3,34 +3,66 @@
 #include "adun/Parser/Command.hpp"
 #include "adun/Value.hpp"
 #include <fmt/format.h>
+#include <fmt/ranges.h>
 
 namespace adun::ast {
 
-auto SelectCommand::execute(Database& db) -> Result {
-  if (!db.m_Tables.contains(m_TableName)) {
-    throw CommandException{ fmt::format("Table '{}' does not exist",
-                                        m_TableName) };
-  }
+auto SelectCommand::execute(Transaction& txn) -> Result {
+  auto view{ txn.read(m_TableName) };
+  const auto& table{ view.table };
 
-  // empty means wildcard all
-  if (m_Columns.empty()) {
-    for (auto&& [name, _] : db.m_Tables.at(m_TableName).getColumnMap()) {
-      m_Columns.push_back(name);
+  // empty means wildcard all, expanded per execution as the command may
+  // be cached and reused
+  auto columns{ m_Columns };
+  if (columns.empty()) {
+    for (auto&& [name, _] : table.getColumnMap()) {
+      columns.push_back(name);
     }
   }
 
-  Selector filter{ [this, &db](auto row) {
-    auto evalCond{ m_Condition->evaluate(
-        row, db.m_Tables.at(m_TableName).getColumnMap()) };
+  auto stage{ txn.profileStage(ScanStage) };
+  auto result{ table.selectRows(stage.countRows(makeFilter(table)),
+                                columns, view.snapshot) };
+  result.setNumScannedRows(view.snapshot.size);
+  // checked against the limit, though the result takes the row
+  // references beyond the statement
+  auto refsSize{ result.getNumRows() * sizeof(const Row*) };
+  txn.reserveMemory(refsSize);
+  txn.releaseMemory(refsSize);
+  return result;
+}
+
+void SelectCommand::explain(Transaction& txn, QueryPlan& plan) {
+  // fails on a missing table like execute()
+  txn.read(m_TableName);
+  auto output{ m_Columns.empty()
+                   ? std::string{ "*" }
+                   : fmt::format("{}", fmt::join(m_Columns, ", ")) };
+  // there are no indexes to read through, every SELECT scans
+  plan.addStage(fmt::format("Seq Scan on {}", m_TableName),
+                { fmt::format("Filter: {}", m_Condition->toString()),
+                  fmt::format("Output: {}", output) });
+}
+
+auto SelectCommand::exportRows(Transaction& txn, RowWriter& writer)
+    -> size_t {
+  auto view{ txn.read(m_TableName) };
+  const auto& table{ view.table };
+  return writer.write(table, view.snapshot, makeFilter(table),
+                      m_Columns.empty() ? table.getColumnNames()
+                                        : m_Columns);
+}
+
+auto SelectCommand::makeFilter(const Table& table) const -> Selector {
+  return [this, &table](const Row& row) {
+    auto evalCond{ m_Condition->evaluate(row, table.getColumnMap()) };
     if (evalCond.getType() != ValueType::Boolean) {
       throw CommandException{ fmt::format(
           "Condition should evalueate to bool, got {} instead",
           evalCond.toString()) };
     }
     return evalCond.template get<bool>();
-  } };
-
-  return db.m_Tables.at(m_TableName).selectRows(filter, m_Columns);
+  };
 }
 
 } // namespace adun::ast
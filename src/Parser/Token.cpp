@@ -1,12 +1,77 @@
 #include "adun/Parser/Token.hpp"
 #include "adun/Assert.hpp"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <limits>
 
 namespace adun {
 
+/// Escapes are validated by the lexer
+static auto decodeEscapedChar(char c) -> char {
+  switch (c) {
+  case 'a':
+    return '\a';
+  case 'b':
+    return '\b';
+  case 'f':
+    return '\f';
+  case 'n':
+    return '\n';
+  case 'r':
+    return '\r';
+  case 't':
+    return '\t';
+  case 'v':
+    return '\v';
+  case '0':
+    return '\0';
+  default:
+    return c;
+  }
+}
+
+static auto hexDigitValue(char c) -> uint8_t {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  return std::tolower(c) - 'a' + 10;
+}
+
+/// Parses "0x..." literal, odd digit count is padded from the left
+static auto byteArrayFromString(std::string_view str) -> ByteArray {
+  auto digits{ str.substr(2) };
+  ByteArray result;
+  result.reserve((digits.size() + 1) / 2);
+  if (digits.size() % 2 != 0) {
+    result.push_back(hexDigitValue(digits.front()));
+    digits.remove_prefix(1);
+  }
+  for (size_t i{ 0 }; i < digits.size(); i += 2) {
+    result.push_back(hexDigitValue(digits[i]) * 16 +
+                     hexDigitValue(digits[i + 1]));
+  }
+  return result;
+}
+
+static auto unescapeString(std::string_view body) -> std::string {
+  std::string value;
+  value.reserve(body.size());
+  for (size_t i{ 0 }; i < body.size(); i++) {
+    if (body[i] == '\\') {
+      i++;
+      value += decodeEscapedChar(body[i]);
+      continue;
+    }
+    value += body[i];
+  }
+  return value;
+}
+
 Token::Token(TokenKind kind, SourceIt loc, size_t length)
-    : m_Kind{ kind },
-      m_Length{ length },
-      m_Loc{ loc } {
+    : m_Loc{ loc },
+      m_Length{ static_cast<uint32_t>(length) },
+      m_Kind{ kind } {
 }
 
 auto Token::getKind() const -> TokenKind {
@@ -28,4 +93,45 @@ auto Token::getLength() const -> size_t {
   return m_Length;
 }
 
+auto Token::getLiteralValue() const -> Value {
+  adun_assert(isLiteral(), "Token is not a literal");
+  auto text{ getStringView() };
+  switch (m_Kind) {
+  case TokenKind::NumericLiteral: {
+    int32_t intVal{};
+    auto [_, ec]{ std::from_chars(text.begin(), text.end(), intVal) };
+    if (ec == std::errc::result_out_of_range) {
+      intVal = std::numeric_limits<int32_t>::max();
+    }
+    return intVal;
+  }
+  case TokenKind::StringLiteral:
+    return unescapeString(text.substr(1, text.size() - 2));
+  case TokenKind::HexLiteral:
+    return byteArrayFromString(text);
+  case TokenKind::KW_true:
+    return true;
+  case TokenKind::KW_false:
+    return false;
+  default: // null
+    return Value{};
+  }
+}
+
+auto getPunctuatorSpelling(TokenKind kind) -> std::string_view {
+  switch (kind) {
+    // clang-format off
+#undef TOK
+#undef PUNCT
+#define TOK(t)
+#define PUNCT(t, s) case TokenKind::t: return s;
+#include "adun/Parser/Tokens.def"
+#undef PUNCT
+#undef TOK
+    // clang-format on
+  default:
+    return {};
+  }
+}
+
 } // namespace adun
@@ -0,0 +1,11 @@
+#include "adun/Parser/TransactionCommand.hpp"
+
+namespace adun::ast {
+
+auto TransactionCommand::execute(Transaction& /*txn*/) -> Result {
+  throw CommandException{
+    "BEGIN, COMMIT and ROLLBACK are only valid in a Session"
+  };
+}
+
+} // namespace adun::ast
@@ -2,17 +2,25 @@
 
 namespace adun::ast {
 
-UnaryOpExpr::UnaryOpExpr(Ref<ExpressionNode> operand, TokenKind op)
+UnaryOpExpr::UnaryOpExpr(ExpressionNode* operand, TokenKind op)
     : ExpressionNode{ NodeKind::UnaryOpExpr },
       m_Op{ op },
-      m_Operand{ std::move(operand) } {
+      m_Operand{ operand } {
+}
+
+auto UnaryOpExpr::toString() const -> std::string {
+  if (m_Op == TokenKind::Pipe) {
+    return "|" + m_Operand->toString() + "|";
+  }
+  return std::string{ getPunctuatorSpelling(m_Op) } +
+         m_Operand->toString();
 }
 
 auto UnaryOpExpr::getOp() const -> TokenKind {
   return m_Op;
 }
 
-auto UnaryOpExpr::getOperand() -> Ref<ExpressionNode> {
+auto UnaryOpExpr::getOperand() -> ExpressionNode* {
   return m_Operand;
 }
 
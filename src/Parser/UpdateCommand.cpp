@@ -5,14 +5,13 @@
 
 namespace adun::ast {
 
-auto UpdateCommand::execute(Database& db) -> Result {
-  if (!db.m_Tables.contains(m_TableName)) {
-    throw CommandException{ fmt::format("Table '{}' does not exist",
-                                        m_TableName) };
-  }
-
-  Table& table{ db.m_Tables.at(m_TableName) };
-  Selector filter{ [this, &table](auto row) {
+auto UpdateCommand::execute(Transaction& txn) -> Result {
+  auto view{ [&] {
+    auto stage{ txn.profileStage(LockStage) };
+    return txn.write(m_TableName);
+  }() };
+  auto& table{ view.table };
+  Selector filter{ [this, &table](const Row& row) {
     auto evalCond{ m_Condition->evaluate(row, table.getColumnMap()) };
     if (evalCond.getType() != ValueType::Boolean) {
       throw CommandException{ fmt::format(
@@ -22,10 +21,12 @@ auto UpdateCommand::execute(Database& db) -> Result {
     return evalCond.template get<bool>();
   } };
 
-  size_t affectedRows{ 0 };
   const auto& colMap{ table.getColumnMap() };
-  table.traverseRows(
-      filter, [this, &affectedRows, &table, &colMap](auto& row) {
+  auto scannedRows{ view.write.getSnapshot().size };
+  auto stage{ txn.profileStage(WriteStage) };
+  auto affectedRows{ table.updateRows(
+      stage.countRows(std::move(filter)),
+      [this, &table, &colMap](Row& row) {
         for (auto& [columnName, expr] : m_Values) {
           if (!colMap.contains(columnName)) {
             throw NoSuchColumnException(columnName);
@@ -39,11 +40,34 @@ auto UpdateCommand::execute(Database& db) -> Result {
 
           row.get(colMap.at(columnName)) =
               expr->evaluate(row, table.getColumnMap());
-          table.checkConstraintsAgainst(row);
         }
-        affectedRows++;
-      });
-  return Result{ {}, {}, affectedRows };
+      },
+      view.write) };
+  stage.addVersions(affectedRows);
+  stage.addConstraintChecks(affectedRows * table.getNumUniqueColumns());
+  Result result{ {}, {}, affectedRows };
+  result.setNumScannedRows(scannedRows);
+  return result;
+}
+
+void UpdateCommand::explain(Transaction& txn, QueryPlan& plan) {
+  const auto& table{ txn.read(m_TableName).table };
+  plan.addStage(fmt::format("Lock {}", m_TableName));
+
+  std::vector<std::string> details{ fmt::format(
+      "Filter: {}", m_Condition->toString()) };
+  for (const auto& [columnName, expr] : m_Values) {
+    details.push_back(
+        fmt::format("Set: {} = {}", columnName, expr->toString()));
+  }
+  for (const auto& [name, column] : table.getScheme()) {
+    if (column.modifiers & Column::Modifier::Unique) {
+      details.push_back(fmt::format("Unique Check: index on {}", name));
+    }
+  }
+  // rows are matched and rewritten in one pass over the table
+  plan.addStage(fmt::format("Seq Scan and Update on {}", m_TableName),
+                std::move(details));
 }
 
 } // namespace adun::ast
@@ -0,0 +1,166 @@
+#include "adun/PerfCounters.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fmt/format.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace adun {
+
+auto PerfCounters::Values::has(Event event) const -> bool {
+  return (available & (1U << static_cast<unsigned>(event))) != 0;
+}
+
+auto PerfCounters::Values::get(Event event) const -> uint64_t {
+  return counts[static_cast<size_t>(event)];
+}
+
+auto PerfCounters::Values::getIpc() const -> double {
+  if (!has(Event::Cycles) || !has(Event::Instructions) ||
+      get(Event::Cycles) == 0) {
+    return 0;
+  }
+  return static_cast<double>(get(Event::Instructions)) /
+         static_cast<double>(get(Event::Cycles));
+}
+
+auto PerfCounters::Values::toString() const -> std::string {
+  std::string out;
+  for (size_t i{ 0 }; i < s_NumEvents; i++) {
+    auto event{ static_cast<Event>(i) };
+    if (has(event)) {
+      out += fmt::format("{}{}={}", out.empty() ? "" : ", ",
+                         getEventName(event), get(event));
+    }
+  }
+  if (getIpc() > 0) {
+    out += fmt::format(", ipc={:.2f}", getIpc());
+  }
+  return out;
+}
+
+auto PerfCounters::Values::operator+=(const Values& other) -> Values& {
+  for (size_t i{ 0 }; i < s_NumEvents; i++) {
+    counts[i] += other.counts[i];
+  }
+  available |= other.available;
+  return *this;
+}
+
+auto PerfCounters::Values::operator-(const Values& other) const
+    -> Values {
+  Values diff;
+  diff.available = available & other.available;
+  for (size_t i{ 0 }; i < s_NumEvents; i++) {
+    if (diff.has(static_cast<Event>(i))) {
+      // scaled counts may step back by a little
+      diff.counts[i] =
+          counts[i] > other.counts[i] ? counts[i] - other.counts[i] : 0;
+    }
+  }
+  return diff;
+}
+
+auto PerfCounters::getEventName(Event event) -> std::string_view {
+  static constexpr std::array<std::string_view, s_NumEvents> s_Names{
+    "cycles", "instructions", "cache_misses", "branch_misses"
+  };
+  return s_Names[static_cast<size_t>(event)];
+}
+
+auto PerfCounters::forThisThread() -> PerfCounters& {
+  thread_local PerfCounters t_Counters;
+  return t_Counters;
+}
+
+auto PerfCounters::isAvailable() const -> bool {
+  return m_NumEvents > 0;
+}
+
+auto PerfCounters::getError() const -> const std::string& {
+  return m_Error;
+}
+
+#ifdef __linux__
+
+PerfCounters::PerfCounters() {
+  static constexpr std::array<uint64_t, s_NumEvents> s_Configs{
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+  };
+  for (size_t i{ 0 }; i < s_NumEvents; i++) {
+    perf_event_attr attr{};
+    attr.size           = sizeof(attr);
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.config         = s_Configs[i];
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_GROUP |
+                       PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    auto fd{ static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1,
+                                      m_Leader, PERF_FLAG_FD_CLOEXEC)) };
+    auto event{ static_cast<Event>(i) };
+    if (fd < 0) {
+      m_Error += fmt::format("{}{}: {}", m_Error.empty() ? "" : ", ",
+                             getEventName(event), std::strerror(errno));
+      continue;
+    }
+    if (m_Leader < 0) {
+      m_Leader = fd;
+    }
+    m_Events[m_NumEvents] = event;
+    m_Fds[m_NumEvents]    = fd;
+    m_NumEvents++;
+  }
+}
+
+PerfCounters::~PerfCounters() {
+  for (size_t i{ 0 }; i < m_NumEvents; i++) {
+    close(m_Fds[i]);
+  }
+}
+
+auto PerfCounters::read() const -> Values {
+  Values values;
+  if (m_Leader < 0) {
+    return values;
+  }
+  // nr, time enabled, time running, then a value per event
+  std::array<uint64_t, 3 + s_NumEvents> buffer{};
+  auto size{ ::read(m_Leader, buffer.data(), sizeof(buffer)) };
+  if (size < static_cast<ssize_t>(3 * sizeof(uint64_t)) ||
+      buffer[0] != m_NumEvents || buffer[2] == 0) {
+    return values;
+  }
+  auto scale{ static_cast<double>(buffer[1]) /
+              static_cast<double>(buffer[2]) };
+  for (size_t i{ 0 }; i < m_NumEvents; i++) {
+    auto index{ static_cast<size_t>(m_Events[i]) };
+    values.counts[index] = static_cast<uint64_t>(
+        static_cast<double>(buffer[3 + i]) * scale);
+    values.available =
+        static_cast<uint8_t>(values.available | 1U << index);
+  }
+  return values;
+}
+
+#else
+
+PerfCounters::PerfCounters()
+    : m_Error{ "perf_event_open is Linux only" } {
+}
+
+PerfCounters::~PerfCounters() = default;
+
+auto PerfCounters::read() const -> Values {
+  return {};
+}
+
+#endif
+
+} // namespace adun
@@ -0,0 +1,208 @@
+#include "adun/Protocol.hpp"
+#include <fmt/format.h>
+#include <optional>
+
+namespace adun::protocol {
+
+auto getFrameSize(std::string_view buffer, size_t maxSize) -> size_t {
+  if (buffer.size() < s_HeaderSize) {
+    return 0;
+  }
+  size_t length{ 0 };
+  for (size_t i{ 0 }; i < s_HeaderSize; i++) {
+    length |= size_t{ static_cast<uint8_t>(buffer[i]) } << (i * 8U);
+  }
+  if (length == 0 || length > maxSize) {
+    throw ProtocolException{ fmt::format(
+        "Message of {} bytes, expected 1 to {}", length, maxSize) };
+  }
+  return buffer.size() >= s_HeaderSize + length ? s_HeaderSize + length
+                                                : 0;
+}
+
+MessageWriter::MessageWriter(std::string& out, MessageType type)
+    : m_Out{ out },
+      m_Start{ out.size() } {
+  m_Out.append(s_HeaderSize, '\0');
+  writeU8(static_cast<uint8_t>(type));
+}
+
+MessageWriter::~MessageWriter() {
+  auto length{ m_Out.size() - m_Start - s_HeaderSize };
+  for (size_t i{ 0 }; i < s_HeaderSize; i++) {
+    m_Out[m_Start + i] = static_cast<char>(length >> (i * 8U) & 0xffU);
+  }
+}
+
+template <typename T>
+void MessageWriter::writeInt(T value) {
+  for (size_t i{ 0 }; i < sizeof(T); i++) {
+    m_Out.push_back(static_cast<char>(value >> (i * 8U) & 0xffU));
+  }
+}
+
+void MessageWriter::writeU8(uint8_t value) {
+  m_Out.push_back(static_cast<char>(value));
+}
+
+void MessageWriter::writeU32(uint32_t value) {
+  writeInt(value);
+}
+
+void MessageWriter::writeU64(uint64_t value) {
+  writeInt(value);
+}
+
+void MessageWriter::writeString(std::string_view value) {
+  writeU32(static_cast<uint32_t>(value.size()));
+  m_Out.append(value);
+}
+
+void MessageWriter::writeValue(const Value& value) {
+  if (value.isEmpty() || value.isNull()) {
+    writeU8(static_cast<uint8_t>(ValueType::None));
+    return;
+  }
+  writeU8(static_cast<uint8_t>(value.getType()));
+  writeUntyped(value);
+}
+
+void MessageWriter::writeColumn(std::span<const Value* const> values) {
+  auto isNull{ [](const Value* value) {
+    return value->isEmpty() || value->isNull();
+  } };
+  std::optional<ValueType> type;
+  for (const auto* value : values) {
+    if (isNull(value)) {
+      continue;
+    }
+    if (!type) {
+      type = value->getType();
+    } else if (*type != value->getType()) {
+      type = ValueType::None;
+      break;
+    }
+  }
+  if (!type || *type == ValueType::None) {
+    writeU8(static_cast<uint8_t>(ValueType::None));
+    for (const auto* value : values) {
+      writeValue(*value);
+    }
+    return;
+  }
+
+  writeU8(static_cast<uint8_t>(*type));
+  auto nulls{ m_Out.size() };
+  m_Out.append((values.size() + 7) / 8, '\0');
+  for (size_t i{ 0 }; i < values.size(); i++) {
+    if (isNull(values[i])) {
+      m_Out[nulls + i / 8] |= static_cast<char>(1U << (i % 8));
+    } else {
+      writeUntyped(*values[i]);
+    }
+  }
+}
+
+void MessageWriter::writeUntyped(const Value& value) {
+  value.visit([this](const auto& v) {
+    using T = std::remove_cvref_t<decltype(v)>;
+    if constexpr (std::is_same_v<T, int32_t>) {
+      writeU32(static_cast<uint32_t>(v));
+    } else if constexpr (std::is_same_v<T, bool>) {
+      writeU8(v ? 1 : 0);
+    } else if constexpr (std::is_same_v<T, std::string>) {
+      writeString(v);
+    } else if constexpr (std::is_same_v<T, ByteArray>) {
+      writeString({ reinterpret_cast<const char*>(v.data()), v.size() });
+    }
+  });
+}
+
+MessageReader::MessageReader(std::string_view frame)
+    : m_Payload{ frame.substr(s_HeaderSize) } {
+  m_Type = static_cast<MessageType>(readU8());
+}
+
+auto MessageReader::getType() const -> MessageType {
+  return m_Type;
+}
+
+auto MessageReader::take(size_t size) -> std::string_view {
+  if (m_Payload.size() < size) {
+    throw ProtocolException{ "Message ends in the middle of a field" };
+  }
+  auto bytes{ m_Payload.substr(0, size) };
+  m_Payload.remove_prefix(size);
+  return bytes;
+}
+
+template <typename T>
+auto MessageReader::readInt() -> T {
+  auto bytes{ take(sizeof(T)) };
+  T value{ 0 };
+  for (size_t i{ 0 }; i < sizeof(T); i++) {
+    value |= static_cast<T>(static_cast<uint8_t>(bytes[i])) << (i * 8U);
+  }
+  return value;
+}
+
+auto MessageReader::readU8() -> uint8_t {
+  return readInt<uint8_t>();
+}
+
+auto MessageReader::readU32() -> uint32_t {
+  return readInt<uint32_t>();
+}
+
+auto MessageReader::readU64() -> uint64_t {
+  return readInt<uint64_t>();
+}
+
+auto MessageReader::readString() -> std::string_view {
+  return take(readU32());
+}
+
+auto MessageReader::readValue() -> Value {
+  return readUntyped(static_cast<ValueType>(readU8()));
+}
+
+auto MessageReader::readColumn(size_t count) -> std::vector<Value> {
+  std::vector<Value> values;
+  values.reserve(count);
+  auto type{ static_cast<ValueType>(readU8()) };
+  if (type == ValueType::None) {
+    for (size_t i{ 0 }; i < count; i++) {
+      values.push_back(readValue());
+    }
+    return values;
+  }
+
+  auto nulls{ take((count + 7) / 8) };
+  for (size_t i{ 0 }; i < count; i++) {
+    auto isNull{ (static_cast<uint8_t>(nulls[i / 8]) >> (i % 8) & 1U) !=
+                 0 };
+    values.push_back(isNull ? Value{} : readUntyped(type));
+  }
+  return values;
+}
+
+auto MessageReader::readUntyped(ValueType type) -> Value {
+  switch (type) {
+  case ValueType::Integer:
+    return static_cast<int32_t>(readU32());
+  case ValueType::Boolean:
+    return readU8() != 0;
+  case ValueType::String:
+    return std::string{ readString() };
+  case ValueType::Binary: {
+    auto bytes{ readString() };
+    return ByteArray(bytes.begin(), bytes.end());
+  }
+  case ValueType::None:
+    return Value{};
+  }
+  throw ProtocolException{ fmt::format("Unknown value type {}",
+                                       static_cast<unsigned>(type)) };
+}
+
+} // namespace adun::protocol
@@ -0,0 +1,129 @@
+#include "adun/QueryCache.hpp"
+#include "adun/Parser/Token.hpp"
+
+namespace adun {
+
+/// Stands for any literal in a normalized key
+static constexpr char s_LiteralMarker{ '?' };
+// token kinds are written as one char too and must not meet the marker
+static_assert(static_cast<size_t>(TokenKind::NUM_TOKENS) <=
+              static_cast<size_t>(s_LiteralMarker));
+
+QueryCache::QueryCache(size_t capacity)
+    : m_Capacity{ capacity } {
+}
+
+auto QueryCache::normalize(const TokenList& tokens) -> NormalizedQuery {
+  NormalizedQuery result;
+  for (const auto& tok : tokens) {
+    if (tok.isLiteral()) {
+      result.key += s_LiteralMarker;
+      result.numLiterals++;
+      continue;
+    }
+
+    // kind alone identifies keywords (case insensitive) and punctuators
+    result.key += static_cast<char>(tok.getKind());
+    if (tok.is(TokenKind::Identifier)) {
+      result.key += tok.getStringView();
+      result.key += '\0';
+    }
+  }
+  return result;
+}
+
+auto QueryCache::take(const NormalizedQuery& query,
+                      const TokenList& tokens)
+    -> std::optional<CachedCommand> {
+  std::optional<CachedCommand> cached{ take(query) };
+  if (!cached) {
+    return std::nullopt;
+  }
+
+  std::vector<Value> literals;
+  literals.reserve(query.numLiterals);
+  for (const auto& tok : tokens) {
+    if (tok.isLiteral()) {
+      literals.push_back(tok.getLiteralValue());
+    }
+  }
+  cached->command->bindLiterals(literals);
+  return cached;
+}
+
+auto QueryCache::take(const NormalizedQuery& query,
+                      std::span<const Value> literals)
+    -> std::optional<CachedCommand> {
+  std::optional<CachedCommand> cached{ take(query) };
+  if (cached) {
+    cached->command->bindLiterals(literals);
+  }
+  return cached;
+}
+
+auto QueryCache::take(const NormalizedQuery& query)
+    -> std::optional<CachedCommand> {
+  std::lock_guard lock{ m_Mutex };
+  auto it{ m_Index.find(query.key) };
+  if (it == m_Index.end()) {
+    m_Stats.misses++;
+    return std::nullopt;
+  }
+  m_Stats.hits++;
+
+  auto entryIt{ it->second };
+  CachedCommand cached{ std::move(entryIt->arena), entryIt->command };
+  m_Stats.memoryBytes -= entryIt->memoryBytes;
+  m_Index.erase(it);
+  m_Entries.erase(entryIt);
+  return cached;
+}
+
+void QueryCache::insert(NormalizedQuery query, Unique<Arena> arena,
+                        ast::Command* command) {
+  std::lock_guard lock{ m_Mutex };
+  if (m_Capacity == 0 || query.numLiterals > s_MaxCachedLiterals ||
+      m_Index.contains(query.key)) {
+    return;
+  }
+
+  auto memoryBytes{ sizeof(Entry) + sizeof(Arena) +
+                    query.key.capacity() + arena->getBytesUsed() };
+  m_Entries.push_front(Entry{ std::move(query.key), std::move(arena),
+                              command, memoryBytes });
+  m_Index.emplace(m_Entries.front().key, m_Entries.begin());
+  m_Stats.memoryBytes += memoryBytes;
+  evictOverflow();
+}
+
+void QueryCache::setCapacity(size_t capacity) {
+  std::lock_guard lock{ m_Mutex };
+  m_Capacity = capacity;
+  evictOverflow();
+}
+
+void QueryCache::clear() {
+  std::lock_guard lock{ m_Mutex };
+  m_Index.clear();
+  m_Entries.clear();
+  m_Stats.memoryBytes = 0;
+}
+
+auto QueryCache::getStats() const -> Stats {
+  std::lock_guard lock{ m_Mutex };
+  auto stats{ m_Stats };
+  stats.entries = m_Entries.size();
+  return stats;
+}
+
+void QueryCache::evictOverflow() {
+  while (m_Entries.size() > m_Capacity) {
+    auto& victim{ m_Entries.back() };
+    m_Index.erase(victim.key);
+    m_Stats.memoryBytes -= victim.memoryBytes;
+    m_Stats.evictions++;
+    m_Entries.pop_back();
+  }
+}
+
+} // namespace adun
@@ -0,0 +1,296 @@
+#include "adun/QueryMetrics.hpp"
+#include "adun/Assert.hpp"
+#include <bit>
+#include <cmath>
+#include <fmt/format.h>
+
+namespace adun {
+
+namespace {
+
+constexpr std::array s_Quantiles{ 0.5, 0.9, 0.99, 0.999 };
+
+/// Shards are picked round robin as threads first record
+auto getShardIndex(size_t numShards) -> size_t {
+  static std::atomic<size_t> s_NextShard{ 0 };
+  thread_local size_t t_Shard{ s_NextShard.fetch_add(
+      1, std::memory_order_relaxed) };
+  return t_Shard % numShards;
+}
+
+auto toNs(std::chrono::nanoseconds value) -> uint64_t {
+  return static_cast<uint64_t>(std::max<int64_t>(value.count(), 0));
+}
+
+} // namespace
+
+void LatencyHistogram::add(std::chrono::nanoseconds value) {
+  m_Buckets[getBucketIndex(toNs(value))]++;
+  m_Count++;
+  m_SumNs += toNs(value);
+}
+
+auto LatencyHistogram::getCount() const -> uint64_t {
+  return m_Count;
+}
+
+auto LatencyHistogram::getSum() const -> std::chrono::nanoseconds {
+  return std::chrono::nanoseconds{ m_SumNs };
+}
+
+auto LatencyHistogram::getQuantile(double quantile) const
+    -> std::chrono::nanoseconds {
+  if (m_Count == 0) {
+    return std::chrono::nanoseconds{ 0 };
+  }
+  auto rank{ std::max<uint64_t>(
+      static_cast<uint64_t>(
+          std::ceil(quantile * static_cast<double>(m_Count))),
+      1) };
+  uint64_t seen{ 0 };
+  for (size_t i{ 0 }; i < s_NumBuckets; i++) {
+    seen += m_Buckets[i];
+    if (seen >= rank) {
+      auto end{ i + 1 < s_NumBuckets ? getBucketStart(i + 1)
+                                     : getBucketStart(i) + 1 };
+      return std::chrono::nanoseconds{ end - 1 };
+    }
+  }
+  return std::chrono::nanoseconds{ getBucketStart(s_NumBuckets - 1) };
+}
+
+auto LatencyHistogram::getBucketIndex(uint64_t value) -> size_t {
+  if (value < s_SubBuckets) {
+    return value;
+  }
+  // top 4 bits of the value: the magnitude and 3 bits below it
+  auto magnitude{ static_cast<size_t>(std::bit_width(value)) - 1 };
+  auto sub{ static_cast<size_t>(value >> (magnitude - 3)) &
+            (s_SubBuckets - 1) };
+  return std::min((magnitude - 2) * s_SubBuckets + sub, s_NumBuckets - 1);
+}
+
+auto LatencyHistogram::getBucketStart(size_t index) -> uint64_t {
+  if (index < s_SubBuckets) {
+    return index;
+  }
+  auto magnitude{ index / s_SubBuckets + 2 };
+  auto sub{ index % s_SubBuckets };
+  return (s_SubBuckets + sub) << (magnitude - 3);
+}
+
+/// Counters of one shard, padded so shards don't share cache lines
+struct alignas(64) QueryMetrics::Shard {
+  struct Histogram {
+    std::array<std::atomic<uint64_t>, LatencyHistogram::s_NumBuckets>
+        buckets{};
+    std::atomic<uint64_t> sumNs{ 0 };
+
+    void add(std::chrono::nanoseconds value) {
+      buckets[LatencyHistogram::getBucketIndex(toNs(value))].fetch_add(
+          1, std::memory_order_relaxed);
+      sumNs.fetch_add(toNs(value), std::memory_order_relaxed);
+    }
+  };
+
+  struct Command {
+    std::atomic<uint64_t> count{ 0 };
+    std::atomic<uint64_t> errors{ 0 };
+    std::atomic<uint64_t> rowsScanned{ 0 };
+    std::atomic<uint64_t> rowsReturned{ 0 };
+    std::atomic<uint64_t> rowsAffected{ 0 };
+    Histogram lexTime;
+    Histogram parseTime;
+    Histogram executeTime;
+    std::array<std::atomic<uint64_t>, PerfCounters::s_NumEvents>
+        executeEvents{};
+  };
+
+  std::array<Command, s_NumKinds> commands;
+};
+
+QueryMetrics::QueryMetrics()
+    : m_Shards{ makeUnique<Shard[]>(s_NumShards) } { // NOLINT
+}
+
+QueryMetrics::~QueryMetrics() = default;
+
+auto QueryMetrics::getCommandKind(ast::NodeKind kind) -> CommandKind {
+  switch (kind) {
+  case ast::NodeKind::CreateCommand:
+    return CommandKind::Create;
+  case ast::NodeKind::InsertCommand:
+    return CommandKind::Insert;
+  case ast::NodeKind::SelectCommand:
+    return CommandKind::Select;
+  case ast::NodeKind::UpdateCommand:
+    return CommandKind::Update;
+  case ast::NodeKind::DeleteCommand:
+    return CommandKind::Delete;
+  case ast::NodeKind::CopyCommand:
+    return CommandKind::Copy;
+  case ast::NodeKind::TransactionCommand:
+    return CommandKind::Transaction;
+  case ast::NodeKind::ExplainCommand:
+    return CommandKind::Explain;
+  default:
+    return CommandKind::Invalid;
+  }
+}
+
+auto QueryMetrics::getCommandName(CommandKind kind) -> std::string_view {
+  static constexpr std::array<std::string_view, s_NumKinds> s_Names{
+    "create", "insert",      "select",  "update", "delete",
+    "copy",   "transaction", "explain", "invalid"
+  };
+  return s_Names[static_cast<size_t>(kind)];
+}
+
+void QueryMetrics::record(const Sample& sample) {
+  auto& shard{ m_Shards[getShardIndex(s_NumShards)] };
+  auto& command{ shard.commands[static_cast<size_t>(sample.kind)] };
+  command.count.fetch_add(1, std::memory_order_relaxed);
+  if (sample.failed) {
+    command.errors.fetch_add(1, std::memory_order_relaxed);
+  }
+  command.rowsScanned.fetch_add(sample.rowsScanned,
+                                std::memory_order_relaxed);
+  command.rowsReturned.fetch_add(sample.rowsReturned,
+                                 std::memory_order_relaxed);
+  command.rowsAffected.fetch_add(sample.rowsAffected,
+                                 std::memory_order_relaxed);
+  command.lexTime.add(sample.lexTime);
+  command.parseTime.add(sample.parseTime);
+  command.executeTime.add(sample.executeTime);
+  for (size_t i{ 0 }; i < PerfCounters::s_NumEvents; i++) {
+    if (sample.executeEvents.has(static_cast<PerfCounters::Event>(i))) {
+      command.executeEvents[i].fetch_add(sample.executeEvents.counts[i],
+                                         std::memory_order_relaxed);
+    }
+  }
+}
+
+auto QueryMetrics::getSnapshot() const -> Snapshot {
+  auto load{ [](const std::atomic<uint64_t>& counter) {
+    return counter.load(std::memory_order_relaxed);
+  } };
+  // bucket counts may be a few samples off from sums, which only skews
+  // a snapshot taken mid-recording
+  auto mergeHistogram{ [&load](LatencyHistogram& into,
+                               const Shard::Histogram& from) {
+    for (size_t i{ 0 }; i < LatencyHistogram::s_NumBuckets; i++) {
+      auto count{ load(from.buckets[i]) };
+      into.m_Buckets[i] += count;
+      into.m_Count += count;
+    }
+    into.m_SumNs += load(from.sumNs);
+  } };
+
+  Snapshot snapshot;
+  for (size_t s{ 0 }; s < s_NumShards; s++) {
+    for (size_t k{ 0 }; k < s_NumKinds; k++) {
+      const auto& from{ m_Shards[s].commands[k] };
+      auto& into{ snapshot.commands[k] };
+      into.count += load(from.count);
+      into.errors += load(from.errors);
+      into.rowsScanned += load(from.rowsScanned);
+      into.rowsReturned += load(from.rowsReturned);
+      into.rowsAffected += load(from.rowsAffected);
+      mergeHistogram(into.lexTime, from.lexTime);
+      mergeHistogram(into.parseTime, from.parseTime);
+      mergeHistogram(into.executeTime, from.executeTime);
+      for (size_t i{ 0 }; i < PerfCounters::s_NumEvents; i++) {
+        into.executeEvents[i] += load(from.executeEvents[i]);
+      }
+    }
+  }
+  return snapshot;
+}
+
+auto QueryMetrics::Snapshot::get(CommandKind kind) const
+    -> const CommandStats& {
+  return commands[static_cast<size_t>(kind)];
+}
+
+auto QueryMetrics::Snapshot::toPrometheus() const -> std::string {
+  std::string out;
+  auto counter{ [&](std::string_view name, std::string_view help,
+                    uint64_t CommandStats::*field) {
+    out += fmt::format("# HELP {} {}\n# TYPE {} counter\n", name, help,
+                       name);
+    for (size_t k{ 0 }; k < s_NumKinds; k++) {
+      out += fmt::format(
+          "{}{{command=\"{}\"}} {}\n", name,
+          getCommandName(static_cast<CommandKind>(k)), commands[k].*field);
+    }
+  } };
+  counter("adun_queries_total", "Statements executed",
+          &CommandStats::count);
+  counter("adun_query_errors_total", "Statements that failed",
+          &CommandStats::errors);
+  counter("adun_rows_scanned_total", "Row versions visited by scans",
+          &CommandStats::rowsScanned);
+  counter("adun_rows_returned_total", "Rows returned to clients",
+          &CommandStats::rowsReturned);
+  counter("adun_rows_affected_total", "Rows inserted, updated or deleted",
+          &CommandStats::rowsAffected);
+
+  static constexpr std::string_view s_Name{ "adun_query_phase_seconds" };
+  out += fmt::format("# HELP {} Time spent per statement phase\n"
+                     "# TYPE {} summary\n",
+                     s_Name, s_Name);
+  auto seconds{ [](std::chrono::nanoseconds value) {
+    return std::chrono::duration<double>(value).count();
+  } };
+  for (size_t k{ 0 }; k < s_NumKinds; k++) {
+    const auto& stats{ commands[k] };
+    if (stats.count == 0) {
+      continue;
+    }
+    for (auto [phase, histogram] :
+         { std::pair{ "lex", &stats.lexTime },
+           std::pair{ "parse", &stats.parseTime },
+           std::pair{ "execute", &stats.executeTime } }) {
+      auto labels{ fmt::format(
+          "command=\"{}\",phase=\"{}\"",
+          getCommandName(static_cast<CommandKind>(k)), phase) };
+      for (auto quantile : s_Quantiles) {
+        out += fmt::format("{}{{{},quantile=\"{}\"}} {}\n", s_Name,
+                           labels, quantile,
+                           seconds(histogram->getQuantile(quantile)));
+      }
+      out += fmt::format("{}_sum{{{}}} {}\n", s_Name, labels,
+                         seconds(histogram->getSum()));
+      out += fmt::format("{}_count{{{}}} {}\n", s_Name, labels,
+                         histogram->getCount());
+    }
+  }
+
+  // only with hardware counters enabled
+  static constexpr std::string_view s_EventsName{
+    "adun_query_hardware_events_total"
+  };
+  bool headerWritten{ false };
+  for (size_t k{ 0 }; k < s_NumKinds; k++) {
+    for (size_t i{ 0 }; i < PerfCounters::s_NumEvents; i++) {
+      auto count{ commands[k].executeEvents[i] };
+      if (count == 0) {
+        continue;
+      }
+      if (!headerWritten) {
+        out += fmt::format("# HELP {} Hardware events counted while "
+                           "executing\n# TYPE {} counter\n",
+                           s_EventsName, s_EventsName);
+        headerWritten = true;
+      }
+      out += fmt::format(
+          "{}{{command=\"{}\",event=\"{}\"}} {}\n", s_EventsName,
+          getCommandName(static_cast<CommandKind>(k)),
+          PerfCounters::getEventName(static_cast<PerfCounters::Event>(i)),
+          count);
+    }
+  }
+  return out;
+}
+
+} // namespace adun
@@ -0,0 +1,86 @@
+#include "adun/QueryPlan.hpp"
+#include "adun/Assert.hpp"
+#include <fmt/format.h>
+
+namespace adun {
+
+auto QueryPlan::addStage(std::string name,
+                         std::vector<std::string> details) -> PlanStage& {
+  return m_Stages.emplace_back(std::move(name), std::move(details));
+}
+
+auto QueryPlan::getStage(size_t index) -> PlanStage& {
+  adun_assert(index < m_Stages.size(), "No such plan stage");
+  return m_Stages[index];
+}
+
+auto QueryPlan::format(bool analyzed) const -> std::vector<std::string> {
+  std::vector<std::string> lines;
+  for (const auto& stage : m_Stages) {
+    if (analyzed) {
+      lines.push_back(fmt::format(
+          "{} (time={:.3f} ms, rows examined={}, rows matched={}, "
+          "versions allocated={}, unique checks={})",
+          stage.name,
+          std::chrono::duration<double, std::milli>(stage.time).count(),
+          stage.rowsExamined, stage.rowsMatched, stage.versionsAppended,
+          stage.constraintChecks));
+    } else {
+      lines.push_back(stage.name);
+    }
+    for (const auto& detail : stage.details) {
+      lines.push_back("  " + detail);
+    }
+    if (analyzed && stage.events.available != 0) {
+      lines.push_back("  Hardware Counters: " + stage.events.toString());
+    }
+  }
+  return lines;
+}
+
+StageProfiler::StageProfiler(PlanStage* stage, bool countEvents)
+    : m_Stage{ stage },
+      m_CountEvents{ stage != nullptr && countEvents } {
+  if (m_CountEvents) {
+    m_StartEvents = PerfCounters::forThisThread().read();
+  }
+  if (m_Stage != nullptr) {
+    m_Start = std::chrono::steady_clock::now();
+  }
+}
+
+StageProfiler::~StageProfiler() {
+  if (m_Stage != nullptr) {
+    m_Stage->time += std::chrono::steady_clock::now() - m_Start;
+  }
+  if (m_CountEvents) {
+    m_Stage->events +=
+        PerfCounters::forThisThread().read() - m_StartEvents;
+  }
+}
+
+auto StageProfiler::countRows(Selector filter) const -> Selector {
+  if (m_Stage == nullptr) {
+    return filter;
+  }
+  return [stage = m_Stage, filter = std::move(filter)](const Row& row) {
+    stage->rowsExamined++;
+    bool matched{ filter(row) };
+    stage->rowsMatched += matched ? 1 : 0;
+    return matched;
+  };
+}
+
+void StageProfiler::addVersions(size_t count) {
+  if (m_Stage != nullptr) {
+    m_Stage->versionsAppended += count;
+  }
+}
+
+void StageProfiler::addConstraintChecks(size_t count) {
+  if (m_Stage != nullptr) {
+    m_Stage->constraintChecks += count;
+  }
+}
+
+} // namespace adun
@@ -3,9 +3,11 @@
 
 namespace adun {
 
-Result::Result(std::vector<RowRefWrapper> rows,
-               ColumnNameIndexMap columnNames, size_t affectedRows)
+Result::Result(std::vector<const Row*> rows,
+               ColumnNameIndexMap columnNames, size_t affectedRows,
+               Ref<const void> snapshot)
     : m_Rows{ std::move(rows) },
+      m_Snapshot{ std::move(snapshot) },
       m_ColumnNames{ std::move(columnNames) },
       m_AffectedRows{ affectedRows } {
 }
@@ -10,7 +10,7 @@ ResultIterator::ResultIterator(UnderlyingIterator iter,
     : m_Iter{ iter },
       m_EndIter{ end } {
   if (m_Iter != m_EndIter) {
-    m_Row = { &m_Iter->get(), std::move(columnNames) };
+    m_Row = { *m_Iter, std::move(columnNames) };
   }
 }
 auto ResultIterator::operator->() -> pointer {
@@ -27,7 +27,7 @@ auto ResultIterator::operator++(int) -> ResultIterator {
 auto ResultIterator::operator++() -> ResultIterator& {
   ++m_Iter;
   if (m_Iter != m_EndIter) {
-    m_Row = { &m_Iter->get(), std::move(m_Row.m_Columns) };
+    m_Row = { *m_Iter, std::move(m_Row.m_Columns) };
   }
   return *this;
 }
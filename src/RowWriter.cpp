@@ -0,0 +1,217 @@
+#include "adun/RowWriter.hpp"
+#include "adun/Exceptions.hpp"
+#include "adun/Table.hpp"
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <string_view>
+
+namespace adun {
+
+namespace {
+
+constexpr std::string_view s_HexDigits{ "0123456789abcdef" };
+
+class CsvRowWriter final : public RowWriter {
+public:
+  explicit CsvRowWriter(std::ostream& out)
+      : RowWriter{ out } {
+  }
+
+private:
+  void writeHeader(std::span<const std::string> names,
+                   std::span<const ValueType> /*types*/) override {
+    for (size_t i{ 0 }; i < names.size(); i++) {
+      if (i != 0) {
+        append(',');
+      }
+      appendString(names[i]);
+    }
+    append('\n');
+  }
+
+  void writeRow(const Row& row,
+                std::span<const size_t> columns) override {
+    for (size_t i{ 0 }; i < columns.size(); i++) {
+      if (i != 0) {
+        append(',');
+      }
+      appendValue(row.get(columns[i]));
+    }
+    append('\n');
+  }
+
+  /// Null stays an empty field, which CsvLoader reads back as default
+  void appendValue(const Value& value) {
+    if (value.isEmpty() || value.isNull()) {
+      return;
+    }
+    value.visit([this](const auto& v) {
+      using T = std::remove_cvref_t<decltype(v)>;
+      if constexpr (std::is_same_v<T, int32_t>) {
+        std::array<char, 16> digits{};
+        auto [end, _]{ std::to_chars(digits.begin(), digits.end(), v) };
+        append(std::string_view{ digits.begin(), end });
+      } else if constexpr (std::is_same_v<T, bool>) {
+        append(v ? "true" : "false");
+      } else if constexpr (std::is_same_v<T, std::string>) {
+        appendString(v);
+      } else if constexpr (std::is_same_v<T, ByteArray>) {
+        append("0x");
+        for (auto byte : v) {
+          append(s_HexDigits[byte >> 4U]);
+          append(s_HexDigits[byte & 0xfU]);
+        }
+      }
+    });
+  }
+
+  /// Quotes only when needed, empty strings always to tell them from
+  /// null
+  void appendString(std::string_view str) {
+    if (!str.empty() && str.find_first_of(",\"\r\n") == str.npos) {
+      append(str);
+      return;
+    }
+    append('"');
+    for (auto quote{ str.find('"') }; quote != str.npos;
+         quote = str.find('"')) {
+      append(str.substr(0, quote + 1));
+      append('"');
+      str.remove_prefix(quote + 1);
+    }
+    append(str);
+    append('"');
+  }
+};
+
+class BinaryRowWriter final : public RowWriter {
+public:
+  explicit BinaryRowWriter(std::ostream& out)
+      : RowWriter{ out } {
+  }
+
+private:
+  static constexpr uint8_t s_Version{ 1 };
+
+  void writeHeader(std::span<const std::string> names,
+                   std::span<const ValueType> types) override {
+    append("ADUN");
+    appendInt<uint8_t>(s_Version);
+    appendInt<uint32_t>(names.size());
+    for (size_t i{ 0 }; i < names.size(); i++) {
+      appendInt<uint8_t>(static_cast<uint8_t>(types[i]));
+      appendBytes(names[i]);
+    }
+  }
+
+  void writeRow(const Row& row,
+                std::span<const size_t> columns) override {
+    appendInt<uint8_t>(1);
+    for (auto column : columns) {
+      const auto& value{ row.get(column) };
+      if (value.isEmpty() || value.isNull()) {
+        appendInt<uint8_t>(static_cast<uint8_t>(ValueType::None));
+        continue;
+      }
+      appendInt<uint8_t>(static_cast<uint8_t>(value.getType()));
+      value.visit([this](const auto& v) {
+        using T = std::remove_cvref_t<decltype(v)>;
+        if constexpr (std::is_same_v<T, int32_t>) {
+          appendInt<uint32_t>(static_cast<uint32_t>(v));
+        } else if constexpr (std::is_same_v<T, bool>) {
+          appendInt<uint8_t>(v ? 1 : 0);
+        } else if constexpr (std::is_same_v<T, std::string>) {
+          appendBytes(v);
+        } else if constexpr (std::is_same_v<T, ByteArray>) {
+          appendBytes({ reinterpret_cast<const char*>(v.data()),
+                        v.size() });
+        }
+      });
+    }
+  }
+
+  void writeEnd() override {
+    appendInt<uint8_t>(0);
+  }
+
+  template <typename T>
+  void appendInt(T value) {
+    for (size_t i{ 0 }; i < sizeof(T); i++) {
+      append(static_cast<char>(value >> (i * 8U) & 0xffU));
+    }
+  }
+
+  void appendBytes(std::string_view bytes) {
+    appendInt<uint32_t>(bytes.size());
+    append(bytes);
+  }
+};
+
+} // namespace
+
+auto RowWriter::create(ExportFormat format, std::ostream& out)
+    -> Unique<RowWriter> {
+  switch (format) {
+  case ExportFormat::Csv:
+    return makeUnique<CsvRowWriter>(out);
+  case ExportFormat::Binary:
+    return makeUnique<BinaryRowWriter>(out);
+  }
+  adun_assert(false, "Unknown export format");
+  return nullptr;
+}
+
+RowWriter::RowWriter(std::ostream& out)
+    : m_Out{ out } {
+  m_Buffer.reserve(s_BufferSize);
+}
+
+auto RowWriter::write(const Table& table,
+                      const Table::Snapshot& snapshot,
+                      const Selector& filter,
+                      const std::vector<std::string>& columns)
+    -> size_t {
+  const auto& scheme{ table.getScheme() };
+  std::vector<size_t> indices;
+  std::vector<ValueType> types;
+  for (const auto& name : columns) {
+    auto it{ scheme.find(name) };
+    if (it == scheme.end()) {
+      throw NoSuchColumnException(name);
+    }
+    indices.push_back(it->second.index);
+    types.push_back(it->second.getType());
+  }
+
+  writeHeader(columns, types);
+  size_t numRows{ 0 };
+  table.scanRows(
+      filter,
+      [&](const Row& row) {
+        writeRow(row, indices);
+        flushIfFull();
+        numRows++;
+      },
+      snapshot);
+  writeEnd();
+  flush();
+  return numRows;
+}
+
+void RowWriter::flushIfFull() {
+  if (m_Buffer.size() >= s_BufferSize) {
+    flush();
+  }
+}
+
+void RowWriter::flush() {
+  m_Out.write(m_Buffer.data(),
+              static_cast<std::streamsize>(m_Buffer.size()));
+  m_Buffer.clear();
+  if (!m_Out) {
+    throw FileException{ "Failed to write exported rows" };
+  }
+}
+
+} // namespace adun
@@ -0,0 +1,709 @@
+#include "adun/Server.hpp"
+#include "adun/Database.hpp"
+#include "adun/Parser/Lexer.hpp"
+#include "adun/Parser/Parser.hpp"
+#include "adun/Tracer.hpp"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fmt/format.h>
+#include <iterator>
+#include <optional>
+
+#ifdef __linux__
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace adun {
+
+using namespace protocol;
+
+namespace {
+
+/// Literals of the statement are its parameters, bound in their place
+struct PreparedStatement {
+  Unique<std::string> text; ///< lexed into tokens, must not move
+  Ref<TokenList> tokens;
+  size_t numLiterals{ 0 };
+};
+
+/// A result sent in part, kept while its connection waits for the
+/// client to read
+struct PendingResult {
+  Result result;
+  std::vector<size_t> columns; ///< indices, in row layout order
+  size_t nextRow{ 0 };
+};
+
+} // namespace
+
+struct Server::Connection {
+  Connection(int socket, Database& db)
+      : fd{ socket },
+        session{ db } {
+  }
+
+  const int fd;
+  Session session; ///< used by one worker at a time, see busy
+  std::string input;       ///< loop only
+  uint32_t events{ 0 };    ///< loop only, epoll interest
+  bool closed{ false };    ///< loop only
+
+  std::mutex mutex;
+  /// A worker finished or closing was set
+  std::condition_variable changed;
+  std::string output; ///< guarded by mutex, as the rest
+  size_t sent{ 0 };   ///< bytes of output written already
+  bool busy{ false }; ///< a worker runs a request
+  /// Requests wait for the client to read the output, see runRequests
+  bool parked{ false };
+  bool closing{ false };
+
+  /// worker only
+  std::unordered_map<uint32_t, PreparedStatement> statements;
+  uint32_t nextStatementId{ 1 };
+  /// worker only, what a parked worker left to do
+  std::deque<std::string> frames;
+  std::optional<PendingResult> result;
+};
+
+#ifdef __linux__
+
+namespace {
+
+auto systemError(std::string_view what) -> ServerException {
+  return ServerException{ fmt::format("{}: {}", what,
+                                      std::strerror(errno)) };
+}
+
+void closeFd(int& fd) {
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+}
+
+auto listenTcp(const std::string& host, uint16_t port) -> int {
+  addrinfo hints{};
+  hints.ai_family   = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags    = AI_PASSIVE | AI_NUMERICSERV;
+  addrinfo* addresses{ nullptr };
+  auto service{ std::to_string(port) };
+  if (auto error{ ::getaddrinfo(host.c_str(), service.c_str(), &hints,
+                                &addresses) };
+      error != 0) {
+    throw ServerException{ fmt::format("Cannot resolve '{}': {}", host,
+                                       ::gai_strerror(error)) };
+  }
+
+  int fd{ -1 };
+  for (auto* address{ addresses }; address != nullptr;
+       address = address->ai_next) {
+    fd = ::socket(address->ai_family,
+                  address->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                  address->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    int on{ 1 };
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (::bind(fd, address->ai_addr, address->ai_addrlen) == 0 &&
+        ::listen(fd, SOMAXCONN) == 0) {
+      break;
+    }
+    closeFd(fd);
+  }
+  ::freeaddrinfo(addresses);
+  if (fd < 0) {
+    throw systemError(fmt::format("Cannot listen on {}:{}", host, port));
+  }
+  return fd;
+}
+
+auto listenUnix(const std::string& path) -> int {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    throw ServerException{ fmt::format("Socket path '{}' is too long",
+                                       path) };
+  }
+  std::ranges::copy(path, std::begin(address.sun_path));
+
+  int fd{ ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                   0) };
+  if (fd < 0) {
+    throw systemError("Cannot create socket");
+  }
+  // left behind by a server that didn't stop cleanly
+  ::unlink(path.c_str());
+  if (::bind(fd, reinterpret_cast<const sockaddr*>(&address),
+             sizeof(address)) != 0 ||
+      ::listen(fd, SOMAXCONN) != 0) {
+    auto error{ systemError(fmt::format("Cannot listen on '{}'", path)) };
+    ::close(fd);
+    throw error;
+  }
+  return fd;
+}
+
+} // namespace
+
+Server::Server(Database& db, Options options)
+    : m_Db{ db },
+      m_Options{ std::move(options) },
+      m_Pool{ m_Options.numWorkers } {
+  try {
+    m_Epoll = ::epoll_create1(EPOLL_CLOEXEC);
+    m_WakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_Epoll < 0 || m_WakeFd < 0) {
+      throw systemError("Cannot set up the event loop");
+    }
+    if (m_Options.listenTcp) {
+      m_TcpFd = listenTcp(m_Options.host, m_Options.port);
+      sockaddr_storage address{};
+      socklen_t length{ sizeof(address) };
+      ::getsockname(m_TcpFd, reinterpret_cast<sockaddr*>(&address),
+                    &length);
+      m_Port = ntohs(address.ss_family == AF_INET6
+                         ? reinterpret_cast<sockaddr_in6&>(address)
+                               .sin6_port
+                         : reinterpret_cast<sockaddr_in&>(address)
+                               .sin_port);
+    }
+    if (!m_Options.unixPath.empty()) {
+      m_UnixFd = listenUnix(m_Options.unixPath);
+    }
+    for (auto fd : { m_WakeFd, m_TcpFd, m_UnixFd }) {
+      epoll_event event{};
+      event.events  = EPOLLIN;
+      event.data.fd = fd;
+      if (fd >= 0 &&
+          ::epoll_ctl(m_Epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+        throw systemError("Cannot set up the event loop");
+      }
+    }
+  } catch (...) {
+    stop();
+    throw;
+  }
+}
+
+Server::~Server() {
+  stop();
+}
+
+void Server::start() {
+  m_Loop = std::jthread{ [this](const std::stop_token& stop) {
+    Tracer::setThreadName("adun server");
+    loop(stop);
+  } };
+}
+
+void Server::stop() {
+  m_Stopping.store(true, std::memory_order_relaxed);
+  if (m_Loop.joinable()) {
+    m_Loop.request_stop();
+    wake();
+    m_Loop.join();
+  }
+
+  // all cancelled first, so that their workers stop side by side
+  for (const auto& [fd, conn] : m_Connections) {
+    std::lock_guard lock{ conn->mutex };
+    conn->closing = true;
+    conn->session.cancel();
+    conn->changed.notify_all();
+  }
+  // workers refer to the server until they finish their request
+  for (const auto& [fd, conn] : m_Connections) {
+    std::unique_lock lock{ conn->mutex };
+    conn->changed.wait(lock, [&] { return !conn->busy; });
+  }
+  while (!m_Connections.empty()) {
+    auto conn{ m_Connections.begin()->second };
+    close(conn);
+  }
+  m_Notified.clear();
+
+  if (m_UnixFd >= 0) {
+    ::unlink(m_Options.unixPath.c_str());
+  }
+  for (auto* fd : { &m_UnixFd, &m_TcpFd, &m_WakeFd, &m_Epoll }) {
+    closeFd(*fd);
+  }
+}
+
+auto Server::getPort() const -> uint16_t {
+  return m_Port;
+}
+
+auto Server::getNumConnections() const -> size_t {
+  return m_NumConnections.load(std::memory_order_relaxed);
+}
+
+void Server::loop(const std::stop_token& stop) {
+  std::array<epoll_event, 64> events{};
+  while (!stop.stop_requested()) {
+    auto numEvents{ ::epoll_wait(m_Epoll, events.data(),
+                                 static_cast<int>(events.size()), -1) };
+    for (int i{ 0 }; i < numEvents; i++) {
+      auto fd{ events[i].data.fd };
+      if (fd == m_WakeFd) {
+        uint64_t count{ 0 };
+        [[maybe_unused]] auto read{ ::read(m_WakeFd, &count,
+                                           sizeof(count)) };
+        std::vector<Ref<Connection>> notified;
+        {
+          std::lock_guard lock{ m_NotifiedMutex };
+          std::swap(notified, m_Notified);
+        }
+        for (const auto& conn : notified) {
+          service(conn);
+        }
+      } else if (fd == m_TcpFd || fd == m_UnixFd) {
+        accept(fd);
+      } else if (auto it{ m_Connections.find(fd) };
+                 it != m_Connections.end()) {
+        // copied, servicing may close it
+        auto conn{ it->second };
+        if ((events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0) {
+          readFrom(conn);
+        } else {
+          service(conn);
+        }
+      }
+    }
+  }
+}
+
+void Server::accept(int listenFd) {
+  while (true) {
+    int fd{ ::accept4(listenFd, nullptr, nullptr,
+                      SOCK_NONBLOCK | SOCK_CLOEXEC) };
+    if (fd < 0) {
+      // EAGAIN once the backlog is empty, a failed connection otherwise
+      return;
+    }
+    if (listenFd == m_TcpFd) {
+      // responses are written whole, small ones must not wait
+      int on{ 1 };
+      ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+    auto conn{ makeRef<Connection>(fd, m_Db) };
+    conn->events = EPOLLIN;
+    epoll_event event{};
+    event.events  = conn->events;
+    event.data.fd = fd;
+    if (::epoll_ctl(m_Epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+      ::close(fd);
+      continue;
+    }
+    m_Connections.emplace(fd, std::move(conn));
+    m_NumConnections.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void Server::readFrom(const Ref<Connection>& conn) {
+  std::array<char, 1 << 16> buffer{};
+  while (true) {
+    auto size{ ::recv(conn->fd, buffer.data(), buffer.size(), 0) };
+    if (size > 0) {
+      conn->input.append(buffer.data(), static_cast<size_t>(size));
+      continue;
+    }
+    if (size < 0 && (errno == EAGAIN || errno == EINTR)) {
+      break;
+    }
+    // the client is gone, so is the point of its running statement
+    std::lock_guard lock{ conn->mutex };
+    conn->closing = true;
+    conn->output.clear();
+    conn->sent = 0;
+    conn->session.cancel();
+    conn->changed.notify_all();
+    break;
+  }
+  service(conn);
+}
+
+void Server::service(const Ref<Connection>& conn) {
+  if (conn->closed) {
+    return;
+  }
+  std::unique_lock lock{ conn->mutex };
+  while (conn->sent < conn->output.size()) {
+    auto size{ ::send(conn->fd, conn->output.data() + conn->sent,
+                      conn->output.size() - conn->sent, MSG_NOSIGNAL) };
+    if (size < 0) {
+      if (errno == EAGAIN || errno == EINTR) {
+        break;
+      }
+      conn->closing = true;
+      conn->output.clear();
+      conn->sent = 0;
+      conn->session.cancel();
+      break;
+    }
+    conn->sent += static_cast<size_t>(size);
+  }
+  if (conn->sent == conn->output.size()) {
+    conn->output.clear();
+    conn->sent = 0;
+  }
+  conn->changed.notify_all();
+
+  if (!conn->busy && !conn->closing && conn->parked) {
+    // resumed once the client read everything, not for every few bytes
+    if (conn->output.empty()) {
+      conn->parked = false;
+      conn->busy   = true;
+      m_Pool.post([this, conn] { runRequests(conn, {}); });
+    }
+  } else if (!conn->busy && !conn->closing) {
+    // all that are buffered, pipelined requests go to one worker
+    std::vector<std::string> frames;
+    size_t taken{ 0 };
+    try {
+      while (auto size{ getFrameSize(
+                 std::string_view{ conn->input }.substr(taken),
+                 m_Options.maxMessageSize) }) {
+        frames.push_back(conn->input.substr(taken, size));
+        taken += size;
+      }
+    } catch (const ProtocolException& e) {
+      // the ones before are answered first, it is met again after them
+      if (frames.empty()) {
+        MessageWriter error{ conn->output, MessageType::Error };
+        error.writeU8(static_cast<uint8_t>(ErrorCode::Protocol));
+        error.writeString(e.what());
+        conn->closing = true;
+      }
+    }
+    conn->input.erase(0, taken);
+    if (!frames.empty()) {
+      conn->busy = true;
+      m_Pool.post([this, conn, frames = std::move(frames)]() mutable {
+        runRequests(conn, std::move(frames));
+      });
+    }
+  }
+
+  auto pending{ conn->sent < conn->output.size() };
+  if (conn->closing && !pending) {
+    if (!conn->busy) {
+      lock.unlock();
+      close(conn);
+      return;
+    }
+    // closed once the worker notifies, hang ups would repeat meanwhile
+    if (conn->events != 0) {
+      conn->events = 0;
+      ::epoll_ctl(m_Epoll, EPOLL_CTL_DEL, conn->fd, nullptr);
+    }
+    return;
+  }
+  auto reading{ !conn->closing &&
+                 ((!conn->busy && !conn->parked) ||
+                  conn->input.size() < s_MaxPendingInput) };
+  uint32_t events{ (reading ? EPOLLIN : 0U) | (pending ? EPOLLOUT : 0U) };
+  if (events != conn->events) {
+    conn->events = events;
+    epoll_event event{};
+    event.events  = events;
+    event.data.fd = conn->fd;
+    ::epoll_ctl(m_Epoll, EPOLL_CTL_MOD, conn->fd, &event);
+  }
+}
+
+void Server::close(const Ref<Connection>& conn) {
+  ::epoll_ctl(m_Epoll, EPOLL_CTL_DEL, conn->fd, nullptr);
+  ::close(conn->fd);
+  conn->closed = true;
+  m_Connections.erase(conn->fd);
+  m_NumConnections.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void Server::notify(const Ref<Connection>& conn) {
+  {
+    std::lock_guard lock{ m_NotifiedMutex };
+    m_Notified.push_back(conn);
+  }
+  wake();
+}
+
+void Server::wake() {
+  uint64_t one{ 1 };
+  // fails only if the counter is saturated, which wakes the loop too
+  [[maybe_unused]] auto written{ ::write(m_WakeFd, &one, sizeof(one)) };
+}
+
+#else
+
+Server::Server(Database& db, Options options)
+    : m_Db{ db },
+      m_Options{ std::move(options) } {
+  throw ServerException{ "The server needs epoll, which is Linux only" };
+}
+
+Server::~Server() = default;
+
+void Server::start() {
+}
+
+void Server::stop() {
+}
+
+auto Server::getPort() const -> uint16_t {
+  return m_Port;
+}
+
+auto Server::getNumConnections() const -> size_t {
+  return 0;
+}
+
+void Server::notify(const Ref<Connection>& /*conn*/) {
+}
+
+void Server::wake() {
+}
+
+#endif
+
+void Server::runRequests(const Ref<Connection>& conn,
+                         std::vector<std::string> frames) {
+  auto isClosing{ [&] {
+    if (m_Stopping.load(std::memory_order_relaxed)) {
+      return true;
+    }
+    std::lock_guard lock{ conn->mutex };
+    return conn->closing;
+  } };
+
+  // after the ones a parked worker left
+  std::ranges::move(frames, std::back_inserter(conn->frames));
+  std::string out;
+  bool parked{ false };
+  try {
+    // the rest is dropped once nobody waits for it
+    while (!parked && !isClosing()) {
+      if (conn->result) {
+        parked = !writeRows(conn, out);
+      } else if (conn->frames.empty()) {
+        break;
+      } else {
+        auto frame{ std::move(conn->frames.front()) };
+        conn->frames.pop_front();
+        if (!handleRequest(conn, frame, out)) {
+          break;
+        }
+        parked = out.size() >= s_CoalesceSize && !send(conn, out);
+      }
+    }
+    if (!out.empty()) {
+      send(conn, out);
+    }
+  } catch (const QueryCancelledException&) {
+    // nobody to tell
+  }
+
+  std::lock_guard lock{ conn->mutex };
+  if (conn->closing) {
+    conn->frames.clear();
+    conn->result.reset();
+    parked = false;
+  }
+  conn->busy   = false;
+  conn->parked = parked;
+  conn->changed.notify_all();
+  // last touch of the server, stop() may return right after
+  notify(conn);
+}
+
+auto Server::handleRequest(const Ref<Connection>& conn,
+                           const std::string& frame, std::string& out)
+    -> bool {
+  // requests fail before any of their response is written
+  auto writeError{ [&](ErrorCode code, std::string_view message) {
+    MessageWriter error{ out, MessageType::Error };
+    error.writeU8(static_cast<uint8_t>(code));
+    error.writeString(message);
+  } };
+
+  try {
+    MessageReader request{ frame };
+    switch (request.getType()) {
+    case MessageType::Query: {
+      auto query{ std::string{ request.readString() } };
+      startResult(conn, conn->session.execute(query), out);
+      break;
+    }
+    case MessageType::Prepare: {
+      PreparedStatement statement{
+        makeUnique<std::string>(request.readString()), {}, 0
+      };
+      Lexer lexer;
+      lexer.lex(*statement.text);
+      statement.tokens = lexer.getTokens();
+      std::vector<Value> literals;
+      for (const auto& tok : *statement.tokens) {
+        if (tok.isLiteral()) {
+          literals.push_back(tok.getLiteralValue());
+        }
+      }
+      // fails now for statements that would drop their parameters
+      Arena arena;
+      Parser parser{ statement.tokens, arena };
+      parser.buildAST()->bindLiterals(literals);
+      statement.numLiterals = literals.size();
+      auto id{ conn->nextStatementId++ };
+      {
+        MessageWriter prepared{ out, MessageType::Prepared };
+        prepared.writeU32(id);
+        prepared.writeU32(statement.numLiterals);
+      }
+      conn->statements.emplace(id, std::move(statement));
+      break;
+    }
+    case MessageType::Execute: {
+      auto it{ conn->statements.find(request.readU32()) };
+      if (it == conn->statements.end()) {
+        throw CommandException{ "No such prepared statement" };
+      }
+      const auto& statement{ it->second };
+      auto numParams{ request.readU32() };
+      if (numParams != statement.numLiterals) {
+        throw CommandException{ fmt::format(
+            "Statement takes {} parameters, got {}", statement.numLiterals,
+            numParams) };
+      }
+      std::vector<Value> params;
+      params.reserve(numParams);
+      for (size_t i{ 0 }; i < numParams; i++) {
+        params.push_back(request.readValue());
+      }
+      startResult(conn, conn->session.execute(statement.tokens, params),
+                  out);
+      break;
+    }
+    case MessageType::CloseStatement: {
+      conn->statements.erase(request.readU32());
+      {
+        MessageWriter complete{ out, MessageType::Complete };
+        complete.writeU64(0);
+        complete.writeU64(0);
+      }
+      break;
+    }
+    default:
+      throw ProtocolException{ fmt::format(
+          "Unexpected message type {}",
+          static_cast<unsigned>(request.getType())) };
+    }
+  } catch (const ProtocolException& e) {
+    writeError(ErrorCode::Protocol, e.what());
+    try {
+      send(conn, out);
+    } catch (const QueryCancelledException&) {
+      // closing already
+    }
+    std::lock_guard lock{ conn->mutex };
+    conn->closing = true;
+    return false;
+  } catch (const QueryCancelledException& e) {
+    {
+      std::lock_guard lock{ conn->mutex };
+      if (conn->closing) {
+        return false;
+      }
+    }
+    writeError(ErrorCode::Cancelled, e.what());
+  } catch (const std::exception& e) {
+    writeError(ErrorCode::Statement, e.what());
+  }
+  return true;
+}
+
+void Server::startResult(const Ref<Connection>& conn, Result result,
+                         std::string& out) {
+  // in row layout order, the result doesn't keep the order of the query
+  std::vector<std::pair<size_t, std::string_view>> columns;
+  for (const auto& [name, index] : result.getColumnMap()) {
+    columns.emplace_back(index, name);
+  }
+  std::ranges::sort(columns);
+
+  PendingResult pending;
+  if (!columns.empty()) {
+    MessageWriter header{ out, MessageType::Columns };
+    header.writeU32(columns.size());
+    for (auto [index, name] : columns) {
+      header.writeString(name);
+      pending.columns.push_back(index);
+    }
+  }
+  pending.result = std::move(result);
+  conn->result   = std::move(pending);
+}
+
+auto Server::writeRows(const Ref<Connection>& conn, std::string& out)
+    -> bool {
+  auto& pending{ *conn->result };
+  const auto& rows{ pending.result.getRows() };
+  std::vector<const Value*> column;
+  while (pending.nextRow < rows.size()) {
+    auto first{ pending.nextRow };
+    auto last{ std::min(rows.size(), first + m_Options.batchRows) };
+    {
+      MessageWriter batch{ out, MessageType::RowBatch };
+      batch.writeU32(last - first);
+      for (auto index : pending.columns) {
+        column.clear();
+        for (auto i{ first }; i < last; i++) {
+          column.push_back(&rows[i]->get(index));
+        }
+        batch.writeColumn(column);
+      }
+    }
+    pending.nextRow = last;
+    if (out.size() >= s_CoalesceSize && !send(conn, out)) {
+      return false;
+    }
+  }
+  MessageWriter complete{ out, MessageType::Complete };
+  complete.writeU64(pending.result.getNumAffectedRows());
+  complete.writeU64(rows.size());
+  conn->result.reset();
+  return true;
+}
+
+auto Server::send(const Ref<Connection>& conn, std::string& bytes)
+    -> bool {
+  std::lock_guard lock{ conn->mutex };
+  if (conn->closing) {
+    bytes.clear();
+    throw QueryCancelledException{
+      QueryCancelledException::Cause::Cancelled, "Connection closed"
+    };
+  }
+  // the loop is on it already otherwise
+  bool wasIdle{ conn->sent == conn->output.size() };
+  conn->output += bytes;
+  bytes.clear();
+  if (wasIdle) {
+    notify(conn);
+  }
+  return conn->output.size() - conn->sent < s_MaxPendingOutput;
+}
+
+} // namespace adun
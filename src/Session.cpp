@@ -0,0 +1,144 @@
+#include "adun/Session.hpp"
+#include "adun/Database.hpp"
+#include "adun/Parser/TransactionCommand.hpp"
+
+namespace adun {
+
+Session::Session(Database& db)
+    : m_Db{ db } {
+}
+
+auto Session::execute(const std::string& query) -> Result {
+  Lexer lexer;
+  QueryMetrics::Sample sample;
+  timeLexing(sample, [&] { lexer.lex(query); });
+  return executeTokens(lexer.getTokens(), sample);
+}
+
+auto Session::execute(const Ref<TokenList>& tokens,
+                      std::span<const Value> literals) -> Result {
+  QueryMetrics::Sample sample;
+  return executeTokens(tokens, sample, literals);
+}
+
+auto Session::executeScript(std::string_view script)
+    -> std::vector<Result> {
+  std::vector<Result> results;
+  Lexer lexer;
+  lexer.startScript(script);
+  while (true) {
+    QueryMetrics::Sample sample;
+    bool lexed{ false };
+    timeLexing(sample, [&] { lexed = lexer.lexNextStatement(); });
+    if (!lexed) {
+      break;
+    }
+    results.push_back(executeTokens(lexer.getTokens(), sample));
+  }
+  return results;
+}
+
+auto Session::inTransaction() const -> bool {
+  return m_Transaction.has_value();
+}
+
+void Session::cancel() {
+  m_Cancel.cancel();
+}
+
+void Session::setStatementTimeout(std::chrono::milliseconds timeout) {
+  m_StatementTimeout = timeout;
+}
+
+void Session::timeLexing(QueryMetrics::Sample& sample,
+                         const std::function<void()>& lex) {
+  auto start{ std::chrono::steady_clock::now() };
+  try {
+    lex();
+  } catch (...) {
+    sample.lexTime = std::chrono::steady_clock::now() - start;
+    sample.failed  = true;
+    m_Db.m_Metrics.record(sample);
+    throw;
+  }
+  sample.lexTime = std::chrono::steady_clock::now() - start;
+}
+
+auto Session::executeTokens(const Ref<TokenList>& tokens,
+                            QueryMetrics::Sample& sample,
+                            std::span<const Value> literals) -> Result {
+  auto timeout{ m_StatementTimeout.value_or(
+      m_Db.getStatementTimeout()) };
+  m_Cancel.reset(timeout.count() > 0
+                     ? CancellationToken::Clock::now() + timeout
+                     : CancellationToken::Clock::time_point::max());
+  auto run{ [this, &tokens, literals](ast::Command& command) {
+    // not every statement reaches a check on its own
+    m_Cancel.check();
+    switch (command.getKind()) {
+    case ast::NodeKind::TransactionCommand:
+      return controlTransaction(command);
+    case ast::NodeKind::CreateCommand:
+      // tables are never dropped, so creation can't be undone
+      if (m_Transaction) {
+        throw CommandException{
+          "CREATE TABLE is not allowed inside a transaction"
+        };
+      }
+      break;
+    default:
+      break;
+    }
+
+    if (m_Transaction) {
+      return m_Db.executeCommand(command, *tokens, *m_Transaction,
+                                 literals);
+    }
+    Transaction txn{ m_Db };
+    txn.setCancellation(&m_Cancel);
+    auto result{ m_Db.executeCommand(command, *tokens, txn, literals) };
+    txn.commit();
+    return result;
+  } };
+  try {
+    return m_Db.runCommand(tokens, run, &sample, literals);
+  } catch (const QueryCancelledException& e) {
+    // a cancel arriving while a timed-out statement unwinds is for the
+    // next one
+    if (e.getCause() == QueryCancelledException::Cause::Cancelled) {
+      m_Cancel.clear();
+    }
+    throw;
+  }
+}
+
+auto Session::controlTransaction(const ast::Command& command) -> Result {
+  auto action{
+    static_cast<const ast::TransactionCommand&>(command).getAction()
+  };
+  if (action == ast::TransactionCommand::Action::Begin) {
+    if (m_Transaction) {
+      throw CommandException{ "Transaction is already in progress" };
+    }
+    m_Transaction.emplace(m_Db);
+    m_Transaction->setCancellation(&m_Cancel);
+    return Result{};
+  }
+
+  if (!m_Transaction) {
+    throw CommandException{ "No transaction in progress" };
+  }
+  if (action == ast::TransactionCommand::Action::Commit) {
+    try {
+      m_Transaction->commit();
+    } catch (...) {
+      // rolled back, its locks must not outlive the failed commit
+      m_Transaction.reset();
+      throw;
+    }
+  }
+  m_Transaction.reset();
+  return Result{};
+}
+
+} // namespace adun
@@ -0,0 +1,126 @@
+#include "adun/SlowQueryLog.hpp"
+#include "adun/Exceptions.hpp"
+#include <filesystem>
+#include <fmt/chrono.h>
+#include <fmt/format.h>
+
+namespace adun {
+
+namespace {
+
+auto toMs(std::chrono::nanoseconds value) -> double {
+  return std::chrono::duration<double, std::milli>(value).count();
+}
+
+} // namespace
+
+auto SlowQueryLog::Entry::getTotalTime() const
+    -> std::chrono::nanoseconds {
+  return sample.lexTime + sample.parseTime + sample.executeTime;
+}
+
+auto SlowQueryLog::Entry::toString() const -> std::string {
+  auto seconds{ std::chrono::floor<std::chrono::seconds>(time) };
+  auto millis{ std::chrono::duration_cast<std::chrono::milliseconds>(
+      time - seconds) };
+  auto out{ fmt::format(
+      "# {:%FT%T}.{:03}Z {} {:.3f} ms (lex {:.3f}, parse {:.3f}, execute "
+      "{:.3f}) rows scanned {}, returned {}, affected {}{}\n{}\n",
+      fmt::gmtime(std::chrono::system_clock::to_time_t(seconds)),
+      millis.count(), QueryMetrics::getCommandName(sample.kind),
+      toMs(getTotalTime()), toMs(sample.lexTime), toMs(sample.parseTime),
+      toMs(sample.executeTime), sample.rowsScanned, sample.rowsReturned,
+      sample.rowsAffected, sample.failed ? ", failed" : "", query) };
+  for (const auto& line : plan) {
+    out += fmt::format("  {}\n", line);
+  }
+  if (sample.executeEvents.available != 0) {
+    out += fmt::format("  Hardware Counters: {}\n",
+                       sample.executeEvents.toString());
+  }
+  if (!stacktrace.empty()) {
+    out += "  Stacktrace:\n";
+    size_t begin{ 0 };
+    while (begin < stacktrace.size()) {
+      auto end{ std::min(stacktrace.find('\n', begin),
+                          stacktrace.size()) };
+      out += fmt::format("    {}\n", std::string_view{ stacktrace }.substr(
+                                        begin, end - begin));
+      begin = end + 1;
+    }
+  }
+  return out;
+}
+
+SlowQueryLog::SlowQueryLog(Options options)
+    : m_Options{ std::move(options) } {
+  m_Entries.reserve(m_Options.capacity);
+  if (!m_Options.path.empty()) {
+    openFile();
+  }
+}
+
+auto SlowQueryLog::getOptions() const -> const Options& {
+  return m_Options;
+}
+
+void SlowQueryLog::record(Entry entry) {
+  std::lock_guard lock{ m_Mutex };
+  auto text{ m_File.is_open() ? entry.toString() : std::string{} };
+  if (m_Options.capacity > 0) {
+    if (m_Entries.size() < m_Options.capacity) {
+      m_Entries.push_back(std::move(entry));
+    } else {
+      m_Entries[m_NextEntry] = std::move(entry);
+    }
+    m_NextEntry = (m_NextEntry + 1) % m_Options.capacity;
+  }
+
+  if (m_File.is_open()) {
+    if (m_FileSize > 0 &&
+        m_FileSize + text.size() > m_Options.maxFileSize) {
+      m_File.close();
+      std::error_code error;
+      std::filesystem::rename(m_Options.path, m_Options.path + ".1",
+                              error);
+      if (error) {
+        throw FileException{ fmt::format("Cannot rotate '{}': {}",
+                                         m_Options.path,
+                                         error.message()) };
+      }
+      openFile();
+    }
+    m_File << text << std::flush;
+    if (!m_File) {
+      throw FileException{ fmt::format("Cannot write '{}'",
+                                       m_Options.path) };
+    }
+    m_FileSize += text.size();
+  }
+}
+
+auto SlowQueryLog::getEntries() const -> std::vector<Entry> {
+  std::lock_guard lock{ m_Mutex };
+  if (m_Entries.size() < m_Options.capacity) {
+    return m_Entries;
+  }
+  std::vector<Entry> entries;
+  entries.reserve(m_Entries.size());
+  for (size_t i{ 0 }; i < m_Entries.size(); i++) {
+    entries.push_back(m_Entries[(m_NextEntry + i) % m_Entries.size()]);
+  }
+  return entries;
+}
+
+void SlowQueryLog::openFile() {
+  m_File.open(m_Options.path, std::ios::binary | std::ios::app);
+  if (!m_File) {
+    throw FileException{ fmt::format("Cannot open '{}'",
+                                     m_Options.path) };
+  }
+  std::error_code error;
+  auto size{ std::filesystem::file_size(m_Options.path, error) };
+  m_FileSize = error ? 0 : static_cast<size_t>(size);
+}
+
+} // namespace adun
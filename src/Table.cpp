@@ -2,24 +2,141 @@
 #include "adun/Assert.hpp"
 #include "adun/Exceptions.hpp"
 #include "adun/Result.hpp"
+#include "adun/Tracer.hpp"
+#include <algorithm>
 #include <fmt/format.h>
 #include <ranges>
+#include <unordered_set>
 
 namespace adun {
 
+namespace {
+
+/// Visits the first count versions of store a block at a time, checking
+/// cancel, if set, before each block
+template <typename F>
+void scanVersions(const VersionStore& store, size_t count,
+                  const CancellationToken* cancel, F&& f) {
+  if (cancel == nullptr) {
+    store.forEach(count, f);
+    return;
+  }
+  for (size_t first{ 0 }; first < count;
+       first += CancellationToken::s_CheckInterval) {
+    cancel->check();
+    store.forEachIn(
+        first, std::min(count, first + CancellationToken::s_CheckInterval),
+        f);
+  }
+}
+
+} // namespace
+
 InvalidRowException::InvalidRowException(const std::string& msg)
     : TableException{ msg } {
 }
 
-Table::Table(std::string name, Scheme scheme)
+Table::PendingWrite::PendingWrite(Table& table)
+    : m_Table{ table },
+      m_Store{ table.loadStore() },
+      m_Ts{ m_Store->getCommitTs() + 1 },
+      m_Initial{ getSavepoint() } {
+}
+
+Table::PendingWrite::~PendingWrite() {
+  if (!m_Committed) {
+    rollbackTo(m_Initial);
+  }
+}
+
+auto Table::PendingWrite::getSavepoint() const -> Savepoint {
+  return { m_Store->getSize(), m_Ended.size(), m_Table.m_Counters };
+}
+
+void Table::PendingWrite::rollbackTo(const Savepoint& savepoint) {
+  // ends first, as a version appended since may have been ended too
+  for (auto i{ savepoint.numEnded }; i < m_Ended.size(); i++) {
+    m_Ended[i]->end.store(RowVersion::s_Infinity,
+                          std::memory_order_release);
+    m_Table.indexRow(m_Ended[i]->row);
+  }
+  m_Ended.resize(savepoint.numEnded);
+
+  for (auto i{ savepoint.storeSize }; i < m_Store->getSize(); i++) {
+    auto& version{ (*m_Store)[i] };
+    // skips ones reverted by an earlier rollback
+    if (version.end.load(std::memory_order_relaxed) != version.begin) {
+      version.end.store(version.begin, std::memory_order_release);
+      m_Store->numDead++;
+      m_Table.unindexRow(version.row);
+    }
+  }
+  m_Table.m_Counters = savepoint.counters;
+}
+
+auto Table::PendingWrite::getSnapshot() const -> Snapshot {
+  return { m_Store, m_Ts, m_Store->getSize(), m_Cancel };
+}
+
+void Table::PendingWrite::setQueryMemory(MemoryTracker* memory) {
+  m_QueryMemory = memory;
+}
+
+void Table::PendingWrite::setCancellation(
+    const CancellationToken* cancel) {
+  m_Cancel = cancel;
+}
+
+void Table::PendingWrite::commit() {
+  m_Store->setCommitTs(m_Ts);
+  m_Store->numDead += m_Ended.size();
+  m_Committed = true;
+  m_Table.collectGarbage();
+}
+
+void Table::PendingWrite::reserve(size_t numRows, size_t valuesSize,
+                                  size_t heapSize) {
+  auto size{ m_Store->getSize() };
+  auto slotsSize{ (VersionStore::getCapacity(size + numRows) -
+                   VersionStore::getCapacity(size)) *
+                  sizeof(RowVersion) };
+  auto& memory{ *m_Table.m_Memory };
+  memory.total.reserve(slotsSize + valuesSize + heapSize);
+  memory.rows.fetch_add(slotsSize + valuesSize, std::memory_order_relaxed);
+  memory.strings.fetch_add(heapSize, std::memory_order_relaxed);
+  if (m_QueryMemory != nullptr) {
+    m_QueryMemory->charge(slotsSize + valuesSize + heapSize);
+  }
+}
+
+void Table::PendingWrite::append(Row row) {
+  m_Table.indexRow(m_Store->append(std::move(row), m_Ts).row);
+}
+
+void Table::PendingWrite::end(RowVersion& version) {
+  version.end.store(m_Ts, std::memory_order_release);
+  m_Ended.push_back(&version);
+  m_Table.unindexRow(version.row);
+}
+
+Table::Table(std::string name, Scheme scheme, MemoryTracker* memory)
     : m_Name{ std::move(name) },
-      m_Header{ std::move(scheme) } {
+      m_Header{ std::move(scheme) },
+      m_Counters(m_Header.size()),
+      m_Memory{ makeUnique<Memory>(memory) } {
   int i{ 0 };
   for (auto&& [colName, column] : m_Header) {
     adun_assert(!column.sampleValue.isEmpty(),
                 "Invalid column in scheme");
 
     column.index = i;
+    m_ColumnMap[colName] = i;
+    if (column.modifiers & Column::Modifier::AutoIncrement) {
+      m_Counters[i] = column.sampleValue.get<int32_t>();
+    }
+    if (column.modifiers & Column::Modifier::Unique) {
+      m_UniqueIndexes.push_back({ column.index, colName, {} });
+    }
     i++;
   }
 };
@@ -32,121 +149,420 @@ auto Table::getScheme() const -> const Scheme& {
   return m_Header;
 }
 
+auto Table::loadStore() const -> Ref<VersionStore> {
+  std::lock_guard lock{ m_Versions->storeMutex };
+  return m_Versions->store;
+}
+
+auto Table::takeSnapshot() const -> Snapshot {
+  // commit timestamp is published after the versions it covers
+  auto store{ loadStore() };
+  auto ts{ store->getCommitTs() };
+  auto size{ store->getSize() };
+  return { std::move(store), ts, size };
+}
+
 auto Table::selectRows(const Selector& filter,
-                       const std::vector<std::string>& columns)
+                       const std::vector<std::string>& columns) const
     -> Result {
-  std::vector<RowRefWrapper> rows;
-  for (auto&& row : m_Rows) {
-    if (filter(row)) {
-      rows.emplace_back(row);
-    }
-  }
+  return selectRows(filter, columns, takeSnapshot());
+}
+
+auto Table::selectRows(const Selector& filter,
+                       const std::vector<std::string>& columns,
+                       const Snapshot& snapshot) const -> Result {
+  TraceSpan span{ "scan", "table" };
   ColumnNameIndexMap columnMap;
   for (auto&& columnName : columns) {
-    if (!m_Header.contains(columnName)) {
+    auto it{ m_Header.find(columnName) };
+    if (it == m_Header.end()) {
       throw NoSuchColumnException(columnName);
     }
-    columnMap[columnName] = m_Header.at(columnName).index;
+    columnMap[columnName] = it->second.index;
   }
-  return Result{ std::move(rows), std::move(columnMap), rows.size() };
+
+  std::vector<const Row*> rows;
+  scanVersions(*snapshot.store, snapshot.size, snapshot.cancel,
+               [&](const RowVersion& version) {
+                 if (version.isVisibleAt(snapshot.ts) &&
+                     filter(version.row)) {
+                   rows.push_back(&version.row);
+                 }
+               });
+  auto numRows{ rows.size() };
+  span.addArg("versions", static_cast<int64_t>(snapshot.size));
+  span.addArg("rows", static_cast<int64_t>(numRows));
+  return Result{ std::move(rows), std::move(columnMap), numRows,
+                 snapshot.store };
 }
 
-void Table::traverseRows(const Selector& filter,
-                         const std::function<void(Row&)>& callback) {
-  for (auto&& row : m_Rows) {
-    if (filter(row)) {
-      callback(row);
-    }
+void Table::scanRows(
+    const Selector& filter,
+    const std::function<void(const Row&)>& callback) const {
+  scanRows(filter, callback, takeSnapshot());
+}
+
+void Table::scanRows(const Selector& filter,
+                     const std::function<void(const Row&)>& callback,
+                     const Snapshot& snapshot) const {
+  TraceSpan span{ "scan", "table" };
+  span.addArg("versions", static_cast<int64_t>(snapshot.size));
+  scanVersions(*snapshot.store, snapshot.size, snapshot.cancel,
+               [&](const RowVersion& version) {
+                 if (version.isVisibleAt(snapshot.ts) &&
+                     filter(version.row)) {
+                   callback(version.row);
+                 }
+               });
+}
+
+auto Table::updateRows(const Selector& filter,
+                       const std::function<void(Row&)>& update)
+    -> size_t {
+  PendingWrite write{ *this };
+  auto affectedRows{ updateRows(filter, update, write) };
+  write.commit();
+  return affectedRows;
+}
+
+auto Table::updateRows(const Selector& filter,
+                       const std::function<void(Row&)>& update,
+                       PendingWrite& write) -> size_t {
+  TraceSpan span{ "update", "table" };
+  auto& store{ *write.m_Store };
+  // the call is atomic within a larger write too
+  auto savepoint{ write.getSavepoint() };
+
+  size_t affectedRows{ 0 };
+  try {
+    // appended versions are past the initial size, so each row is
+    // visited once
+    auto updateVersion{ [&](RowVersion& version) {
+      if (!version.isLive() || !filter(version.row)) {
+        return;
+      }
+      Row updated{ version.row };
+      update(updated);
+      write.reserve(1, updated.getValuesSize(), updated.getHeapSize());
+      write.end(version);
+      write.append(std::move(updated));
+      affectedRows++;
+    } };
+    scanVersions(store, store.getSize(), write.m_Cancel, updateVersion);
+
+    checkUniqueAppended(store, savepoint.storeSize);
+  } catch (...) {
+    write.rollbackTo(savepoint);
+    throw;
   }
+  span.addArg("rows", static_cast<int64_t>(affectedRows));
+  return affectedRows;
 }
 
 auto Table::deleteRows(const Selector& filter) -> size_t {
+  PendingWrite write{ *this };
+  auto affectedRows{ deleteRows(filter, write) };
+  write.commit();
+  return affectedRows;
+}
+
+auto Table::deleteRows(const Selector& filter, PendingWrite& write)
+    -> size_t {
+  TraceSpan span{ "delete", "table" };
+  auto& store{ *write.m_Store };
+  auto savepoint{ write.getSavepoint() };
+
   size_t affectedRows{ 0 };
-  for (auto it{ m_Rows.begin() }; it != m_Rows.end();) {
-    if (filter(*it)) {
-      it = m_Rows.erase(it);
-      affectedRows++;
-    } else {
-      ++it;
-    }
+  try {
+    auto deleteVersion{ [&](RowVersion& version) {
+      if (version.isLive() && filter(version.row)) {
+        write.end(version);
+        affectedRows++;
+      }
+    } };
+    scanVersions(store, store.getSize(), write.m_Cancel, deleteVersion);
+  } catch (...) {
+    write.rollbackTo(savepoint);
+    throw;
   }
+  span.addArg("rows", static_cast<int64_t>(affectedRows));
   return affectedRows;
 }
 
-void Table::addRow(
-    const std::vector<std::pair<std::string, Value>>& assignments) {
-  std::vector<Value> values;
-  values.resize(m_Header.size());
-  for (auto& [name, col] : m_Header) {
-    if (col.modifiers & Column::Modifier::HasDefault) {
-      values[col.index] = col.sampleValue;
+void Table::addRow(const Assignments& assignments) {
+  addRows({ assignments });
+}
+
+void Table::addRows(const std::vector<Assignments>& rows) {
+  PendingWrite write{ *this };
+  addRows(rows, write);
+  write.commit();
+}
+
+void Table::addRows(const std::vector<Assignments>& rows,
+                    PendingWrite& write) {
+  insertRows(prepareRows(rows), write);
+}
+
+void Table::appendRows(std::vector<std::vector<Value>> rows) {
+  PendingWrite write{ *this };
+  appendRows(std::move(rows), write);
+  write.commit();
+}
+
+void Table::appendRows(std::vector<std::vector<Value>> rows,
+                       PendingWrite& write) {
+  insertRows(prepareRows(std::move(rows)), write);
+}
+
+auto Table::prepareRows(const std::vector<Assignments>& rows) const
+    -> PreparedRows {
+  std::vector<std::vector<Value>> values;
+  values.reserve(rows.size());
+
+  // rows of a batch usually list the same columns, resolve them once
+  const Assignments* resolvedFor{ nullptr };
+  std::vector<size_t> indices;
+  auto sameColumns{ [](const Assignments& a, const Assignments& b) {
+    return std::ranges::equal(a, b, {}, &Assignments::value_type::first,
+                              &Assignments::value_type::first);
+  } };
+
+  for (const auto& assignments : rows) {
+    if (resolvedFor == nullptr ||
+        !sameColumns(*resolvedFor, assignments)) {
+      indices.clear();
+      for (const auto& [name, _] : assignments) {
+        auto it{ m_Header.find(name) };
+        if (it == m_Header.end()) {
+          throw NoSuchColumnException(name);
+        }
+        indices.push_back(it->second.index);
+      }
+      resolvedFor = &assignments;
     }
 
-    if (col.modifiers & Column::Modifier::AutoIncrement) {
-      adun_assert(col.getType() == ValueType::Integer,
-                  "Autoincrement on non integer column");
-      col.sampleValue.set(col.sampleValue.get<int32_t>() + 1);
-      values[col.index] = col.sampleValue.get<int32_t>();
+    auto& rowValues{ values.emplace_back(m_Header.size()) };
+    for (size_t i{ 0 }; i < assignments.size(); i++) {
+      const auto& val{ assignments[i].second };
+      // empty values mean "not assigned" to the layout overload
+      if (val.isEmpty()) {
+        throw InvalidRowException(fmt::format(
+            "Invalid value type for value {}, expected {}",
+            assignments[i].first,
+            Value::typeToString(
+                m_Header.at(assignments[i].first).getType())));
+      }
+      rowValues[indices[i]] = val;
     }
   }
-  for (const auto& [name, val] : assignments) {
-    if (!m_Header.contains(name)) {
-      throw NoSuchColumnException(name);
-    }
-    auto column{ m_Header.at(name) };
 
-    if (val.getType() != column.getType()) {
-      throw InvalidRowException(fmt::format(
-          "Invalid value type for value {}, expected {}", val.toString(),
-          Value::typeToString(column.getType())));
+  return prepareRows(std::move(values));
+}
+
+auto Table::prepareRows(std::vector<std::vector<Value>> rows) const
+    -> PreparedRows {
+  std::vector<const Column*> columns(m_Header.size());
+  std::vector<std::string_view> names(m_Header.size());
+  for (const auto& [name, col] : m_Header) {
+    columns[col.index] = &col;
+    names[col.index]   = name;
+  }
+
+  PreparedRows prepared;
+  prepared.rows.reserve(rows.size());
+  for (auto& values : rows) {
+    adun_assert(values.size() == columns.size(), "Invalid row layout");
+    for (size_t i{ 0 }; i < columns.size(); i++) {
+      const auto& column{ *columns[i] };
+      auto& val{ values[i] };
+
+      if (column.modifiers & Column::Modifier::AutoIncrement) {
+        if (!val.isEmpty()) {
+          throw InvalidRowException(fmt::format(
+              "Auto increment column {} should not be assigned",
+              names[i]));
+        }
+        continue;
+      }
+
+      if (val.isEmpty()) {
+        if (!(column.modifiers & Column::Modifier::HasDefault)) {
+          throw InvalidRowException(
+              fmt::format("Column {} missing value", names[i]));
+        }
+        val = column.sampleValue;
+        continue;
+      }
+
+      if (val.getType() != column.getType()) {
+        throw InvalidRowException(fmt::format(
+            "Invalid value type for value {}, expected {}",
+            val.toString(), Value::typeToString(column.getType())));
+      }
     }
+    prepared.rows.emplace_back(std::move(values));
+  }
+  return prepared;
+}
 
-    // auto-increment
+void Table::insertRows(PreparedRows prepared, PendingWrite& write) {
+  TraceSpan span{ "insert", "table" };
+  auto& batch{ prepared.rows };
+  span.addArg("rows", static_cast<int64_t>(batch.size()));
+  // counters are committed only if the whole batch is valid
+  auto counters{ m_Counters };
+  for (const auto& [name, column] : m_Header) {
     if (column.modifiers & Column::Modifier::AutoIncrement) {
-      throw InvalidRowException(fmt::format(
-          "Auto increment column {} should not be assigned", name));
+      for (auto& row : batch) {
+        row.get(column.index) = ++counters[column.index];
+      }
     }
-
-    values[column.index] = val;
   }
 
-  if (std::ranges::find_if(values, [](const auto& val) {
-        return val.isEmpty();
-      }) != values.end()) {
-    /// @todo get name of missing column
-    throw InvalidRowException(fmt::format("Column missing values"));
+  checkUnique(batch);
+
+  size_t valuesSize{ 0 };
+  size_t heapSize{ 0 };
+  for (const auto& row : batch) {
+    valuesSize += row.getValuesSize();
+    heapSize += row.getHeapSize();
   }
+  write.reserve(batch.size(), valuesSize, heapSize);
+  for (auto& row : batch) {
+    write.append(std::move(row));
+  }
+  m_Counters = std::move(counters);
+}
 
-  m_Rows.emplace_back(values);
-  checkConstraintsAgainst(m_Rows.back());
+auto Table::getColumnNames() const -> std::vector<std::string> {
+  std::vector<std::string> names(m_Header.size());
+  for (const auto& [name, column] : m_Header) {
+    names[column.index] = name;
+  }
+  return names;
 }
 
 auto Table::getColumnMap() const -> const ColumnNameIndexMap& {
-  if (m_ColumnMap.empty()) {
-    for (auto&& [columnName, column] : m_Header) {
-      m_ColumnMap[columnName] = column.index;
+  return m_ColumnMap;
+}
+
+auto Table::getNumVersions() const -> size_t {
+  return loadStore()->getSize();
+}
+
+auto Table::getNumUniqueColumns() const -> size_t {
+  return m_UniqueIndexes.size();
+}
+
+auto Table::getMemoryUsage() const -> MemoryUsage {
+  return { m_Memory->rows.load(std::memory_order_relaxed),
+           m_Memory->strings.load(std::memory_order_relaxed),
+           m_Memory->indexes.load(std::memory_order_relaxed) };
+}
+
+auto Table::PreparedRows::getMemoryUsage() const -> size_t {
+  size_t size{ 0 };
+  for (const auto& row : rows) {
+    size += row.getValuesSize() + row.getHeapSize();
+  }
+  return size;
+}
+
+auto Table::getMutex() const -> std::timed_mutex& {
+  return m_Versions->writeMutex;
+}
+
+void Table::indexRow(const Row& row) {
+  for (auto& index : m_UniqueIndexes) {
+    const auto& val{ row.get(index.column) };
+    auto [it, inserted]{ index.counts.try_emplace(val, 0) };
+    it->second++;
+    // can't fail, the row is in the store already
+    if (inserted) {
+      auto size{ s_IndexEntrySize + it->first.getHeapSize() };
+      m_Memory->indexes.fetch_add(size, std::memory_order_relaxed);
+      m_Memory->total.charge(size);
     }
   }
-  return m_ColumnMap;
 }
 
-void Table::checkConstraintsAgainst(const Row& row) const {
-  for (auto&& [columnName, column] : m_Header) {
-    if (column.modifiers & Column::Modifier::Unique &&
-        std::ranges::find_if(m_Rows, [index = column.index,
-                                      val   = row.get(column.index),
-                                      &row](const auto& otherRow) {
-          // hacky, but i'm lazy to implement Key
-          // comlumn modifier
-          if (&row == &otherRow) {
-            return false;
-          }
-          return otherRow.get(index) == val;
-        }) != m_Rows.end()) {
-      throw InvalidRowException(
-          fmt::format("Value {} is not unique", columnName));
+void Table::unindexRow(const Row& row) {
+  for (auto& index : m_UniqueIndexes) {
+    auto it{ index.counts.find(row.get(index.column)) };
+    adun_assert(it != index.counts.end(), "Unindexed live row");
+    if (--it->second == 0) {
+      auto size{ s_IndexEntrySize + it->first.getHeapSize() };
+      m_Memory->indexes.fetch_sub(size, std::memory_order_relaxed);
+      m_Memory->total.release(size);
+      index.counts.erase(it);
     }
   }
 }
 
+void Table::checkUnique(const std::vector<Row>& batch) const {
+  TraceSpan span{ "unique check", "constraint" };
+  for (const auto& index : m_UniqueIndexes) {
+    std::unordered_set<Value> batchValues;
+    for (const auto& row : batch) {
+      const auto& val{ row.get(index.column) };
+      if (index.counts.contains(val) ||
+          (batch.size() > 1 && !batchValues.insert(val).second)) {
+        throw InvalidRowException(
+            fmt::format("Value {} is not unique", index.name));
+      }
+    }
+  }
+}
+
+void Table::checkUniqueAppended(const VersionStore& store,
+                                size_t first) const {
+  TraceSpan span{ "unique check", "constraint" };
+  for (const auto& index : m_UniqueIndexes) {
+    for (auto i{ first }; i < store.getSize(); i++) {
+      const auto& version{ store[i] };
+      if (version.isLive() &&
+          index.counts.at(version.row.get(index.column)) > 1) {
+        throw InvalidRowException(
+            fmt::format("Value {} is not unique", index.name));
+      }
+    }
+  }
+}
+
+void Table::collectGarbage() {
+  auto store{ loadStore() };
+  auto size{ store->getSize() };
+  if (store->numDead < s_MinGarbage || store->numDead * 2 < size) {
+    return;
+  }
+
+  // readers of the old store keep it until they are done
+  auto compacted{ makeRef<VersionStore>() };
+  size_t valuesSize{ 0 };
+  size_t heapSize{ 0 };
+  store->forEach(size, [&](const RowVersion& version) {
+    if (version.isLive()) {
+      const auto& row{ compacted->append(version.row, version.begin).row };
+      valuesSize += row.getValuesSize();
+      heapSize += row.getHeapSize();
+    }
+  });
+  compacted->setCommitTs(store->getCommitTs());
+  auto rowsSize{ VersionStore::getCapacity(compacted->getSize()) *
+                     sizeof(RowVersion) +
+                 valuesSize };
+  {
+    std::lock_guard lock{ m_Versions->storeMutex };
+    m_Versions->store = std::move(compacted);
+  }
+
+  // accounts for the old store as freed, though a reader may hold it
+  // a while longer
+  auto& memory{ *m_Memory };
+  memory.total.release(memory.rows.exchange(rowsSize) +
+                       memory.strings.exchange(heapSize));
+  memory.total.charge(rowsSize + heapSize);
+}
+
 } // namespace adun
@@ -0,0 +1,58 @@
+#include "adun/ThreadPool.hpp"
+#include "adun/Tracer.hpp"
+#include <algorithm>
+#include <fmt/format.h>
+
+namespace adun {
+
+ThreadPool::ThreadPool(size_t numThreads) {
+  if (numThreads == 0) {
+    numThreads = std::max(1U, std::thread::hardware_concurrency());
+  }
+  m_Workers.reserve(numThreads);
+  for (size_t i{ 0 }; i < numThreads; i++) {
+    m_Workers.emplace_back([this, i](const std::stop_token& stop) {
+      Tracer::setThreadName(fmt::format("adun worker {}", i));
+      workerLoop(stop);
+    });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  for (auto& worker : m_Workers) {
+    worker.request_stop();
+  }
+  m_Workers.clear();
+}
+
+auto ThreadPool::getNumThreads() const -> size_t {
+  return m_Workers.size();
+}
+
+void ThreadPool::post(std::function<void()> task) {
+  {
+    std::lock_guard lock{ m_Mutex };
+    m_Tasks.push(std::move(task));
+  }
+  m_TaskAvailable.notify_one();
+}
+
+void ThreadPool::workerLoop(const std::stop_token& stop) {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock lock{ m_Mutex };
+      // returns with an empty queue only once stop is requested
+      m_TaskAvailable.wait(lock, stop,
+                           [this] { return !m_Tasks.empty(); });
+      if (m_Tasks.empty()) {
+        return;
+      }
+      task = std::move(m_Tasks.front());
+      m_Tasks.pop();
+    }
+    task();
+  }
+}
+
+} // namespace adun
@@ -0,0 +1,180 @@
+#include "adun/Tracer.hpp"
+#include "adun/Parser/Utils.hpp"
+#include <atomic>
+#include <chrono>
+#include <fmt/format.h>
+#include <mutex>
+#include <vector>
+
+namespace adun {
+
+namespace {
+
+struct Event {
+  const char* name;
+  const char* category;
+  int64_t startNs;
+  int64_t durationNs;
+  std::array<std::pair<const char*, int64_t>, TraceSpan::s_MaxArgs> args;
+  size_t numArgs;
+};
+
+/// Locked by its thread per span, uncontended unless exporting
+struct ThreadBuffer {
+  std::mutex mutex;
+  uint32_t tid;
+  std::string name;
+  std::vector<Event> events;
+};
+
+/// Buffers outlive their threads, so spans of finished workers are
+/// exported too
+struct Registry {
+  std::atomic<bool> enabled{ false };
+  std::chrono::steady_clock::time_point epoch{
+    std::chrono::steady_clock::now()
+  };
+  std::mutex mutex;
+  std::vector<Ref<ThreadBuffer>> buffers;
+};
+
+auto getRegistry() -> Registry& {
+  static Registry s_Registry;
+  return s_Registry;
+}
+
+auto getThreadBuffer() -> ThreadBuffer& {
+  thread_local Ref<ThreadBuffer> t_Buffer{ [] {
+    auto& registry{ getRegistry() };
+    auto buffer{ makeRef<ThreadBuffer>() };
+    std::lock_guard lock{ registry.mutex };
+    buffer->tid = static_cast<uint32_t>(registry.buffers.size() + 1);
+    registry.buffers.push_back(buffer);
+    return buffer;
+  }() };
+  return *t_Buffer;
+}
+
+auto getNowNs() -> int64_t {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - getRegistry().epoch)
+      .count();
+}
+
+/// Only thread names are not literals of ours
+auto escapeJson(std::string_view text) -> std::string {
+  std::string out;
+  for (auto c : text) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      out += fmt::format("\\u{:04x}", static_cast<unsigned>(c));
+    } else {
+      out += c;
+    }
+  }
+  return out;
+}
+
+} // namespace
+
+void Tracer::start() {
+  getRegistry().enabled.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::stop() {
+  getRegistry().enabled.store(false, std::memory_order_relaxed);
+}
+
+auto Tracer::isEnabled() -> bool {
+  return getRegistry().enabled.load(std::memory_order_relaxed);
+}
+
+void Tracer::setThreadName(std::string name) {
+  auto& buffer{ getThreadBuffer() };
+  std::lock_guard lock{ buffer.mutex };
+  buffer.name = std::move(name);
+}
+
+auto Tracer::exportJson() -> std::string {
+  auto& registry{ getRegistry() };
+  std::vector<Ref<ThreadBuffer>> buffers;
+  {
+    std::lock_guard lock{ registry.mutex };
+    buffers = registry.buffers;
+  }
+
+  std::string out{ R"({"displayTimeUnit":"ms","traceEvents":[)" };
+  bool first{ true };
+  auto separate{ [&] {
+    if (!first) {
+      out += ',';
+    }
+    first = false;
+  } };
+  for (const auto& buffer : buffers) {
+    std::lock_guard lock{ buffer->mutex };
+    if (!buffer->name.empty()) {
+      separate();
+      out += fmt::format(R"({{"name":"thread_name","ph":"M","pid":1,)"
+                         R"("tid":{},"args":{{"name":"{}"}}}})",
+                         buffer->tid, escapeJson(buffer->name));
+    }
+    for (const auto& event : buffer->events) {
+      separate();
+      // microseconds, as the format wants them
+      out += fmt::format(
+          R"({{"name":"{}","cat":"{}","ph":"X","pid":1,"tid":{},)"
+          R"("ts":{:.3f},"dur":{:.3f},"args":{{)",
+          event.name, event.category, buffer->tid,
+          static_cast<double>(event.startNs) / 1e3,
+          static_cast<double>(event.durationNs) / 1e3);
+      for (size_t i{ 0 }; i < event.numArgs; i++) {
+        out += fmt::format(R"({}"{}":{})", i == 0 ? "" : ",",
+                           event.args[i].first, event.args[i].second);
+      }
+      out += "}}";
+    }
+  }
+  return out + "]}";
+}
+
+void Tracer::clear() {
+  auto& registry{ getRegistry() };
+  std::lock_guard lock{ registry.mutex };
+  for (const auto& buffer : registry.buffers) {
+    std::lock_guard bufferLock{ buffer->mutex };
+    buffer->events.clear();
+  }
+}
+
+TraceSpan::TraceSpan(const char* name, const char* category)
+    : m_Name{ name },
+      m_Category{ category } {
+  if (Tracer::isEnabled()) {
+    m_StartNs = getNowNs();
+  }
+}
+
+TraceSpan::~TraceSpan() {
+  if (m_StartNs < 0) {
+    return;
+  }
+  auto endNs{ getNowNs() };
+  Event event{ m_Name, m_Category, m_StartNs, endNs - m_StartNs,
+               m_Args, m_NumArgs };
+  auto& buffer{ getThreadBuffer() };
+  std::lock_guard lock{ buffer.mutex };
+  if (buffer.events.size() < Tracer::s_MaxEventsPerThread) {
+    buffer.events.push_back(event);
+  }
+}
+
+void TraceSpan::addArg(const char* key, int64_t value) {
+  if (m_StartNs >= 0 && m_NumArgs < s_MaxArgs) {
+    m_Args[m_NumArgs++] = { key, value };
+  }
+}
+
+} // namespace adun
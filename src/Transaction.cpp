@@ -0,0 +1,140 @@
+#include "adun/Transaction.hpp"
+#include "adun/Database.hpp"
+#include "adun/Tracer.hpp"
+#include <algorithm>
+#include <fmt/format.h>
+
+namespace adun {
+
+Transaction::Transaction(Database& db)
+    : m_Db{ db } {
+}
+
+Transaction::~Transaction() {
+  rollback();
+}
+
+auto Transaction::read(const std::string& tableName) -> ReadView {
+  const Table* table{ nullptr };
+  {
+    std::shared_lock catalogLock{ m_Db.m_CatalogMutex };
+    table = &m_Db.findTable(tableName);
+  }
+  for (auto& tableWrite : m_Writes) {
+    if (tableWrite.table == table) {
+      return { *table, tableWrite.write->getSnapshot() };
+    }
+  }
+  auto snapshot{ table->takeSnapshot() };
+  snapshot.cancel = m_Cancel;
+  return { *table, std::move(snapshot) };
+}
+
+auto Transaction::write(const std::string& tableName) -> WriteView {
+  Table* table{ nullptr };
+  {
+    std::shared_lock catalogLock{ m_Db.m_CatalogMutex };
+    table = &m_Db.findTable(tableName);
+  }
+  return write(*table);
+}
+
+auto Transaction::write(Table& table) -> WriteView {
+  for (auto& tableWrite : m_Writes) {
+    if (tableWrite.table == &table) {
+      return { table, *tableWrite.write };
+    }
+  }
+
+  std::unique_lock lock{ table.getMutex(), std::defer_lock };
+  auto deadline{ std::chrono::steady_clock::now() +
+                 m_Db.getLockTimeout() };
+  if (m_Cancel != nullptr) {
+    deadline = std::min(deadline, m_Cancel->getDeadline());
+  }
+  bool locked{ false };
+  {
+    TraceSpan span{ "lock wait", "transaction" };
+    locked = lock.try_lock_until(deadline);
+  }
+  if (!locked) {
+    if (m_Cancel != nullptr) {
+      m_Cancel->check();
+    }
+    throw TransactionException{ fmt::format(
+        "Timed out waiting for table '{}' held by another transaction",
+        table.getName()) };
+  }
+  auto& tableWrite{ m_Writes.emplace_back(
+      &table, std::move(lock), makeUnique<Table::PendingWrite>(table)) };
+  tableWrite.write->setQueryMemory(m_QueryMemory);
+  tableWrite.write->setCancellation(m_Cancel);
+  return { table, *tableWrite.write };
+}
+
+void Transaction::log(CommitLog::Entry entry) {
+  m_Redo.push_back(std::move(entry));
+}
+
+void Transaction::commit() {
+  TraceSpan span{ "commit", "transaction" };
+  // durable before visible, tables stay locked meanwhile so records of
+  // conflicting transactions are logged in commit order
+  if (m_Db.m_CommitLog && !m_Redo.empty()) {
+    m_Db.m_CommitLog->append(m_Redo);
+  }
+  for (auto& tableWrite : m_Writes) {
+    tableWrite.write->commit();
+  }
+  m_Writes.clear();
+  m_Redo.clear();
+}
+
+void Transaction::rollback() {
+  m_Writes.clear();
+  m_Redo.clear();
+}
+
+auto Transaction::getDatabase() const -> Database& {
+  return m_Db;
+}
+
+void Transaction::setProfile(QueryPlan* plan) {
+  m_Profile = plan;
+}
+
+auto Transaction::profileStage(size_t index) const -> StageProfiler {
+  return StageProfiler{ m_Profile != nullptr ? &m_Profile->getStage(index)
+                                             : nullptr,
+                        m_Db.getHardwareCounters() };
+}
+
+void Transaction::setQueryMemory(MemoryTracker* memory) {
+  m_QueryMemory = memory;
+  for (auto& tableWrite : m_Writes) {
+    tableWrite.write->setQueryMemory(memory);
+  }
+}
+
+void Transaction::setCancellation(const CancellationToken* cancel) {
+  m_Cancel = cancel;
+  for (auto& tableWrite : m_Writes) {
+    tableWrite.write->setCancellation(cancel);
+  }
+}
+
+void Transaction::reserveMemory(size_t bytes) {
+  m_Db.m_Memory.reserve(bytes);
+  if (m_QueryMemory != nullptr) {
+    m_QueryMemory->charge(bytes);
+  }
+}
+
+void Transaction::releaseMemory(size_t bytes) {
+  m_Db.m_Memory.release(bytes);
+  if (m_QueryMemory != nullptr) {
+    m_QueryMemory->release(bytes);
+  }
+}
+
+} // namespace adun
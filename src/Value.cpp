@@ -27,6 +27,42 @@ auto Value::toString() const -> std::string {
   });
 }
 
+auto Value::getHeapSize() const -> size_t {
+  return std::visit(
+      [](auto&& v) -> size_t {
+        using T = std::remove_cvref_t<decltype(v)>;
+        if constexpr (std::is_same_v<T, ByteArray>) {
+          return v.capacity();
+        } else if constexpr (std::is_same_v<T, std::string>) {
+          // short strings live in the object itself
+          const auto* object{ reinterpret_cast<const char*>(&v) };
+          auto isInline{ v.data() >= object &&
+                         v.data() < object + sizeof(v) };
+          return isInline ? 0 : v.capacity() + 1;
+        } else {
+          return 0;
+        }
+      },
+      m_Data);
+}
+
+auto Value::hash() const -> size_t {
+  auto dataHash{ std::visit(
+      [](auto&& v) -> size_t {
+        using T = std::remove_cvref_t<decltype(v)>;
+        if constexpr (std::is_same_v<T, ByteArray>) {
+          return std::hash<std::string_view>{}(std::string_view{
+              reinterpret_cast<const char*>(v.data()), v.size() });
+        } else if constexpr (std::is_same_v<T, std::monostate>) {
+          return 0;
+        } else {
+          return std::hash<T>{}(v);
+        }
+      },
+      m_Data) };
+  return dataHash ^ (static_cast<size_t>(m_Type) << 1U);
+}
+
 auto Value::typeToString(ValueType type) -> std::string_view {
   adun_assert(s_TypeToString.FindByFirst(type).has_value(),
               "Type to string not implemented");
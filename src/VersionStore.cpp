@@ -0,0 +1,35 @@
+#include "adun/VersionStore.hpp"
+#include "adun/Assert.hpp"
+
+namespace adun {
+
+VersionStore::~VersionStore() {
+  auto size{ getSize() };
+  forEach(size, [](RowVersion& version) { version.~RowVersion(); });
+  for (size_t chunk{ 0 }; chunk < s_NumChunks; chunk++) {
+    ::operator delete(m_Chunks[chunk].load(),
+                      std::align_val_t{ alignof(RowVersion) });
+  }
+}
+
+auto VersionStore::append(Row row, Timestamp begin) -> RowVersion& {
+  auto index{ m_Size.load(std::memory_order_relaxed) };
+  auto [chunk, offset]{ locate(index) };
+  adun_assert(chunk < s_NumChunks, "Version store is full");
+
+  auto* versions{ m_Chunks[chunk].load(std::memory_order_relaxed) };
+  if (versions == nullptr) {
+    // raw memory, slots are constructed one by one
+    versions = static_cast<RowVersion*>(
+        ::operator new(getChunkSize(chunk) * sizeof(RowVersion),
+                       std::align_val_t{ alignof(RowVersion) }));
+    m_Chunks[chunk].store(versions, std::memory_order_release);
+  }
+
+  auto* version{ new (versions + offset)
+                     RowVersion{ std::move(row), begin } };
+  m_Size.store(index + 1, std::memory_order_release);
+  return *version;
+}
+
+} // namespace adun
@@ -1,11 +1,30 @@
 #include "adun/Column.hpp"
+#include "adun/Client.hpp"
+#include "adun/CommitLog.hpp"
+#include "adun/CsvLoader.hpp"
 #include "adun/Database.hpp"
 #include "adun/Exceptions.hpp"
+#include "adun/MappedFile.hpp"
+#include "adun/Parser/BinOpExpr.hpp"
 #include "adun/Parser/Command.hpp"
 #include "adun/Parser/Lexer.hpp"
+#include "adun/Server.hpp"
+#include "adun/Session.hpp"
 #include "adun/Table.hpp"
+#include "adun/Tracer.hpp"
 #include "adun/Value.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <filesystem>
+#include <fstream>
+#include <future>
 #include <gtest/gtest.h>
+#include <sstream>
+#include <thread>
+#include <tuple>
+#include <unordered_set>
 #include <optional>
 
 using namespace adun;      // NOLINT
@@ -94,6 +113,46 @@ TEST(Table, Select) {
                NoSuchColumnException);
 }
 
+TEST(Table, Versions) {
+  Table tbl("test", testScheme);
+  tbl.addRows({ { { "name", "Ann" } }, { { "name", "Bob" } } });
+  auto name{ tbl.getScheme().at("name").index };
+  auto age{ tbl.getScheme().at("age").index };
+  auto all{ [](const Row& /*row*/) {
+    return true;
+  } };
+
+  // results keep seeing the snapshot they were taken from
+  auto before{ tbl.selectRows(all, { "name" }) };
+  tbl.deleteRows(
+      [name](const Row& row) { return row.get(name) == "Bob"; });
+  tbl.updateRows(all, [age](Row& row) { row.get(age) = 99; });
+  size_t rows{ 0 };
+  for (const auto& row : before) {
+    EXPECT_TRUE(row["name"] == "Ann" || row["name"] == "Bob");
+    rows++;
+  }
+  EXPECT_EQ(rows, 2);
+  EXPECT_EQ(tbl.selectRows(all, { "name" }).getNumAffectedRows(), 1);
+
+  // failed writes leave no trace
+  tbl.addRow({ { "name", "Cat" } });
+  EXPECT_THROW(
+      tbl.updateRows(all, [name](Row& row) { row.get(name) = "Dan"; }),
+      InvalidRowException);
+  auto isDan{ [name](const Row& row) {
+    return row.get(name) == "Dan";
+  } };
+  EXPECT_EQ(tbl.selectRows(isDan, { "name" }).getNumAffectedRows(), 0);
+
+  // dead versions are collected
+  for (int32_t i{ 0 }; i < 10'000; i++) {
+    tbl.updateRows(all, [age, i](Row& row) { row.get(age) = i; });
+  }
+  EXPECT_LT(tbl.getNumVersions(), 4'000);
+  EXPECT_EQ(tbl.selectRows(all, { "age" }).getNumAffectedRows(), 2);
+}
+
 TEST(Lexer, EscapeSequences) {
   Lexer lexer;
   EXPECT_NO_THROW(lexer.lex(R"("\a")"));
@@ -108,6 +167,50 @@ TEST(Lexer, EscapeSequences) {
 
   // no such sequence
   EXPECT_THROW(lexer.lex(R"("\]")"), LexerFatalError);
+  EXPECT_THROW(lexer.lex(R"("\"")"), LexerFatalError);
+}
+
+TEST(Lexer, Literals) {
+  Lexer lexer;
+  std::string query{ R"(select name from test where "a\tb" = 0x15C42)" };
+  lexer.lex(query);
+  auto tokens{ lexer.getTokens() };
+  ASSERT_EQ(tokens->size(), 9);
+  EXPECT_EQ((*tokens)[3].getStringView(), "test");
+  EXPECT_EQ((*tokens)[5].getStringView(), R"("a\tb")");
+  EXPECT_EQ((*tokens)[5].getLiteralValue(), "a\tb");
+  EXPECT_EQ((*tokens)[7].getLiteralValue(),
+            (ByteArray{ 0x01, 0x5c, 0x42 }));
+  EXPECT_TRUE((*tokens)[8].is(TokenKind::Eof));
+
+  // query ending right after a token
+  lexer = Lexer{};
+  lexer.lex("12 abc");
+  ASSERT_EQ(lexer.getTokens()->size(), 3);
+  EXPECT_EQ(lexer.getTokens()->front().getLiteralValue(), 12);
+  EXPECT_EQ((*lexer.getTokens())[1].getStringView(), "abc");
+
+  EXPECT_THROW(lexer.lex(R"("unclosed)"), LexerFatalError);
+}
+
+TEST(Lexer, KeywordsAndLongRuns) {
+  Lexer lexer;
+  std::string query{
+    R"(SeLeCt selects autoincrement_column_name_longer_than_block )"
+    R"("string body spanning more than one block \n and tail" )"
+    R"(12345678901234567)"
+  };
+  lexer.lex(query);
+  const auto& tokens{ *lexer.getTokens() };
+  ASSERT_EQ(tokens.size(), 6);
+  EXPECT_TRUE(tokens[0].is(TokenKind::KW_select));
+  EXPECT_TRUE(tokens[1].is(TokenKind::Identifier));
+  EXPECT_EQ(tokens[2].getStringView(),
+            "autoincrement_column_name_longer_than_block");
+  EXPECT_EQ(tokens[3].getLiteralValue(),
+            "string body spanning more than one block \n and tail");
+  EXPECT_TRUE(tokens[4].is(TokenKind::NumericLiteral));
+  EXPECT_EQ(tokens[4].getLength(), 17);
 }
 
 TEST(Column, Creation) {
@@ -216,6 +319,42 @@ TEST(Database, Select) {
                ParserException);
 }
 
+TEST(Database, InsertMultipleRows) {
+  Database db;
+  db.execute("create table test (id integer autoincrement, name string "
+             "unique);");
+
+  Result r;
+  EXPECT_NO_THROW(r = db.execute(R"(insert (name = "Ann"), (name = "Bob"),
+                                     (name = "Cat") into test;)"));
+  EXPECT_EQ(r.getNumAffectedRows(), 3);
+
+  // whole batch is rejected on a duplicate within it or against the table
+  EXPECT_THROW(db.execute(R"(insert (name = "Dan"), (name = "Dan") into
+                              test;)"),
+               InvalidRowException);
+  EXPECT_THROW(db.execute(R"(insert (name = "Eve"), (name = "Ann") into
+                              test;)"),
+               InvalidRowException);
+  EXPECT_EQ(
+      db.execute("select * from test where true;").getNumAffectedRows(),
+      3);
+
+  // failed batches don't consume autoincrement values
+  db.execute(R"(insert (name = "Dan") into test;)");
+  for (const auto& row :
+       db.execute(R"(select id from test where name = "Dan";)")) {
+    EXPECT_EQ(row["id"], 4);
+  }
+
+  // syntax errors
+  EXPECT_THROW(db.execute(R"(insert (name = "Fay"), into test;)"),
+               ParserException);
+  EXPECT_THROW(db.execute(R"(insert (name = "Fay") (name = "Gus") into
+                              test;)"),
+               ParserException);
+}
+
 TEST(Database, Update) {
   Database db;
   db.execute("create table test (id integer autoincrement, name string "
@@ -281,6 +420,614 @@ TEST(Database, Delete) {
                CommandException);
 }
 
+TEST(Database, Script) {
+  Database db;
+  std::vector<Result> results;
+  EXPECT_NO_THROW(results = db.executeScript(R"(
+    create table test (id integer autoincrement, name string unique);
+    insert (name = "Ann") into test;
+    insert (name = "Bob") into test;;
+    update test set (name = "Cat") where id = 2;
+    select name from test where id = 2)"));
+  ASSERT_EQ(results.size(), 5);
+  EXPECT_EQ(results[3].getNumAffectedRows(), 1);
+  for (const auto& row : results[4]) {
+    EXPECT_EQ(row["name"], "Cat");
+  }
+
+  EXPECT_TRUE(db.executeScript(" \n ").empty());
+
+  // statements before the failing one are applied
+  EXPECT_THROW(db.executeScript(R"(insert (name = "Dan") into test;
+                                   insert (name = "Dan") into test;)"),
+               InvalidRowException);
+  EXPECT_EQ(db.execute(R"(select * from test where name = "Dan";)")
+                .getNumAffectedRows(),
+            1);
+}
+
+static auto writeTempFile(const std::string& name,
+                          const std::string& contents) -> std::string {
+  auto path{ std::filesystem::temp_directory_path() / name };
+  std::ofstream{ path, std::ios::binary } << contents;
+  return path.string();
+}
+
+TEST(Database, Copy) {
+  Database db;
+  createTestTable(db);
+
+  // omitted and empty fields take defaults, quoted ones are kept as is
+  auto path{ writeTempFile("adun_copy.csv",
+                            "age,name,data\r\n"
+                            "19,,0x003F\r\n"
+                            "+20,\"Bob, \"\"B\"\"\",15c\n"
+                            "\n"
+                            "21,\"Lu\nffy\",0XFFFABC16") };
+  Result r;
+  EXPECT_NO_THROW(r = db.execute("COPY test FROM \"" + path + "\";"));
+  EXPECT_EQ(r.getNumAffectedRows(), 3);
+
+  r = db.execute("select * from test where id = 2;");
+  for (const auto& row : r) {
+    EXPECT_EQ(row["name"], R"(Bob, "B")");
+    EXPECT_EQ(row["age"], 20);
+    EXPECT_EQ(row["data"], (ByteArray{ 0x01, 0x5c }));
+  }
+  r = db.execute("select * from test where id = 1 || id = 3;");
+  for (const auto& row : r) {
+    EXPECT_TRUE(row["name"] == "Ann" || row["name"] == "Lu\nffy");
+  }
+
+  // nothing is inserted when any row is invalid
+  EXPECT_THROW(db.importCsv("test", writeTempFile("adun_copy.csv",
+                                                  "data\n0x01\n0x01\n")),
+               InvalidRowException);
+  try {
+    db.importCsv("test", writeTempFile("adun_copy.csv",
+                                       "age,data\n1,0x01\nabc,0x02\n"));
+    FAIL();
+  } catch (const CsvException& e) {
+    EXPECT_TRUE(std::string{ e.what() }.contains("Line 3"));
+  }
+  EXPECT_THROW(db.importCsv("test", writeTempFile("adun_copy.csv",
+                                                  "data\n0x01,2\n")),
+               CsvException);
+  EXPECT_THROW(db.importCsv("test", writeTempFile("adun_copy.csv",
+                                                  "data\n\"0x01\n")),
+               CsvException);
+  EXPECT_EQ(
+      db.execute("select * from test where true;").getNumAffectedRows(),
+      3);
+
+  EXPECT_THROW(db.importCsv("test", writeTempFile("adun_copy.csv",
+                                                  "wrong\n1\n")),
+               NoSuchColumnException);
+  EXPECT_THROW(db.importCsv("test", "/non/existent.csv"), FileException);
+  EXPECT_THROW(db.importCsv("non_existent", path), CommandException);
+  EXPECT_THROW(db.execute("COPY test FROM 1;"), ParserException);
+}
+
+TEST(Database, Export) {
+  Database db;
+  createTestTable(db);
+  insertIntoTestTable(db);
+  db.execute(R"(INSERT (name="", age=23, data=0x01) INTO test;)");
+  db.execute(R"(INSERT (name="a, b", age=24, data=0x02) INTO test;)");
+
+  std::ostringstream out;
+  EXPECT_EQ(db.exportQuery("select name, age from test where age > 20;",
+                           out),
+            5);
+  EXPECT_EQ(out.str(), "name,age\n"
+                       "Luffy,21\n"
+                       "Robin,22\n"
+                       "Nami,22\n"
+                       "\"\",23\n"
+                       "\"a, b\",24\n");
+
+  std::ostringstream binary;
+  EXPECT_EQ(db.exportQuery("select data from test where id = 1;", binary,
+                           ExportFormat::Binary),
+            1);
+  using namespace std::string_literals;
+  EXPECT_EQ(binary.str(), "ADUN\x01"
+                          "\x01\0\0\0"
+                          "\x03\x04\0\0\0data"
+                          "\x01\x03\x02\0\0\0\x00\x3f"
+                          "\0"s);
+
+  // round trip through COPY
+  db.importCsv("test", writeTempFile("adun_copy.csv",
+                                     "name,age,data\n\"q\"\"\",25,0x03\n"));
+  auto path{ (std::filesystem::temp_directory_path() / "adun_export.csv")
+                 .string() };
+  EXPECT_EQ(
+      db.execute("COPY test TO \"" + path + "\";").getNumAffectedRows(),
+      8);
+  db.execute("CREATE TABLE backup (id INTEGER, name STRING, age INTEGER, "
+             "data BYTE);");
+  EXPECT_EQ(db.importCsv("backup", path), 8);
+  std::ostringstream original;
+  std::ostringstream copied;
+  db.exportQuery("select id, name, age, data from test where true;",
+                 original);
+  db.exportQuery("select id, name, age, data from backup where true;",
+                 copied);
+  EXPECT_EQ(copied.str(), original.str());
+
+  EXPECT_THROW(db.exportQuery("delete from test where true;", out),
+               CommandException);
+  EXPECT_THROW(db.exportQuery("select wrong from test where true;", out),
+               NoSuchColumnException);
+  EXPECT_THROW(db.exportCsv("test", "/non/existent/dir/file.csv"),
+               FileException);
+}
+
+TEST(Database, ConcurrentStatements) {
+  Database db;
+  db.execute("create table a (id integer autoincrement, n integer);");
+  db.execute("create table b (id integer autoincrement, n integer);");
+  static constexpr int32_t numInserts{ 200 };
+
+  std::vector<std::jthread> threads;
+  for (std::string table : { "a", "b" }) {
+    threads.emplace_back([&db, table] {
+      for (int32_t i{ 0 }; i < numInserts; i++) {
+        db.execute("insert (n = " + std::to_string(i) + ") into " +
+                   table + ";");
+      }
+    });
+  }
+  for (int32_t i{ 0 }; i < 4; i++) {
+    threads.emplace_back([&db] {
+      size_t prevRows{ 0 };
+      for (int32_t j{ 0 }; j < numInserts; j++) {
+        size_t rows{ 0 };
+        for (const auto& row :
+             db.execute("select n from a where n >= 0;")) {
+          EXPECT_LT(row["n"], numInserts);
+          rows++;
+        }
+        EXPECT_GE(rows, prevRows);
+        prevRows = rows;
+      }
+    });
+  }
+  threads.emplace_back([&db] {
+    for (int32_t i{ 0 }; i < 10; i++) {
+      db.execute("create table c" + std::to_string(i) + " (n integer);");
+    }
+  });
+  threads.clear();
+
+  for (std::string table : { "a", "b" }) {
+    EXPECT_EQ(db.execute("select id from " + table + " where true;")
+                  .getNumAffectedRows(),
+              numInserts);
+  }
+  EXPECT_NO_THROW(db.execute("select n from c9 where true;"));
+}
+
+TEST(Database, SnapshotReads) {
+  Database db;
+  db.execute("create table t (id integer autoincrement, n integer);");
+  for (int32_t i{ 0 }; i < 100; i++) {
+    db.execute("insert (n = 0) into t;");
+  }
+
+  // every snapshot sees a statement either fully applied or not at all
+  std::atomic<bool> done{ false };
+  std::vector<std::jthread> readers;
+  for (int32_t i{ 0 }; i < 3; i++) {
+    readers.emplace_back([&db, &done] {
+      while (!done) {
+        auto r{ db.execute("select n from t where true;") };
+        std::optional<Value> first;
+        size_t rows{ 0 };
+        for (const auto& row : r) {
+          first = first.value_or(row["n"]);
+          EXPECT_EQ(row["n"], *first);
+          rows++;
+        }
+        EXPECT_EQ(rows, 100);
+      }
+    });
+  }
+  for (int32_t i{ 0 }; i < 200; i++) {
+    db.execute("update t set (n = n + 1) where true;");
+  }
+  done = true;
+  readers.clear();
+
+  for (const auto& row : db.execute("select n from t where id = 1;")) {
+    EXPECT_EQ(row["n"], 200);
+  }
+}
+
+TEST(Database, ConcurrentInserts) {
+  Database db;
+  db.execute("create table t (id integer autoincrement, n integer "
+             "unique);");
+  static constexpr int32_t numThreads{ 4 };
+  static constexpr int32_t numInserts{ 100 };
+
+  std::vector<std::jthread> threads;
+  for (int32_t i{ 0 }; i < numThreads; i++) {
+    threads.emplace_back([&db, i] {
+      for (int32_t j{ 0 }; j < numInserts; j++) {
+        auto n{ std::to_string(i * numInserts + j) };
+        db.execute("insert (n = " + n + ") into t;");
+        // every thread also races for the same value
+        try {
+          db.execute("insert (n = " + std::to_string(1000 + j) +
+                     ") into t;");
+        } catch (const InvalidRowException&) {
+        }
+      }
+    });
+  }
+  threads.clear();
+
+  std::unordered_set<Value> ids;
+  for (const auto& row : db.execute("select id from t where true;")) {
+    EXPECT_TRUE(ids.insert(row["id"]).second);
+  }
+  EXPECT_EQ(ids.size(), (numThreads + 1) * numInserts);
+
+  // the index follows rolled back deletes
+  Session session{ db };
+  session.execute("begin;");
+  session.execute("delete from t where n = 0;");
+  session.execute("insert (n = 0) into t;");
+  session.execute("rollback;");
+  EXPECT_THROW(db.execute("insert (n = 0) into t;"), InvalidRowException);
+  // only the final values have to be unique
+  db.execute("update t set (n = n + 1) where n < 1000;");
+  EXPECT_EQ(db.execute("select id from t where n > 0 && n <= 400;")
+                .getNumAffectedRows(),
+            numThreads * numInserts);
+}
+
+TEST(Database, Explain) {
+  Database db;
+  db.execute("create table t (id integer autoincrement, n integer "
+             "unique);");
+  db.execute("insert (n = 1), (n = 2), (n = 3) into t;");
+  auto planOf{ [&db](const std::string& query) {
+    std::vector<std::string> lines;
+    for (const auto& row : db.execute(query)) {
+      lines.push_back(row["plan"].get<std::string>());
+    }
+    return lines;
+  } };
+
+  auto plan{ planOf("explain select n from t where n > 1 && n < 3;") };
+  ASSERT_EQ(plan.size(), 3);
+  EXPECT_EQ(plan[0], "Seq Scan on t");
+  EXPECT_EQ(plan[1], "  Filter: ((n > 1) && (n < 3))");
+  EXPECT_EQ(plan[2], "  Output: n");
+
+  // a cached plan is rebound to the new literals
+  plan = planOf("explain analyze select n from t where n > 2 && n < 9;");
+  EXPECT_EQ(plan[1], "  Filter: ((n > 2) && (n < 9))");
+  EXPECT_NE(plan[0].find("rows examined=3, rows matched=1"),
+            std::string::npos);
+  EXPECT_EQ(plan.at(3), "Rows: 1");
+
+  // ANALYZE applies changes
+  plan = planOf("explain analyze update t set (n = n + 10) where n > 1;");
+  EXPECT_EQ(plan[0].substr(0, 6), "Lock t");
+  EXPECT_NE(plan[1].find("rows matched=2, versions allocated=2, "
+                         "unique checks=2"),
+            std::string::npos);
+  EXPECT_EQ(db.execute("select n from t where n > 10;")
+                .getNumAffectedRows(),
+            2);
+  planOf("explain delete from t where true;");
+  EXPECT_EQ(db.execute("select n from t where true;")
+                .getNumAffectedRows(),
+            3);
+
+  EXPECT_THROW(db.execute("explain create table u (n integer);"),
+               ParserException);
+}
+
+TEST(Session, Transactions) {
+  Database db;
+  db.execute("create table t (id integer autoincrement, n integer "
+             "unique);");
+  Session session{ db };
+  auto count{ [&db](const std::string& cond) {
+    return db.execute("select id from t where " + cond + ";")
+        .getNumAffectedRows();
+  } };
+
+  session.execute("begin;");
+  EXPECT_TRUE(session.inTransaction());
+  session.execute("insert (n = 1), (n = 2) into t;");
+  session.execute("update t set (n = n + 10) where n = 1;");
+  // own changes are visible inside, nothing outside
+  EXPECT_EQ(session.execute("select n from t where n = 11;")
+                .getNumAffectedRows(),
+            1);
+  EXPECT_EQ(count("true"), 0);
+  // a failing statement is undone alone
+  EXPECT_THROW(session.execute("insert (n = 3), (n = 2) into t;"),
+               InvalidRowException);
+  session.execute("commit;");
+  EXPECT_FALSE(session.inTransaction());
+  EXPECT_EQ(count("true"), 2);
+  EXPECT_EQ(count("n = 11"), 1);
+
+  // rolled back inserts don't use up autoincrement values
+  session.execute("begin;");
+  session.execute("delete from t where true;");
+  session.execute("insert (n = 5) into t;");
+  session.execute("rollback;");
+  EXPECT_EQ(count("true"), 2);
+  session.execute("insert (n = 5) into t;");
+  EXPECT_EQ(count("id = 3"), 1);
+
+  EXPECT_THROW(session.execute("commit;"), CommandException);
+  session.execute("begin;");
+  EXPECT_THROW(session.execute("begin;"), CommandException);
+  EXPECT_THROW(session.execute("create table u (n integer);"),
+               CommandException);
+  session.execute("rollback;");
+
+  // an open transaction is rolled back with its script
+  db.executeScript("begin; insert (n = 7) into t;");
+  EXPECT_EQ(count("n = 7"), 0);
+}
+
+TEST(Session, LockTimeout) {
+  Database db;
+  db.execute("create table t (n integer);");
+  db.setLockTimeout(std::chrono::milliseconds{ 10 });
+
+  Session first{ db };
+  first.execute("begin;");
+  first.execute("insert (n = 1) into t;");
+  Session second{ db };
+  // readers never wait
+  EXPECT_EQ(second.execute("select n from t where true;")
+                .getNumAffectedRows(),
+            0);
+  EXPECT_THROW(second.execute("insert (n = 2) into t;"),
+               TransactionException);
+  first.execute("commit;");
+  second.execute("insert (n = 2) into t;");
+  EXPECT_EQ(db.execute("select n from t where true;").getNumAffectedRows(),
+            2);
+}
+
+TEST(Session, Cancellation) {
+  Database db;
+  db.execute("create table t (n integer);");
+  std::string csv{ "n\n" };
+  for (int i{ 0 }; i < 100'000; i++) {
+    csv += "1\n";
+  }
+  db.importCsv("t", writeTempFile("adun_cancel.csv", csv));
+
+  // keep cancelling until the update reaches a check
+  Session session{ db };
+  session.execute("begin;");
+  std::atomic<bool> done{ false };
+  std::jthread canceller{ [&] {
+    while (!done.load()) {
+      session.cancel();
+    }
+  } };
+  EXPECT_THROW(session.execute("update t set (n = 2) where true;"),
+               QueryCancelledException);
+  done.store(true);
+  canceller.join();
+  // one issued between statements fails the next one, then it is gone
+  session.cancel();
+  EXPECT_THROW(session.execute("select n from t where n = 1;"),
+               QueryCancelledException);
+  // the statement is reverted, the transaction goes on
+  EXPECT_TRUE(session.inTransaction());
+  EXPECT_EQ(session.execute("select n from t where n = 2;").getNumRows(),
+            0);
+  session.execute("delete from t where n = 1;");
+  session.execute("commit;");
+  EXPECT_EQ(db.execute("select n from t where true;").getNumRows(), 0);
+
+  // the deadline bounds lock waits too
+  Session holder{ db };
+  holder.execute("begin;");
+  holder.execute("insert (n = 1) into t;");
+  Session waiter{ db };
+  waiter.setStatementTimeout(std::chrono::milliseconds{ 10 });
+  try {
+    waiter.execute("insert (n = 2) into t;");
+    FAIL();
+  } catch (const QueryCancelledException& e) {
+    EXPECT_EQ(e.getCause(), QueryCancelledException::Cause::TimedOut);
+  }
+  // only a cancel that failed a statement is cleared, by its cause
+  waiter.cancel();
+  try {
+    waiter.execute("insert (n = 2) into t;");
+    FAIL();
+  } catch (const QueryCancelledException& e) {
+    EXPECT_EQ(e.getCause(), QueryCancelledException::Cause::Cancelled);
+  }
+  holder.execute("commit;");
+  waiter.execute("insert (n = 2) into t;");
+  EXPECT_EQ(db.execute("select n from t where true;").getNumRows(), 2);
+}
+
+TEST(Database, Recovery) {
+  auto logPath{ writeTempFile("adun_recovery.log", "") };
+  auto csvPath{ writeTempFile("adun_recovery.csv", "n\n1\n2\n") };
+  {
+    Database db{ logPath };
+    db.execute("create table t (id integer autoincrement, n integer);");
+    db.execute("copy t from \"" + csvPath + "\";");
+    Session session{ db };
+    session.execute("begin;");
+    session.execute("insert (n = 3) into t;");
+    session.execute("update t set (n = n * 10) where n = 1;");
+    session.execute("commit;");
+    session.execute("begin;");
+    session.execute("insert (n = 4) into t;");
+    session.execute("rollback;");
+    // changes of EXPLAIN ANALYZE are logged too
+    db.execute("explain analyze delete from t where n = 2;");
+  }
+  // loaded data is in the log, the file is not needed anymore
+  std::filesystem::remove(csvPath);
+  // a torn record is ignored
+  std::ofstream{ logPath, std::ios::binary | std::ios::app } << "\x20";
+
+  auto expectRecovered{ [&logPath] {
+    Database db{ logPath };
+    std::vector<std::pair<int32_t, int32_t>> rows;
+    for (const auto& row : db.execute("select id, n from t where true;")) {
+      rows.emplace_back(row["id"].get<int32_t>(),
+                        row["n"].get<int32_t>());
+    }
+    std::ranges::sort(rows);
+    EXPECT_EQ(rows, (std::vector<std::pair<int32_t, int32_t>>{
+                        { 1, 10 }, { 3, 3 } }));
+    return db.execute("insert (n = 5) into t;");
+  } };
+  expectRecovered();
+  // appends follow the intact records
+  Database db{ logPath };
+  EXPECT_EQ(db.execute("select id from t where id = 4;")
+                .getNumAffectedRows(),
+            1);
+}
+
+namespace {
+
+/// Runs eagerly and is never awaited, enough to drive a co_await
+struct DetachedTask {
+  struct promise_type {
+    auto get_return_object() -> DetachedTask {
+      return {};
+    }
+    auto initial_suspend() noexcept -> std::suspend_never {
+      return {};
+    }
+    auto final_suspend() noexcept -> std::suspend_never {
+      return {};
+    }
+    void return_void() {
+    }
+    void unhandled_exception() {
+      std::terminate();
+    }
+  };
+};
+
+auto countRowsAsync(Database& db, std::promise<size_t>& count)
+    -> DetachedTask {
+  auto result{ co_await db.executeAwaitable(
+      "select n from t where true;") };
+  try {
+    co_await db.executeAwaitable("select n from missing where true;");
+  } catch (const CommandException&) {
+    count.set_value(result.getNumAffectedRows());
+  }
+}
+
+} // namespace
+
+TEST(Database, AsyncExecute) {
+  Database db;
+  db.execute("create table t (n integer unique);");
+
+  static constexpr int32_t s_NumQueries{ 64 };
+  std::vector<std::future<Result>> inFlight;
+  for (int32_t i{ 0 }; i < s_NumQueries; i++) {
+    inFlight.push_back(
+        db.executeAsync("insert (n = " + std::to_string(i) + ") into t;"));
+  }
+  for (auto& future : inFlight) {
+    EXPECT_EQ(future.get().getNumAffectedRows(), 1);
+  }
+  EXPECT_THROW(db.executeAsync("insert (n = 0) into t;").get(),
+               InvalidRowException);
+
+  std::promise<size_t> count;
+  countRowsAsync(db, count);
+  EXPECT_EQ(count.get_future().get(), s_NumQueries);
+}
+
+TEST(CommitLog, GroupCommit) {
+  auto path{ writeTempFile("adun_group.log", "") };
+  static constexpr size_t s_NumCommitters{ 8 };
+  {
+    // the delay is long enough for every committer to join the group
+    CommitLog log{ path, { .maxDelay = std::chrono::seconds{ 10 },
+                           .maxGroupSize = s_NumCommitters } };
+    std::vector<std::jthread> committers;
+    for (size_t i{ 0 }; i < s_NumCommitters; i++) {
+      committers.emplace_back([&log, i] {
+        log.append({ { CommitLog::Entry::Kind::Statement, {},
+                       std::to_string(i) } });
+      });
+    }
+    committers.clear();
+
+    auto stats{ log.getStats() };
+    EXPECT_EQ(stats.numGroups, 1);
+    EXPECT_EQ(stats.numRecords, s_NumCommitters);
+    EXPECT_EQ(stats.maxGroupSize, s_NumCommitters);
+    EXPECT_GE(stats.maxSyncTime, stats.totalSyncTime / stats.numGroups);
+  }
+
+  CommitLog log{ path };
+  size_t numRecords{ 0 };
+  log.replay([&numRecords](const CommitLog::Record& record) {
+    EXPECT_EQ(record.size(), 1);
+    numRecords++;
+  });
+  EXPECT_EQ(numRecords, s_NumCommitters);
+}
+
+TEST(CsvLoader, ParallelChunks) {
+  Table table{ "test",
+               { { "id", Column{ ValueType::Integer, ColMod::Unique } },
+                 { "name", Column{ ValueType::String } },
+                 { "ok", Column{ ValueType::Boolean } } } };
+
+  // quoted newlines all over the place to trip chunk boundaries
+  constexpr int32_t numRows{ 200'000 };
+  std::string csv{ "id,ok,name\n" };
+  for (int32_t i{ 0 }; i < numRows; i++) {
+    csv += std::to_string(i);
+    csv += i % 2 == 0 ? ",true," : ",0,";
+    csv += i % 3 == 0 ? "\"multi\nline\"\n" : "plain\n";
+  }
+
+  ThreadPool pool{ 4 };
+  EXPECT_EQ(CsvLoader(table, pool).load(csv), numRows);
+
+  const auto& scheme{ table.getScheme() };
+  auto id{ scheme.at("id").index };
+  auto name{ scheme.at("name").index };
+  auto ok{ scheme.at("ok").index };
+  size_t numMultiline{ 0 };
+  size_t numTrue{ 0 };
+  int64_t idSum{ 0 };
+  table.scanRows([](const Row&) { return true; },
+                 [&](const Row& row) {
+                   idSum += row.get(id).get<int32_t>();
+                   numMultiline += row.get(name) == "multi\nline";
+                   numTrue += row.get(ok).get<bool>();
+                 });
+  EXPECT_EQ(idSum, int64_t{ numRows } * (numRows - 1) / 2);
+  EXPECT_EQ(numMultiline, (numRows + 2) / 3);
+  EXPECT_EQ(numTrue, numRows / 2);
+}
+
 TEST(Result, Iterate) {
   Database db;
   createTestTable(db);
@@ -304,6 +1051,546 @@ TEST(Result, Iterate) {
   }
 }
 
+TEST(QueryCache, ReusesParsedQueries) {
+  Database db;
+  db.execute("create table test (id integer autoincrement, name string "
+             "unique, age integer);");
+  db.execute(R"(insert (name = "Ann", age = 19) into test;)");
+  db.execute(R"(INSERT (name = "Bob", age = 20) INTO test;)");
+  db.execute(R"(insert (name = "Cat", age = 21) into test;)");
+  auto stats{ db.getQueryCacheStats() };
+  EXPECT_EQ(stats.entries, 1);
+  EXPECT_EQ(stats.hits, 2);
+  EXPECT_GT(stats.memoryBytes, 0);
+
+  // rebound literals must take effect
+  for (int32_t age{ 19 }; age <= 21; age++) {
+    auto r{ db.execute("select name from test where age = " +
+                       std::to_string(age) + ";") };
+    size_t rows{ 0 };
+    for (const auto& row : r) {
+      EXPECT_EQ(row["name"], age == 19   ? "Ann"
+                             : age == 20 ? "Bob"
+                                         : "Cat");
+      rows++;
+    }
+    EXPECT_EQ(rows, 1);
+  }
+  EXPECT_EQ(db.getQueryCacheStats().hits, 4);
+
+  // literal type changes don't change the plan shape
+  EXPECT_THROW(db.execute(R"(select name from test where age = "19";)"),
+               BinOpException);
+  EXPECT_EQ(db.getQueryCacheStats().hits, 5);
+
+  db.setQueryCacheCapacity(1);
+  stats = db.getQueryCacheStats();
+  EXPECT_EQ(stats.entries, 1);
+  EXPECT_EQ(stats.evictions, 1);
+}
+
+TEST(Database, Metrics) {
+  using Kind = QueryMetrics::CommandKind;
+  Database db;
+  db.execute("create table test (id integer autoincrement, age integer);");
+  db.execute("insert (age = 19), (age = 20), (age = 21) into test;");
+  db.execute("select age from test where age > 19;");
+  db.execute("update test set (age = 30) where age = 19;");
+  EXPECT_THROW(db.execute("select age from nope where true;"),
+               CommandException);
+  EXPECT_THROW(db.execute("INSERT (age = 1)"), ParserException);
+
+  auto metrics{ db.getMetrics() };
+  EXPECT_EQ(metrics.get(Kind::Create).count, 1);
+  EXPECT_EQ(metrics.get(Kind::Insert).rowsAffected, 3);
+  const auto& select{ metrics.get(Kind::Select) };
+  EXPECT_EQ(select.count, 2);
+  EXPECT_EQ(select.errors, 1);
+  EXPECT_EQ(select.rowsScanned, 3);
+  EXPECT_EQ(select.rowsReturned, 2);
+  EXPECT_EQ(select.executeTime.getCount(), 2);
+  EXPECT_GT(select.executeTime.getQuantile(0.99).count(), 0);
+  EXPECT_EQ(metrics.get(Kind::Update).rowsAffected, 1);
+  EXPECT_EQ(metrics.get(Kind::Invalid).errors, 1);
+
+  auto text{ metrics.toPrometheus() };
+  EXPECT_NE(text.find("adun_queries_total{command=\"select\"} 2"),
+            std::string::npos);
+  EXPECT_NE(text.find("adun_query_phase_seconds_count{command=\"update\","
+                      "phase=\"execute\"} 1"),
+            std::string::npos);
+}
+
+TEST(Database, MemoryAccounting) {
+  Database db;
+  db.execute("create table test (id integer autoincrement, name string "
+             "unique);");
+  auto insert{ [&db](int first, int count) {
+    std::string query{ "insert " };
+    for (int i{ first }; i < first + count; i++) {
+      query += (i == first ? "(name = \"" : ", (name = \"") +
+               std::string(32, 'x') + std::to_string(i) + "\")";
+    }
+    return db.execute(query + " into test;");
+  } };
+  auto result{ insert(0, 100) };
+  EXPECT_GT(result.getPeakMemory(), 100 * 32);
+
+  auto usage{ db.getMemoryUsage("test") };
+  EXPECT_GT(usage.rows, 100 * sizeof(RowVersion));
+  EXPECT_GT(usage.strings, 100 * 32);
+  EXPECT_GT(usage.indexes, 100 * 32);
+  EXPECT_EQ(db.getMemoryUsage(), usage.getTotal());
+
+  // fails cleanly, nothing is inserted
+  db.setMemoryLimit(db.getMemoryUsage() + 1'000);
+  EXPECT_THROW(insert(100, 100), MemoryLimitException);
+  EXPECT_EQ(db.getMemoryUsage(), usage.getTotal());
+  EXPECT_EQ(
+      db.execute("select id from test where true;").getNumAffectedRows(),
+      100);
+  EXPECT_THROW(db.execute("update test set (name = name + \"tail\") "
+                          "where true;"),
+               MemoryLimitException);
+  EXPECT_EQ(db.execute(R"(select id from test where name = "x";)")
+                .getNumAffectedRows(),
+            0);
+
+  db.setMemoryLimit(0);
+  insert(100, 100);
+  EXPECT_GT(db.getMemoryUsage(), usage.getTotal());
+  db.execute("delete from test where true;");
+  EXPECT_EQ(db.getMemoryUsage("test").indexes, 0);
+}
+
+TEST(Database, SlowQueryLog) {
+  auto logPath{ writeTempFile("adun_slow.log", "") };
+  std::filesystem::remove(logPath + ".1");
+  Database db;
+  db.execute("create table test (id integer autoincrement, age integer);");
+  db.setSlowQueryLog({ .threshold         = std::chrono::nanoseconds{ 0 },
+                       .capacity          = 2,
+                       .captureStacktrace = true,
+                       .path              = logPath,
+                       .maxFileSize       = 1024 });
+  db.execute("insert (age = 19) into test;");
+  db.execute("select age from test where age > 18;");
+  EXPECT_THROW(db.execute("select age from nope where true;"),
+               CommandException);
+
+  // only the latest ones are kept
+  auto entries{ db.getSlowQueries() };
+  ASSERT_EQ(entries.size(), 2);
+  EXPECT_EQ(entries[0].query, "select age from test where age > 18;");
+  EXPECT_EQ(entries[0].sample.rowsReturned, 1);
+  EXPECT_FALSE(entries[0].sample.failed);
+  ASSERT_FALSE(entries[0].plan.empty());
+  EXPECT_EQ(entries[0].plan[0], "Seq Scan on test");
+  EXPECT_FALSE(entries[0].stacktrace.empty());
+  EXPECT_TRUE(entries[1].sample.failed);
+  EXPECT_TRUE(entries[1].plan.empty());
+
+  // stack traces overflow the file at once
+  EXPECT_TRUE(std::filesystem::exists(logPath + ".1"));
+  std::ifstream file{ logPath };
+  std::string header;
+  std::getline(file, header);
+  EXPECT_NE(header.find("select"), std::string::npos);
+
+  db.disableSlowQueryLog();
+  db.execute("select age from test where true;");
+  EXPECT_TRUE(db.getSlowQueries().empty());
+  std::filesystem::remove(logPath);
+  std::filesystem::remove(logPath + ".1");
+}
+
+TEST(Database, HardwareCounters) {
+  Database db;
+  db.setHardwareCounters(true);
+  db.execute("create table test (id integer autoincrement, age integer);");
+  db.execute("insert (age = 19), (age = 20) into test;");
+  db.execute("select age from test where age > 19;");
+  auto result{ db.execute(
+      "explain analyze select age from test where age > 19;") };
+  std::string plan;
+  for (const auto& row : result) {
+    plan += row["plan"].get<std::string>() + "\n";
+  }
+
+  // counted if the machine allows it, reported as unavailable otherwise
+  const auto& counters{ PerfCounters::forThisThread() };
+  auto events{ db.getMetrics()
+                   .get(QueryMetrics::CommandKind::Select)
+                   .executeEvents };
+  if (counters.isAvailable()) {
+    EXPECT_NE(plan.find("Hardware Counters: "), std::string::npos);
+    EXPECT_GT(std::ranges::max(events), 0);
+  } else {
+    EXPECT_NE(plan.find("Hardware Counters Unavailable: "),
+              std::string::npos);
+    EXPECT_EQ(std::ranges::max(events), 0);
+  }
+}
+
+TEST(Tracer, ChromeTraceExport) {
+  Database db;
+  db.execute("create table test (id integer unique, age integer);");
+  Tracer::clear();
+  Tracer::start();
+  db.execute("insert (id = 1, age = 19), (id = 2, age = 20) into test;");
+  db.execute("select age from test where age > 19;");
+  Tracer::stop();
+  // not recorded once stopped
+  db.execute("delete from test where age > 19;");
+
+  auto json{ Tracer::exportJson() };
+  EXPECT_EQ(json.rfind(R"({"displayTimeUnit":"ms","traceEvents":[)", 0),
+            0);
+  for (const auto* name :
+       { R"("name":"lex")", R"("name":"parse")", R"("name":"plan")",
+         R"("name":"insert")", R"("name":"unique check")",
+         R"("name":"scan")", R"("name":"select")" }) {
+    EXPECT_NE(json.find(name), std::string::npos) << name;
+  }
+  EXPECT_EQ(json.find(R"("name":"delete")"), std::string::npos);
+  EXPECT_NE(json.find(R"("rows":1)"), std::string::npos);
+
+  Tracer::clear();
+  EXPECT_EQ(Tracer::exportJson().find(R"("ph":"X")"), std::string::npos);
+}
+
+#ifdef __linux__
+TEST(Server, Protocol) {
+  auto unixPath{
+    (std::filesystem::temp_directory_path() / "adun_test.sock").string()
+  };
+  Database db;
+  Server server{ db, { .unixPath = unixPath, .batchRows = 16 } };
+  server.start();
+  ASSERT_NE(server.getPort(), 0);
+
+  auto client{ Client::connect("127.0.0.1", server.getPort()) };
+  client.execute("create table test (id integer autoincrement, "
+                 "name string, age integer);");
+  EXPECT_EQ(client.execute(R"(insert (name = "Ann", age = 19) into test;)")
+                .affectedRows,
+            1);
+
+  // rows span batches
+  auto insert{ client.prepare(
+      R"(insert (name = "", age = 0) into test;)") };
+  ASSERT_EQ(insert.numParams, 2);
+  for (int32_t age{ 20 }; age < 120; age++) {
+    std::array<Value, 2> params{ Value{ std::string{ "say \"hi\"" } },
+                                 Value{ age } };
+    EXPECT_EQ(client.execute(insert, params).affectedRows, 1);
+  }
+  client.close(insert);
+  auto all{ client.execute("select id, name, age from test where true;") };
+  std::ranges::sort(all.columns);
+  EXPECT_EQ(all.columns,
+            (std::vector<std::string>{ "age", "id", "name" }));
+  EXPECT_EQ(all.rows.size(), 101);
+
+  auto unixClient{ Client::connectUnix(unixPath) };
+  auto select{ unixClient.prepare(
+      "select name from test where age = 0;") };
+  std::array<Value, 1> age{ Value{ 42 } };
+  auto quoted{ unixClient.execute(select, age) };
+  ASSERT_EQ(quoted.rows.size(), 1);
+  EXPECT_EQ(quoted.rows[0][0].get<std::string>(), "say \"hi\"");
+
+  size_t streamed{ 0 };
+  EXPECT_EQ(unixClient.execute("select age from test where age > 19;",
+                               [&](std::vector<Value> row) {
+                                 EXPECT_GT(row[0].get<int32_t>(), 19);
+                                 streamed++;
+                               }),
+            100);
+  EXPECT_EQ(streamed, 100);
+
+  // errors fail the statement only
+  try {
+    client.execute("select age from nope where true;");
+    FAIL();
+  } catch (const StatementException& e) {
+    EXPECT_EQ(e.getCode(), protocol::ErrorCode::Statement);
+  }
+
+  // transactions are per connection
+  client.execute("begin;");
+  client.execute("delete from test where true;");
+  EXPECT_EQ(unixClient.execute("select id from test where true;")
+                .rows.size(),
+            101);
+  client.execute("rollback;");
+  EXPECT_EQ(client.execute("select id from test where true;").rows.size(),
+            101);
+  EXPECT_EQ(server.getNumConnections(), 2);
+
+  server.stop();
+  EXPECT_THROW(client.execute("select id from test where true;"),
+               ClientException);
+  EXPECT_FALSE(std::filesystem::exists(unixPath));
+}
+
+TEST(Server, PreparedParameters) {
+  auto logPath{ writeTempFile("adun_prepared.log", "") };
+  const std::string quoted{ R"(say "hi" \n\)" };
+  {
+    Database db{ logPath };
+    Server server{ db, {} };
+    server.start();
+    auto client{ Client::connect("127.0.0.1", server.getPort()) };
+    client.execute("create table p (id integer autoincrement, "
+                   "n integer, s string, b byte);");
+
+    // bound as values, whatever their literal spelling would be
+    auto insert{ client.prepare(
+        R"(insert (n = 0, s = "", b = 0x00) into p;)") };
+    std::array<Value, 3> negative{ Value{ -5 }, Value{ quoted },
+                                   Value{ ByteArray{} } };
+    std::array<Value, 3> minimum{ Value{ INT32_MIN },
+                                  Value{ std::string{} },
+                                  Value{ ByteArray{ 0x01 } } };
+    EXPECT_EQ(client.execute(insert, negative).affectedRows, 1);
+    EXPECT_EQ(client.execute(insert, minimum).affectedRows, 1);
+    std::array<Value, 2> tooFew{ Value{ 1 }, Value{ std::string{} } };
+    EXPECT_THROW(client.execute(insert, tooFew), StatementException);
+    // their literals can't be rebound, so they take no parameters
+    EXPECT_THROW(client.prepare(R"(copy p from "/non/existent.csv";)"),
+                 StatementException);
+    EXPECT_THROW(client.prepare("create table q (n integer default(1));"),
+                 StatementException);
+    const std::string copy{ R"(copy p from "/non/existent.csv";)" };
+    Lexer lexer;
+    lexer.lex(copy);
+    Session session{ db };
+    std::array<Value, 1> path{ Value{ std::string{ "/tmp/other.csv" } } };
+    EXPECT_THROW(session.execute(lexer.getTokens(), path), CommandException);
+
+    auto selectBytes{ client.prepare("select b from p where n = 0;") };
+    std::array<Value, 1> n{ Value{ INT32_MIN } };
+    auto rows{ client.execute(selectBytes, n).rows };
+    ASSERT_EQ(rows.size(), 1);
+    EXPECT_EQ(rows[0][0].get<ByteArray>(), ByteArray{ 0x01 });
+    auto selectString{ client.prepare("select s from p where n = 0;") };
+    n[0] = -5;
+    rows = client.execute(selectString, n).rows;
+    ASSERT_EQ(rows.size(), 1);
+    EXPECT_EQ(rows[0][0].get<std::string>(), quoted);
+  }
+
+  // redone with the bound values
+  Database db{ logPath };
+  auto result{ db.execute("select n, s, b from p where n < 0;") };
+  using Stored = std::tuple<int32_t, std::string, ByteArray>;
+  std::vector<Stored> rows;
+  for (const auto& row : result) {
+    rows.emplace_back(row["n"].get<int32_t>(),
+                      row["s"].get<std::string>(),
+                      row["b"].get<ByteArray>());
+  }
+  std::ranges::sort(rows);
+  EXPECT_EQ(rows, (std::vector<Stored>{
+                      { INT32_MIN, "", ByteArray{ 0x01 } },
+                      { -5, quoted, ByteArray{} } }));
+  std::filesystem::remove(logPath);
+}
+
+#endif
+
+TEST(Protocol, Columns) {
+  std::string frame;
+  Value name{ std::string{ "Ann" } };
+  Value age{ 19 };
+  Value null;
+  {
+    protocol::MessageWriter writer{ frame,
+                                    protocol::MessageType::RowBatch };
+    std::array<const Value*, 3> names{ &name, &null, &name };
+    std::array<const Value*, 2> mixed{ &name, &age };
+    writer.writeColumn(names);
+    writer.writeColumn(mixed);
+  }
+  ASSERT_EQ(protocol::getFrameSize(frame), frame.size());
+
+  protocol::MessageReader reader{ frame };
+  auto names{ reader.readColumn(3) };
+  EXPECT_EQ(names[0].get<std::string>(), "Ann");
+  EXPECT_TRUE(names[1].isEmpty());
+  EXPECT_EQ(names[2].get<std::string>(), "Ann");
+  auto mixed{ reader.readColumn(2) };
+  EXPECT_EQ(mixed[0].get<std::string>(), "Ann");
+  EXPECT_EQ(mixed[1].get<int32_t>(), 19);
+  EXPECT_THROW(reader.readU8(), protocol::ProtocolException);
+}
+
+#ifdef __linux__
+TEST(Server, Pipelining) {
+  Database db;
+  Server server{ db, {} };
+  server.start();
+  auto client{ Client::connect("127.0.0.1", server.getPort()) };
+  client.execute("create table test (id integer autoincrement, "
+                 "name string, age integer);");
+
+  // answered in order, a failed one doesn't stop the rest
+  auto insert{ client.prepare(
+      R"(insert (name = "", age = 0) into test;)") };
+  for (int32_t age{ 0 }; age < 100; age++) {
+    std::array<Value, 2> params{ Value{ std::to_string(age) },
+                                 Value{ age } };
+    client.post(insert, params);
+  }
+  client.post("select age from nope where true;");
+  client.post(R"(insert (name = "old", age = 200) into test;)");
+  client.post("select name, age from test where age < 3;");
+  EXPECT_EQ(client.getNumPending(), 103);
+  EXPECT_THROW(client.execute("select id from test where true;"),
+               ClientException);
+  for (int i{ 0 }; i < 100; i++) {
+    EXPECT_EQ(client.getResult().affectedRows, 1);
+  }
+  EXPECT_THROW(client.getResult(), StatementException);
+  EXPECT_EQ(client.getResult().affectedRows, 1);
+  auto young{ client.getResult() };
+  EXPECT_EQ(young.rows.size(), 3);
+  EXPECT_EQ(client.getNumPending(), 0);
+  EXPECT_THROW(client.getResult(), ClientException);
+
+  // more than both sides buffer, the client reads while it sends
+  constexpr int s_NumQueries{ 20'000 };
+  for (int i{ 0 }; i < s_NumQueries; i++) {
+    client.post("select id, name, age from test where age < 50;");
+  }
+  client.flush();
+  for (int i{ 0 }; i < s_NumQueries; i++) {
+    ASSERT_EQ(client.getResult().rows.size(), 50);
+  }
+}
+
+TEST(Server, DisconnectDropsPipeline) {
+  Database db;
+  db.execute("create table t (n integer);");
+  std::string csv{ "n\n" };
+  for (int i{ 0 }; i < 100'000; i++) {
+    csv += "1\n";
+  }
+  db.importCsv("t", writeTempFile("adun_disconnect.csv", csv));
+  db.execute("create table c (n integer);");
+  auto getNumWrites{ [&db] {
+    return db.execute("select n from c where true;").getNumRows();
+  } };
+
+  Server server{ db, {} };
+  server.start();
+  // inserts reach no cancellation check, only the batch may stop them
+  constexpr size_t s_NumWrites{ 20'000 };
+  auto postWrites{ [](Client& client) {
+    // busy meanwhile, so the inserts queue up as one batch
+    client.post("select n from t where n = 2;");
+    client.flush();
+    for (size_t i{ 0 }; i < s_NumWrites; i++) {
+      client.post("insert (n = 1) into c;");
+    }
+    client.flush();
+    std::this_thread::sleep_for(std::chrono::milliseconds{ 10 });
+  } };
+  auto waitForNoConnections{ [&server] {
+    for (int i{ 0 }; i < 10'000 && server.getNumConnections() > 0; i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+    }
+    return server.getNumConnections() == 0;
+  } };
+
+  // a disconnect drops the writes not started yet
+  {
+    auto client{ Client::connect("127.0.0.1", server.getPort()) };
+    postWrites(client);
+  }
+  ASSERT_TRUE(waitForNoConnections());
+  auto numWrites{ getNumWrites() };
+  EXPECT_LT(numWrites, s_NumWrites);
+  std::this_thread::sleep_for(std::chrono::milliseconds{ 20 });
+  EXPECT_EQ(getNumWrites(), numWrites);
+
+  // so does stopping
+  auto client{ Client::connect("127.0.0.1", server.getPort()) };
+  postWrites(client);
+  server.stop();
+  EXPECT_LT(getNumWrites(), numWrites + s_NumWrites);
+}
+
+TEST(Server, StalledClients) {
+  Database db;
+  db.execute("create table t (n integer);");
+  std::string csv{ "n\n" };
+  for (int i{ 0 }; i < 100'000; i++) {
+    csv += "1\n";
+  }
+  db.importCsv("t", writeTempFile("adun_stalled.csv", csv));
+
+  constexpr size_t s_NumWorkers{ 2 };
+  constexpr size_t s_NumQueries{ 40 };
+  Server::Options options;
+  options.numWorkers = s_NumWorkers;
+  Server server{ db, options };
+  server.start();
+  // joined after the stalled ones hang up, should it not be answered
+  std::atomic<bool> answered{ false };
+  std::jthread other;
+  // more results than are buffered for them, which nobody reads yet
+  std::vector<Client> stalled;
+  for (size_t i{ 0 }; i < s_NumWorkers; i++) {
+    auto& client{ stalled.emplace_back(
+        Client::connect("127.0.0.1", server.getPort())) };
+    for (size_t j{ 0 }; j < s_NumQueries; j++) {
+      client.post("select n from t where true;");
+    }
+    client.flush();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds{ 100 });
+
+  // neither the server workers nor the database pool are theirs to hold
+  other = std::jthread{ [&] {
+    auto client{ Client::connect("127.0.0.1", server.getPort()) };
+    client.execute("select n from t where n = 2;");
+    answered.store(true);
+  } };
+  for (int i{ 0 }; i < 10'000 && !answered.load(); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+  }
+  ASSERT_TRUE(answered.load());
+  auto result{ db.executeAsync("select n from t where n = 2;") };
+  ASSERT_EQ(result.wait_for(std::chrono::seconds{ 10 }),
+            std::future_status::ready);
+  EXPECT_EQ(result.get().getNumRows(), 0);
+
+  // their requests resume as they read
+  for (auto& client : stalled) {
+    for (size_t j{ 0 }; j < s_NumQueries; j++) {
+      EXPECT_EQ(client.getResult().rows.size(), 100'000);
+    }
+  }
+}
+
+#endif
+
+TEST(LatencyHistogram, Quantiles) {
+  LatencyHistogram histogram;
+  for (int64_t ns{ 1 }; ns <= 1000; ns++) {
+    histogram.add(std::chrono::nanoseconds{ ns });
+  }
+  EXPECT_EQ(histogram.getCount(), 1000);
+  EXPECT_EQ(histogram.getSum().count(), 500'500);
+  // buckets are at most 1/8 wide
+  auto median{ histogram.getQuantile(0.5).count() };
+  EXPECT_GE(median, 500);
+  EXPECT_LE(median, 500 + 500 / 8);
+  EXPECT_GE(histogram.getQuantile(1.0).count(), 1000);
+}
+
 TEST(Value, OperatorsInt) {
   Value v1{ 5 };
   Value v2{ 10 };